@@ -0,0 +1,109 @@
+#include "Arduino.h"
+#include <stdarg.h>
+
+static const int CANTIDAD_PINES = 64;
+
+static uint64_t microsVirtuales = 0;
+static int nivelesPines[CANTIDAD_PINES];
+static uint32_t escriturasPines[CANTIDAD_PINES];
+
+HardwareSerial Serial;
+
+unsigned long millis()
+{
+    return (unsigned long)(microsVirtuales / 1000);
+}
+
+unsigned long micros()
+{
+    return (unsigned long)microsVirtuales;
+}
+
+void delay(unsigned long milisegundos)
+{
+    microsVirtuales += (uint64_t)milisegundos * 1000;
+}
+
+// Sin otras tareas que atender: ceder no consume tiempo virtual
+void yield()
+{
+}
+
+void pinMode(int pin, int modo)
+{
+    (void)pin;
+    (void)modo;
+}
+
+int digitalRead(int pin)
+{
+    return (pin >= 0 && pin < CANTIDAD_PINES) ? nivelesPines[pin] : LOW;
+}
+
+void digitalWrite(int pin, int valor)
+{
+    if (pin >= 0 && pin < CANTIDAD_PINES)
+    {
+        nivelesPines[pin] = valor;
+        escriturasPines[pin]++;
+    }
+}
+
+size_t HardwareSerial::printf(const char *formato, ...)
+{
+    llamadas++;
+    if (silenciado)
+    {
+        return 0;
+    }
+    va_list argumentos;
+    va_start(argumentos, formato);
+    int escritos = vprintf(formato, argumentos);
+    va_end(argumentos);
+    return escritos > 0 ? escritos : 0;
+}
+
+size_t HardwareSerial::print(const char *texto)
+{
+    llamadas++;
+    return silenciado ? 0 : (size_t)fputs(texto, stdout);
+}
+
+size_t HardwareSerial::println(const char *texto)
+{
+    llamadas++;
+    return silenciado ? 0 : (size_t)::printf("%s\n", texto);
+}
+
+void hostFijarMicros(uint64_t microsegundos)
+{
+    microsVirtuales = microsegundos;
+}
+
+void hostAvanzarMicros(uint64_t microsegundos)
+{
+    microsVirtuales += microsegundos;
+}
+
+uint64_t hostMicros()
+{
+    return microsVirtuales;
+}
+
+void hostFijarPin(int pin, int valor)
+{
+    if (pin >= 0 && pin < CANTIDAD_PINES)
+    {
+        nivelesPines[pin] = valor;
+    }
+}
+
+int hostLeerPin(int pin)
+{
+    return (pin >= 0 && pin < CANTIDAD_PINES) ? nivelesPines[pin] : LOW;
+}
+
+uint32_t hostEscriturasPin(int pin)
+{
+    return (pin >= 0 && pin < CANTIDAD_PINES) ? escriturasPines[pin] : 0;
+}
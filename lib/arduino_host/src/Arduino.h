@@ -0,0 +1,56 @@
+#pragma once
+
+// Subconjunto de la API de Arduino para compilar en el host (env:native) los
+// módulos de control que no dependen de red: zones, time_utils, interrupts,
+// metricas. El tiempo es virtual y los pines son un arreglo en memoria, así
+// los tests y herramientas de host controlan reloj y sensores sin hardware.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+using std::max;
+using std::min;
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long milisegundos);
+void yield();
+void pinMode(int pin, int modo);
+int digitalRead(int pin);
+void digitalWrite(int pin, int valor);
+
+class HardwareSerial
+{
+public:
+    void begin(unsigned long baudios) { (void)baudios; }
+    size_t printf(const char *formato, ...) __attribute__((format(printf, 2, 3)));
+    size_t print(const char *texto);
+    size_t println(const char *texto = "");
+    void flush() {}
+
+    // Los tests y el simulador pueden silenciar la salida de depuración
+    bool silenciado = false;
+    // Llamadas a printf/print/println, silenciadas o no (test_benchmark)
+    uint32_t llamadas = 0;
+};
+
+extern HardwareSerial Serial;
+
+// Control del entorno simulado
+void hostFijarMicros(uint64_t microsegundos);
+void hostAvanzarMicros(uint64_t microsegundos);
+uint64_t hostMicros();
+void hostFijarPin(int pin, int valor);
+int hostLeerPin(int pin);
+uint32_t hostEscriturasPin(int pin);
@@ -0,0 +1,216 @@
+#include "adaptacion.h"
+#include "configuracion.h"
+#include "persistencia.h"
+#include "metricas.h"
+#include <math.h>
+
+static_assert(TIMEOUT_ADAPTATIVO_MINIMO_S >= TIMEOUT_MINIMO_S && TIMEOUT_ADAPTATIVO_MAXIMO_S <= TIMEOUT_MAXIMO_S,
+              "El rango adaptativo debe estar dentro del aceptado");
+
+// Cubeta 0: hasta 1 s; cubeta k: hasta 2^(k/4) s. La última (2^14 s) pasa TIMEOUT_MAXIMO_S.
+const int CUBETAS_BOSQUEJO = 57;
+
+struct DatosAdaptacion
+{
+    uint16_t cuentas[CANTIDAD_ZONAS][CUBETAS_BOSQUEJO];
+    uint32_t apagadosEnFalso[CANTIDAD_ZONAS];
+    uint8_t activa[CANTIDAD_ZONAS];
+};
+
+static DatosAdaptacion datos;
+static uint32_t totales[CANTIDAD_ZONAS];
+static bool pendiente[CANTIDAD_ZONAS];         // Hay muestras nuevas por evaluar
+
+// Último apagado por timeout, mientras se espera una posible reactivación
+static bool esperandoReactivacion[CANTIDAD_ZONAS];
+static unsigned long instanteTimeout[CANTIDAD_ZONAS];
+static unsigned long ultimoMovimientoTimeout[CANTIDAD_ZONAS];
+
+static bool cambiosSinGuardar = false;
+static unsigned long ultimaPersistencia = 0;
+
+static int cubetaPausa(unsigned long pausaMs)
+{
+    if (pausaMs <= 1000)
+    {
+        return 0;
+    }
+    int cubeta = (int)ceilf(4.0f * log2f(pausaMs / 1000.0f));
+    return cubeta < CUBETAS_BOSQUEJO ? cubeta : CUBETAS_BOSQUEJO - 1;
+}
+
+static uint32_t limiteCubetaMs(int cubeta)
+{
+    return (uint32_t)(1000.0f * exp2f(cubeta / 4.0f));
+}
+
+static void agregarPausa(int zona, unsigned long pausaMs, uint16_t peso)
+{
+    uint16_t *cuentas = datos.cuentas[zona];
+    if (totales[zona] + peso > PESO_MAXIMO_BOSQUEJO)
+    {
+        totales[zona] = 0;
+        for (int i = 0; i < CUBETAS_BOSQUEJO; i++)
+        {
+            cuentas[i] /= 2;
+            totales[zona] += cuentas[i];
+        }
+    }
+    cuentas[cubetaPausa(pausaMs)] += peso;
+    totales[zona] += peso;
+    pendiente[zona] = true;
+    cambiosSinGuardar = true;
+}
+
+// Límite superior de la cubeta donde el acumulado alcanza la fracción pedida
+static uint32_t cuantilPausasMs(int zona, float fraccion)
+{
+    uint32_t objetivo = (uint32_t)ceilf(fraccion * totales[zona]);
+    uint32_t acumulado = 0;
+    for (int i = 0; i < CUBETAS_BOSQUEJO; i++)
+    {
+        acumulado += datos.cuentas[zona][i];
+        if (acumulado >= objetivo)
+        {
+            return limiteCubetaMs(i);
+        }
+    }
+    return limiteCubetaMs(CUBETAS_BOSQUEJO - 1);
+}
+
+static uint32_t timeoutObjetivoS(int zona)
+{
+    uint32_t segundos = (uint32_t)(cuantilPausasMs(zona, CUANTIL_TIMEOUT_ADAPTATIVO) * MARGEN_TIMEOUT_ADAPTATIVO / 1000);
+    return min(max(segundos, TIMEOUT_ADAPTATIVO_MINIMO_S), TIMEOUT_ADAPTATIVO_MAXIMO_S);
+}
+
+void iniciarAdaptacion()
+{
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        datos.activa[i] = ADAPTACION_POR_DEFECTO;
+    }
+    restaurarClave(CLAVE_ADAPTACION, "adaptacion", &datos, sizeof(datos));
+    for (int zona = 0; zona < CANTIDAD_ZONAS; zona++)
+    {
+        totales[zona] = 0;
+        for (int i = 0; i < CUBETAS_BOSQUEJO; i++)
+        {
+            totales[zona] += datos.cuentas[zona][i];
+        }
+        pendiente[zona] = true;
+        Serial.printf("⏱️ Zona %d: timeout %s, %lu muestras, %lu apagados en falso\n", zona + 1,
+                      datos.activa[zona] ? "adaptativo" : "fijo", (unsigned long)totales[zona],
+                      (unsigned long)datos.apagadosEnFalso[zona]);
+    }
+    ultimaPersistencia = millis();
+}
+
+// Actividad poco después de un timeout: la pausa desde el último movimiento
+// hasta ahora es la que el timeout tendría que haber cubierto
+static void verificarReactivacion(int zona)
+{
+    if (!esperandoReactivacion[zona])
+    {
+        return;
+    }
+    esperandoReactivacion[zona] = false;
+    unsigned long ahora = millis();
+    if (ahora - instanteTimeout[zona] > VENTANA_REACTIVACION_S * 1000UL)
+    {
+        return;
+    }
+    datos.apagadosEnFalso[zona]++;
+    incrementarContador(CONTADOR_APAGADOS_EN_FALSO);
+    agregarPausa(zona, ahora - ultimoMovimientoTimeout[zona], PESO_REACTIVACION);
+    Serial.printf("Zona %d: actividad %lu s después del timeout, apagado en falso\n", zona + 1,
+                  (ahora - instanteTimeout[zona]) / 1000);
+}
+
+void movimientoAdaptacion(int zona, bool encendida, unsigned long pausaMs)
+{
+    if (!encendida)
+    {
+        verificarReactivacion(zona);
+        return;
+    }
+    agregarPausa(zona, pausaMs, 1);
+}
+
+void apagadoTimeoutAdaptacion(int zona, unsigned long ultimoMovimiento)
+{
+    esperandoReactivacion[zona] = true;
+    instanteTimeout[zona] = millis();
+    ultimoMovimientoTimeout[zona] = ultimoMovimiento;
+}
+
+void encendidoManualAdaptacion(int zona)
+{
+    verificarReactivacion(zona);
+}
+
+bool aplicarTimeoutsAdaptativos()
+{
+    bool cambio = false;
+    for (int zona = 0; zona < CANTIDAD_ZONAS; zona++)
+    {
+        if (!pendiente[zona])
+        {
+            continue;
+        }
+        pendiente[zona] = false;
+        if (!datos.activa[zona] || totales[zona] < MUESTRAS_MINIMAS_ADAPTACION)
+        {
+            continue;
+        }
+        uint32_t objetivo = timeoutObjetivoS(zona);
+        uint32_t actual = configuracionActual().tiempoMaximoEncendidoMs[zona] / 1000;
+        uint32_t diferencia = objetivo > actual ? objetivo - actual : actual - objetivo;
+        if (diferencia * 100 < actual * HISTERESIS_TIMEOUT_ADAPTATIVO_PCT)
+        {
+            continue;
+        }
+        Serial.printf("Zona %d: timeout adaptativo %lu s -> %lu s\n", zona + 1, (unsigned long)actual,
+                      (unsigned long)objetivo);
+        establecerTimeoutZona(zona, objetivo);
+        cambio = true;
+    }
+
+    // Las muestras cambian con cada movimiento: a NVS cada tanto, no en cada ráfaga
+    if (cambiosSinGuardar && millis() - ultimaPersistencia >= INTERVALO_PERSISTENCIA_ADAPTACION_MS)
+    {
+        ultimaPersistencia = millis();
+        cambiosSinGuardar = false;
+        marcarClaveModificada(CLAVE_ADAPTACION);
+    }
+    return cambio;
+}
+
+bool fijarAdaptacionZona(int zona, bool activa)
+{
+    if (zona < 0 || zona >= CANTIDAD_ZONAS)
+    {
+        return false;
+    }
+    if (datos.activa[zona] != activa)
+    {
+        datos.activa[zona] = activa;
+        pendiente[zona] = true;
+        marcarClaveModificada(CLAVE_ADAPTACION);
+    }
+    return true;
+}
+
+EstadoAdaptacion estadoAdaptacion(int zona)
+{
+    EstadoAdaptacion estado = {};
+    estado.activa = datos.activa[zona];
+    estado.muestras = totales[zona];
+    estado.apagadosEnFalso = datos.apagadosEnFalso[zona];
+    if (totales[zona] >= MUESTRAS_MINIMAS_ADAPTACION)
+    {
+        estado.cuantilPausaMs = cuantilPausasMs(zona, CUANTIL_TIMEOUT_ADAPTATIVO);
+        estado.timeoutObjetivoS = timeoutObjetivoS(zona);
+    }
+    return estado;
+}
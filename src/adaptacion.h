@@ -0,0 +1,40 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Timeouts de apagado aprendidos por zona. Cada pausa entre dos movimientos
+// con la zona encendida fuera de horario se anota en un bosquejo de cuantiles
+// de memoria fija: cubetas geométricas de razón 2^(1/4) desde 1 s (error
+// relativo menor al 19 %) cuyas cuentas se reducen a la mitad al llegar a
+// PESO_MAXIMO_BOSQUEJO, así que los hábitos viejos se olvidan. Un apagado por
+// timeout seguido de actividad dentro de VENTANA_REACTIVACION_S es un apagado
+// en falso: la pausa que no se cubrió entra con PESO_REACTIVACION.
+//
+// El timeout de la zona es CUANTIL_TIMEOUT_ADAPTATIVO de las pausas por
+// MARGEN_TIMEOUT_ADAPTATIVO, acotado a TIMEOUT_ADAPTATIVO_MINIMO_S..MAXIMO_S,
+// y se publica con establecerTimeoutZona(). Fijar un timeout a mano apaga la
+// adaptación de esa zona; el aprendizaje sigue igual por si se vuelve a activar.
+
+struct EstadoAdaptacion
+{
+    bool activa;
+    uint32_t muestras;          // Peso acumulado en el bosquejo (decae)
+    uint32_t apagadosEnFalso;
+    uint32_t cuantilPausaMs;    // 0 mientras no haya MUESTRAS_MINIMAS_ADAPTACION
+    uint32_t timeoutObjetivoS;  // Lo que se publicaría ahora
+};
+
+// Restaura bosquejos y modo de cada zona de NVS
+void iniciarAdaptacion();
+
+// Desde la máquina de estados de zones.cpp
+void movimientoAdaptacion(int zona, bool encendida, unsigned long pausaMs);
+void apagadoTimeoutAdaptacion(int zona, unsigned long ultimoMovimiento);
+void encendidoManualAdaptacion(int zona);
+
+// Tarea de control: publica los timeouts que se alejaron del aprendido más
+// que la histéresis; devuelve true si cambió alguno
+bool aplicarTimeoutsAdaptativos();
+
+bool fijarAdaptacionZona(int zona, bool activa);
+EstadoAdaptacion estadoAdaptacion(int zona);
@@ -0,0 +1,927 @@
+#include "api.h"
+#include "config.h"
+#include "zones.h"
+#include "time_utils.h"
+#include "mi_webserver.h"
+#include "websocket.h"
+#include "sse.h"
+#include "metricas.h"
+#include "memoria.h"
+#include "trazas.h"
+#include "vigilancia.h"
+#include "bitacora.h"
+#include "estadisticas.h"
+#include "energia.h"
+#include "persistencia.h"
+#include "calendario.h"
+#include "configuracion.h"
+#include "adaptacion.h"
+#include "comandos.h"
+#include "planificador.h"
+#include <ArduinoJson.h>
+#include <WiFi.h>
+#include <stdarg.h>
+
+// Long-poll de GET /api/state: clientes retenidos hasta que avance la generación
+struct EsperaEstado
+{
+    WiFiClient cliente;
+    uint32_t generacion;
+    unsigned long limite;
+    bool activa;
+};
+
+static EsperaEstado esperasEstado[MAX_ESPERAS_ESTADO];
+
+// Acumula texto en un búfer fijo en la pila y lo envía como chunk HTTP al
+// llenarse, sin construir la respuesta completa en un String.
+class EscritorRespuesta
+{
+public:
+    void agregar(const char *formato, ...)
+    {
+        for (int intento = 0; intento < 2; intento++)
+        {
+            va_list argumentos;
+            va_start(argumentos, formato);
+            int largo = vsnprintf(bufer + usado, sizeof(bufer) - usado, formato, argumentos);
+            va_end(argumentos);
+            if (largo >= 0 && usado + largo < sizeof(bufer))
+            {
+                usado += largo;
+                return;
+            }
+            // No cupo: enviar lo acumulado y reintentar con el búfer vacío
+            vaciar();
+        }
+    }
+
+    void vaciar()
+    {
+        if (usado > 0)
+        {
+            servidor.sendContent(bufer, usado);
+            usado = 0;
+        }
+    }
+
+private:
+    char bufer[512];
+    size_t usado = 0;
+};
+
+static void responderError(int codigo, const char *error, int indice)
+{
+    char respuesta[80];
+    snprintf(respuesta, sizeof(respuesta), "{\"ok\":false,\"error\":\"%s\",\"indice\":%d}", error, indice);
+    servidor.send(codigo, "application/json", respuesta);
+}
+
+// PATCH /api/zones
+// Cuerpo: [{"zona":0,"on":true},...]
+//     o:  {"zonas":[{"zona":0,"on":true}],"horarios":[{"indice":0,"inicio":"08:00","fin":"12:00"}]}
+// Todo el lote se valida antes de aplicar nada. Las zonas entran juntas en la
+// cola de comandos y el loop las aplica en un solo paso, con una única
+// escritura de relays por zona; los horarios se aplican aquí mismo.
+void manejarApiZonas()
+{
+    JsonDocument cuerpo;
+    DeserializationError error = deserializeJson(cuerpo, servidor.arg("plain"));
+    if (error)
+    {
+        responderError(400, "json", -1);
+        return;
+    }
+
+    JsonArray listaZonas = cuerpo.is<JsonArray>() ? cuerpo.as<JsonArray>() : cuerpo["zonas"].as<JsonArray>();
+    JsonArray listaHorarios = cuerpo["horarios"].as<JsonArray>();
+
+    if (listaZonas.size() + listaHorarios.size() > (size_t)MAX_CAMBIOS_POR_LOTE)
+    {
+        responderError(413, "lote", -1);
+        return;
+    }
+
+    CambioZona cambios[MAX_CAMBIOS_POR_LOTE];
+    int cantidad = 0;
+    for (JsonVariant cambio : listaZonas)
+    {
+        int indiceZona = cambio["zona"] | -1;
+        if (indiceZona < 0 || indiceZona >= CANTIDAD_ZONAS)
+        {
+            responderError(400, "zona", cantidad);
+            return;
+        }
+        // 1, "true" o la falta del campo no valen como orden: serían un apagado
+        if (!cambio["on"].is<bool>())
+        {
+            responderError(400, "on", cantidad);
+            return;
+        }
+        cambios[cantidad].zona = indiceZona;
+        cambios[cantidad].encender = cambio["on"].as<bool>();
+        cantidad++;
+    }
+
+    // Los horarios se convierten a minutos aquí, una sola vez
+    int indicesHorario[MAX_CAMBIOS_POR_LOTE];
+    Horario horarios[MAX_CAMBIOS_POR_LOTE];
+    int posicion = 0;
+    for (JsonVariant horario : listaHorarios)
+    {
+        indicesHorario[posicion] = horario["indice"] | -1;
+        if (indicesHorario[posicion] < 0 || indicesHorario[posicion] >= CANTIDAD_HORARIOS ||
+            !parsearHora(horario["inicio"] | "", horarios[posicion].inicio) ||
+            !parsearHora(horario["fin"] | "", horarios[posicion].fin))
+        {
+            responderError(400, "horario", posicion);
+            return;
+        }
+        posicion++;
+    }
+
+    uint32_t idTraza = iniciarTraza(ORIGEN_API, cantidad == 1 ? cambios[0].zona : -1);
+    if (!encolarCambiosZonas(cambios, cantidad, idTraza))
+    {
+        terminarRecepcionTraza();
+        responderError(503, "cola", -1);
+        return;
+    }
+    for (int i = 0; i < posicion; i++)
+    {
+        establecerHorario(indicesHorario[i], horarios[i].inicio, horarios[i].fin);
+    }
+    terminarRecepcionTraza();
+    unsigned long encolado = millis();
+
+    // Los cambios de zona se difunden cuando el loop los aplica
+    if (posicion > 0)
+    {
+        enviarEstadoPorSocketWeb();
+    }
+
+    // Los cambios de zona solo quedaron en la cola; los horarios ya rigen
+    char respuesta[112];
+    snprintf(respuesta, sizeof(respuesta), "{\"ok\":true,\"encolados\":%d,\"horarios\":%d,\"encolado\":%lu,\"traza\":%u}",
+             cantidad, posicion, encolado, (unsigned)idTraza);
+    servidor.send(200, "application/json", respuesta);
+}
+
+static void formatearEtag(char *destino, size_t capacidad, uint32_t generacion)
+{
+    snprintf(destino, capacidad, "\"%lu\"", (unsigned long)generacion);
+}
+
+// GET /api/state
+// Devuelve el mismo JSON que el WebSocket con ETag = generación de estado.
+// Con If-None-Match igual a la generación actual responde 304 sin cuerpo. En
+// el puerto 80 siempre responde en el acto: WebServer atiende un cliente a la
+// vez y retener uno lo dejaría esperando el cierre. El long-poll con
+// ?wait=<segundos> se atiende en PUERTO_EVENTOS (atenderPeticionEstado).
+// Los campos derivados del reloj (hora, countdown, movimiento) se calculan al
+// responder y no avanzan la generación.
+void manejarApiEstado()
+{
+    char etag[16];
+    formatearEtag(etag, sizeof(etag), generacionEstado);
+
+    if (servidor.header("If-None-Match") == etag)
+    {
+        servidor.sendHeader("ETag", etag);
+        servidor.send(304);
+        return;
+    }
+
+    JsonDocument documento;
+    construirEstadoJson(documento);
+    String cadenaJson;
+    serializeJson(documento, cadenaJson);
+
+    servidor.sendHeader("ETag", etag);
+    servidor.sendHeader("Cache-Control", "no-cache");
+    servidor.send(200, "application/json", cadenaJson);
+}
+
+// Respuesta escrita directamente en el socket; cadenaJson se serializa la
+// primera vez que hace falta y se reutiliza
+static void responderEstado(WiFiClient &cliente, bool modificado, String &cadenaJson)
+{
+    char etag[16];
+    formatearEtag(etag, sizeof(etag), generacionEstado);
+    if (!modificado)
+    {
+        cliente.printf("HTTP/1.1 304 Not Modified\r\nETag: %s\r\nConnection: close\r\n\r\n", etag);
+    }
+    else
+    {
+        if (cadenaJson.length() == 0)
+        {
+            JsonDocument documento;
+            construirEstadoJson(documento);
+            serializeJson(documento, cadenaJson);
+        }
+        cliente.printf("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nETag: %s\r\n"
+                       "Cache-Control: no-cache\r\nContent-Length: %u\r\nConnection: close\r\n\r\n",
+                       etag, (unsigned)cadenaJson.length());
+        cliente.print(cadenaJson);
+    }
+    cliente.stop();
+}
+
+// GET /api/state en PUERTO_EVENTOS (lo despacha sse.cpp). Igual que en el
+// puerto 80, pero si el estado no cambió y se pasa ?wait=<segundos> retiene la
+// conexión hasta que cambie (200) o venza la espera (304).
+void atenderPeticionEstado(WiFiClient &cliente, const char *consulta, const char *siNoCoincide)
+{
+    char etag[16];
+    formatearEtag(etag, sizeof(etag), generacionEstado);
+    String cadenaJson;
+    if (strcmp(siNoCoincide, etag) != 0)
+    {
+        responderEstado(cliente, true, cadenaJson);
+        return;
+    }
+
+    const char *parametro = strstr(consulta, "wait=");
+    while (parametro != nullptr && parametro != consulta && parametro[-1] != '&')
+    {
+        parametro = strstr(parametro + 1, "wait=");
+    }
+    long espera = parametro != nullptr ? strtol(parametro + 5, nullptr, 10) : 0;
+    if (espera > 0)
+    {
+        for (int i = 0; i < MAX_ESPERAS_ESTADO; i++)
+        {
+            if (!esperasEstado[i].activa)
+            {
+                esperasEstado[i].cliente = cliente;
+                esperasEstado[i].generacion = generacionEstado;
+                esperasEstado[i].limite = millis() + (unsigned long)min(espera, (long)ESPERA_MAXIMA_ESTADO_S) * 1000UL;
+                esperasEstado[i].activa = true;
+                // La respuesta se escribe desde atenderEsperasEstado()
+                return;
+            }
+        }
+        // Sin espacio para retener: se comporta como un GET condicional normal
+    }
+    responderEstado(cliente, false, cadenaJson);
+}
+
+// Llamado en cada vuelta de loop(): responde a las esperas vencidas o cuyo estado cambió.
+// El JSON se serializa una sola vez para todos los clientes que lo necesiten.
+void atenderEsperasEstado()
+{
+    String cadenaJson;
+    unsigned long ahora = millis();
+
+    for (int i = 0; i < MAX_ESPERAS_ESTADO; i++)
+    {
+        EsperaEstado &espera = esperasEstado[i];
+        if (!espera.activa)
+        {
+            continue;
+        }
+        if (!espera.cliente.connected())
+        {
+            espera.cliente.stop();
+            espera.activa = false;
+            continue;
+        }
+
+        bool modificado = espera.generacion != generacionEstado;
+        if (modificado || (long)(ahora - espera.limite) >= 0)
+        {
+            responderEstado(espera.cliente, modificado, cadenaJson);
+            espera.activa = false;
+        }
+    }
+}
+
+ContadorPeticionesHttp contadorPeticionesHttp;
+
+bool ContadorPeticionesHttp::canHandle(HTTPMethod method, String uri)
+{
+    (void)method;
+    (void)uri;
+    incrementarContador(CONTADOR_PETICIONES_HTTP);
+    return false;
+}
+
+static const char *const nombresEtapasTraza[CANTIDAD_ETAPAS_TRAZA] = {"aplicar", "publicar", "total"};
+
+// GET /metrics (formato de texto de Prometheus 0.0.4)
+void manejarMetricas()
+{
+    servidor.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    servidor.send(200, "text/plain; version=0.0.4", "");
+
+    EscritorRespuesta escritor;
+    for (int i = 0; i < CANTIDAD_CONTADORES; i++)
+    {
+        escritor.agregar("# HELP %s %s\n# TYPE %s counter\n%s %lu\n",
+                         descripcionesContadores[i].nombre, descripcionesContadores[i].ayuda,
+                         descripcionesContadores[i].nombre, descripcionesContadores[i].nombre,
+                         (unsigned long)contadores[i].load(std::memory_order_relaxed));
+    }
+
+    escritor.agregar("# HELP sdi_conmutaciones_relay_total Cambios de estado de los relays por zona\n"
+                     "# TYPE sdi_conmutaciones_relay_total counter\n");
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        escritor.agregar("sdi_conmutaciones_relay_total{zona=\"%d\"} %lu\n",
+                         i + 1, (unsigned long)conmutacionesRelay[i].load(std::memory_order_relaxed));
+    }
+
+    const Configuracion &politicas = configuracionActual();
+    escritor.agregar("# HELP sdi_timeout_zona_segundos Timeout de apagado automático en uso por zona\n"
+                     "# TYPE sdi_timeout_zona_segundos gauge\n");
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        escritor.agregar("sdi_timeout_zona_segundos{zona=\"%d\"} %lu\n",
+                         i + 1, (unsigned long)(politicas.tiempoMaximoEncendidoMs[i] / 1000));
+    }
+
+    for (int i = 0; i < CANTIDAD_MEDIDORES; i++)
+    {
+        escritor.agregar("# HELP %s %s\n# TYPE %s gauge\n%s %ld\n",
+                         descripcionesMedidores[i].nombre, descripcionesMedidores[i].ayuda,
+                         descripcionesMedidores[i].nombre, descripcionesMedidores[i].nombre,
+                         (long)medidores[i].load(std::memory_order_relaxed));
+    }
+
+    escritor.agregar("# TYPE sdi_generacion_estado gauge\nsdi_generacion_estado %lu\n", (unsigned long)generacionEstado);
+    const MuestraMemoria &memoria = ultimaMuestraMemoria();
+    escritor.agregar("# TYPE sdi_heap_libre_bytes gauge\nsdi_heap_libre_bytes %u\n", ESP.getFreeHeap());
+    escritor.agregar("# TYPE sdi_heap_bloque_maximo_bytes gauge\nsdi_heap_bloque_maximo_bytes %lu\n", (unsigned long)memoria.bloqueMaximo);
+    escritor.agregar("# TYPE sdi_heap_minimo_bytes gauge\nsdi_heap_minimo_bytes %lu\n", (unsigned long)memoria.heapMinimo);
+    escritor.agregar("# TYPE sdi_uptime_segundos gauge\nsdi_uptime_segundos %lu\n", millis() / 1000);
+    escritor.agregar("# HELP sdi_eventos_bitacora_total Eventos anotados en la bitácora\n"
+                     "# TYPE sdi_eventos_bitacora_total counter\nsdi_eventos_bitacora_total %lu\n"
+                     "# HELP sdi_eventos_bitacora_perdidos_total Eventos descartados antes de llegar a LittleFS\n"
+                     "# TYPE sdi_eventos_bitacora_perdidos_total counter\nsdi_eventos_bitacora_perdidos_total %lu\n",
+                     (unsigned long)eventosRegistrados(), (unsigned long)eventosPerdidos());
+    const EstadisticasPersistencia &persistencia = estadisticasPersistencia();
+    escritor.agregar("# HELP sdi_escrituras_nvs_total Claves escritas en NVS\n"
+                     "# TYPE sdi_escrituras_nvs_total counter\nsdi_escrituras_nvs_total %lu\n"
+                     "# HELP sdi_escrituras_nvs_omitidas_total Claves marcadas sin cambios reales\n"
+                     "# TYPE sdi_escrituras_nvs_omitidas_total counter\nsdi_escrituras_nvs_omitidas_total %lu\n"
+                     "# TYPE sdi_escritura_nvs_maxima_us gauge\nsdi_escritura_nvs_maxima_us %lu\n",
+                     (unsigned long)persistencia.escrituras, (unsigned long)persistencia.omitidas,
+                     (unsigned long)persistencia.maximaEscrituraUs);
+    escritor.agregar("# HELP sdi_escrituras_nvs_fallidas_total Escrituras rechazadas por NVS, reintentadas en el siguiente volcado\n"
+                     "# TYPE sdi_escrituras_nvs_fallidas_total counter\nsdi_escrituras_nvs_fallidas_total %lu\n",
+                     (unsigned long)persistencia.fallidas);
+    escritor.agregar("# HELP sdi_deriva_reloj_ppb Corrección de deriva del reloj aprendida de las sincronizaciones\n"
+                     "# TYPE sdi_deriva_reloj_ppb gauge\nsdi_deriva_reloj_ppb %ld\n",
+                     (long)derivaRelojPpb());
+    const EstadisticasConfiguracion &configuracion = estadisticasConfiguracion();
+    escritor.agregar("# TYPE sdi_configuracion_version gauge\nsdi_configuracion_version %lu\n"
+                     "# HELP sdi_configuracion_diferidas_total Publicaciones de configuración que esperaron un período de gracia\n"
+                     "# TYPE sdi_configuracion_diferidas_total counter\nsdi_configuracion_diferidas_total %lu\n",
+                     (unsigned long)configuracion.version, (unsigned long)configuracion.diferidas);
+    escritor.agregar("# HELP sdi_arranque_us Microsegundos desde el reinicio hasta cada hito del arranque\n"
+                     "# TYPE sdi_arranque_us gauge\n");
+    for (int i = 0; i < CANTIDAD_HITOS_ARRANQUE; i++)
+    {
+        escritor.agregar("sdi_arranque_us{hito=\"%s\"} %lu\n", nombreHitoArranque(i), (unsigned long)hitoArranqueUs(i));
+    }
+
+    escritor.agregar("# HELP sdi_latencia_comando_us Latencia de comandos por etapa en microsegundos\n"
+                     "# TYPE sdi_latencia_comando_us histogram\n");
+    for (int etapa = 0; etapa < CANTIDAD_ETAPAS_TRAZA; etapa++)
+    {
+        const HistogramaLatencia &histograma = histogramaLatencia((EtapaTraza)etapa);
+        unsigned long acumulado = 0;
+        for (int i = 0; i < CUBETAS_LATENCIA - 1; i++)
+        {
+            acumulado += histograma.cubetas[i];
+            escritor.agregar("sdi_latencia_comando_us_bucket{etapa=\"%s\",le=\"%lu\"} %lu\n",
+                             nombresEtapasTraza[etapa], (unsigned long)limiteCubetaLatencia(i), acumulado);
+        }
+        escritor.agregar("sdi_latencia_comando_us_bucket{etapa=\"%s\",le=\"+Inf\"} %lu\n"
+                         "sdi_latencia_comando_us_sum{etapa=\"%s\"} %llu\n"
+                         "sdi_latencia_comando_us_count{etapa=\"%s\"} %lu\n",
+                         nombresEtapasTraza[etapa], (unsigned long)histograma.cantidad,
+                         nombresEtapasTraza[etapa], (unsigned long long)histograma.sumaMicros,
+                         nombresEtapasTraza[etapa], (unsigned long)histograma.cantidad);
+    }
+
+    const EstadisticasPlanificador &planificador = estadisticasPlanificador();
+    escritor.agregar("# HELP sdi_latencia_control_us Separación entre pasadas de las tareas de control del loop\n"
+                     "# TYPE sdi_latencia_control_us histogram\n");
+    unsigned long acumulado = 0;
+    for (int i = 0; i < CUBETAS_LATENCIA - 1; i++)
+    {
+        acumulado += planificador.latenciaControl.cubetas[i];
+        escritor.agregar("sdi_latencia_control_us_bucket{le=\"%lu\"} %lu\n", (unsigned long)limiteCubetaLatencia(i), acumulado);
+    }
+    escritor.agregar("sdi_latencia_control_us_bucket{le=\"+Inf\"} %lu\n"
+                     "sdi_latencia_control_us_sum %llu\nsdi_latencia_control_us_count %lu\n"
+                     "# TYPE sdi_latencia_control_maxima_us gauge\nsdi_latencia_control_maxima_us %lu\n"
+                     "# HELP sdi_vueltas_con_pendientes_total Vueltas del loop que dejaron tareas a mitad de trabajo\n"
+                     "# TYPE sdi_vueltas_con_pendientes_total counter\nsdi_vueltas_con_pendientes_total %lu\n",
+                     (unsigned long)planificador.latenciaControl.cantidad,
+                     (unsigned long long)planificador.latenciaControl.sumaMicros,
+                     (unsigned long)planificador.latenciaControl.cantidad,
+                     (unsigned long)planificador.latenciaControlMaximaUs,
+                     (unsigned long)planificador.vueltasConPendientes);
+    escritor.vaciar();
+    servidor.sendContent("");
+}
+
+// GET /api/memoria: muestra actual, pila libre mínima por tarea e historial
+void manejarApiMemoria()
+{
+    servidor.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    servidor.send(200, "application/json", "");
+
+    EscritorRespuesta escritor;
+    const MuestraMemoria &actual = ultimaMuestraMemoria();
+    escritor.agregar("{\"heapLibre\":%lu,\"bloqueMaximo\":%lu,\"heapMinimo\":%lu,\"tareas\":[",
+                     (unsigned long)actual.heapLibre, (unsigned long)actual.bloqueMaximo, (unsigned long)actual.heapMinimo);
+
+    PilaTarea pilas[8];
+    int cantidadPilas = obtenerPilasTareas(pilas, 8);
+    for (int i = 0; i < cantidadPilas; i++)
+    {
+        escritor.agregar("%s{\"nombre\":\"%s\",\"pilaLibreMinima\":%lu}",
+                         i ? "," : "", pilas[i].nombre, (unsigned long)pilas[i].libreMinima);
+    }
+
+    // Historial en columnas [segundos, libre, bloqueMaximo, minimo] para mantenerlo compacto
+    escritor.agregar("],\"historial\":[");
+    MuestraMemoria historial[MUESTRAS_MEMORIA];
+    int cantidad = obtenerHistorialMemoria(historial, MUESTRAS_MEMORIA);
+    for (int i = 0; i < cantidad; i++)
+    {
+        escritor.agregar("%s[%lu,%lu,%lu,%lu]", i ? "," : "",
+                         (unsigned long)historial[i].segundosActivo, (unsigned long)historial[i].heapLibre,
+                         (unsigned long)historial[i].bloqueMaximo, (unsigned long)historial[i].heapMinimo);
+    }
+    escritor.agregar("]}");
+    escritor.vaciar();
+    servidor.sendContent("");
+}
+
+// GET /api/trazas: histogramas de latencia y las últimas trazas de comandos
+// Cada traza va en columnas [id, origen, zona, aplicar_us, publicar_us]; -1 si aún no ocurrió
+void manejarApiTrazas()
+{
+    servidor.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    servidor.send(200, "application/json", "");
+
+    EscritorRespuesta escritor;
+    escritor.agregar("{\"limites\":[");
+    for (int i = 0; i < CUBETAS_LATENCIA - 1; i++)
+    {
+        escritor.agregar("%s%lu", i ? "," : "", (unsigned long)limiteCubetaLatencia(i));
+    }
+
+    escritor.agregar("],\"histogramas\":{");
+    for (int etapa = 0; etapa < CANTIDAD_ETAPAS_TRAZA; etapa++)
+    {
+        const HistogramaLatencia &histograma = histogramaLatencia((EtapaTraza)etapa);
+        escritor.agregar("%s\"%s\":{\"cantidad\":%lu,\"sumaUs\":%llu,\"cubetas\":[",
+                         etapa ? "," : "", nombresEtapasTraza[etapa], (unsigned long)histograma.cantidad,
+                         (unsigned long long)histograma.sumaMicros);
+        for (int i = 0; i < CUBETAS_LATENCIA; i++)
+        {
+            escritor.agregar("%s%lu", i ? "," : "", (unsigned long)histograma.cubetas[i]);
+        }
+        escritor.agregar("]}");
+    }
+
+    escritor.agregar("},\"recientes\":[");
+    Traza trazas[TRAZAS_RECIENTES];
+    int cantidad = obtenerTrazasRecientes(trazas, TRAZAS_RECIENTES);
+    for (int i = 0; i < cantidad; i++)
+    {
+        long aplicar = trazas[i].aplicado ? (long)(trazas[i].aplicado - trazas[i].recibido) : -1;
+        long publicar = trazas[i].publicado ? (long)(trazas[i].publicado - trazas[i].aplicado) : -1;
+        escritor.agregar("%s[%lu,\"%s\",%d,%ld,%ld]", i ? "," : "", (unsigned long)trazas[i].id,
+                         nombreOrigenComando(trazas[i].origen), trazas[i].zona, aplicar, publicar);
+    }
+    escritor.agregar("]}");
+    escritor.vaciar();
+    servidor.sendContent("");
+}
+
+// GET /api/vigilancia: presupuesto y máximo por etapa del loop en este arranque
+// y los excesos guardados en RTC, también los de arranques anteriores.
+// Excesos en columnas [arranque, segundos, etapa, ms, reinicio]
+void manejarApiVigilancia()
+{
+    servidor.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    servidor.send(200, "application/json", "");
+
+    EscritorRespuesta escritor;
+    escritor.agregar("{\"arranque\":%lu,\"motivoReinicio\":\"%s\",\"etapas\":[",
+                     (unsigned long)numeroArranque(), motivoUltimoReinicio());
+    for (int i = 0; i < CANTIDAD_ETAPAS_LOOP; i++)
+    {
+        escritor.agregar("%s{\"nombre\":\"%s\",\"presupuestoMs\":%lu,\"maximoMs\":%lu}", i ? "," : "",
+                         nombreEtapaLoop(i), (unsigned long)presupuestoEtapaLoop(i), (unsigned long)maximoEtapaLoop(i));
+    }
+
+    escritor.agregar("],\"latenciaControlMaximaUs\":%lu,\"origenRelays\":\"%s\",\"hitosArranqueUs\":{",
+                     (unsigned long)estadisticasPlanificador().latenciaControlMaximaUs, origenRestauracionZonas());
+    for (int i = 0; i < CANTIDAD_HITOS_ARRANQUE; i++)
+    {
+        escritor.agregar("%s\"%s\":%lu", i ? "," : "", nombreHitoArranque(i), (unsigned long)hitoArranqueUs(i));
+    }
+
+    escritor.agregar("},\"excesos\":[");
+    ExcesoEtapa excesos[EXCESOS_GUARDADOS];
+    int cantidad = obtenerExcesosEtapas(excesos, EXCESOS_GUARDADOS);
+    for (int i = 0; i < cantidad; i++)
+    {
+        escritor.agregar("%s[%u,%lu,\"%s\",%lu,%s]", i ? "," : "", excesos[i].arranque,
+                         (unsigned long)excesos[i].segundosActivo, nombreEtapaLoop(excesos[i].etapa),
+                         (unsigned long)excesos[i].duracionMs, excesos[i].reinicio ? "true" : "false");
+    }
+    escritor.agregar("]}");
+    escritor.vaciar();
+    servidor.sendContent("");
+}
+
+// GET /log.bin?arranque=N&desde=S&hasta=S (segundos desde el arranque, todos opcionales)
+// Segmentos completos de tamaño fijo en orden de secuencia: primero los del
+// archivo y al final los que aún están en RAM, enviados desde su buffer.
+void manejarDescargaBitacora()
+{
+    uint32_t arranque = servidor.hasArg("arranque") ? servidor.arg("arranque").toInt() : 0;
+    uint32_t desde = servidor.hasArg("desde") ? servidor.arg("desde").toInt() * 10UL : 0;
+    uint32_t hasta = servidor.hasArg("hasta") ? servidor.arg("hasta").toInt() * 10UL : UINT32_MAX;
+
+    uint16_t ranuras[SEGMENTOS_BITACORA];
+    int cantidadArchivo = buscarSegmentosBitacora(arranque, desde, hasta, ranuras, SEGMENTOS_BITACORA);
+    SegmentoBitacora enRam[2];
+    int cantidadRam = segmentosRamEnRango(arranque, desde, hasta, enRam, 2);
+
+    servidor.setContentLength((cantidadArchivo + cantidadRam) * BYTES_SEGMENTO_BITACORA);
+    servidor.sendHeader("Content-Disposition", "attachment; filename=\"log.bin\"");
+    servidor.send(200, "application/octet-stream", "");
+
+    WiFiClient cliente = servidor.client();
+    uint8_t buffer[BYTES_SEGMENTO_BITACORA];
+    for (int i = 0; i < cantidadArchivo; i++)
+    {
+        // Un segmento ilegible se envía en ceros: el decodificador lo descarta por CRC
+        if (!leerSegmentoBitacora(ranuras[i], buffer))
+        {
+            memset(buffer, 0, sizeof(buffer));
+        }
+        cliente.write(buffer, sizeof(buffer));
+    }
+    for (int i = 0; i < cantidadRam; i++)
+    {
+        cliente.write(reinterpret_cast<const uint8_t *>(enRam[i].cabecera), sizeof(CabeceraSegmento));
+        cliente.write(reinterpret_cast<const uint8_t *>(enRam[i].registros), REGISTROS_POR_SEGMENTO * sizeof(RegistroEvento));
+    }
+}
+
+// GET /api/stats: por zona, minutos encendida y movimientos en cada hora de la
+// semana (168 valores, cubeta 0 = lunes 00:00) y tiempo medio hasta el apagado automático
+void manejarApiEstadisticas()
+{
+    servidor.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    servidor.send(200, "application/json", "");
+
+    EscritorRespuesta escritor;
+    escritor.agregar("{\"cubetaActual\":%d,\"zonas\":[", cubetaHoraSemana());
+    for (int zona = 0; zona < CANTIDAD_ZONAS; zona++)
+    {
+        const EstadisticasZona &estadisticas = estadisticasZona(zona);
+        unsigned long media = estadisticas.apagadosTimeout ? estadisticas.segundosHastaTimeout / estadisticas.apagadosTimeout : 0;
+        escritor.agregar("%s{\"nombre\":\"%s\",\"encendidos\":%lu,\"apagadosTimeout\":%lu,"
+                         "\"mediaHastaApagadoS\":%lu,\"minutosEncendida\":[",
+                         zona ? "," : "", zonas[zona].nombre.c_str(), (unsigned long)estadisticas.encendidos,
+                         (unsigned long)estadisticas.apagadosTimeout, media);
+        for (int i = 0; i < HORAS_SEMANA; i++)
+        {
+            escritor.agregar("%s%lu", i ? "," : "", (unsigned long)(estadisticas.milisegundosEncendida[i] / 60000));
+        }
+        escritor.agregar("],\"movimientos\":[");
+        for (int i = 0; i < HORAS_SEMANA; i++)
+        {
+            escritor.agregar("%s%lu", i ? "," : "", (unsigned long)estadisticas.movimientos[i]);
+        }
+        escritor.agregar("]}");
+    }
+    escritor.agregar("]}");
+    escritor.vaciar();
+    servidor.sendContent("");
+}
+
+// Milijulios a vatios-hora con tres decimales, sin coma flotante
+static void agregarWh(EscritorRespuesta &escritor, const char *clave, uint64_t milijulios)
+{
+    uint64_t miliWh = milijulios / 3600;
+    escritor.agregar(",\"%s\":%llu.%03u", clave, (unsigned long long)(miliWh / 1000), (unsigned)(miliWh % 1000));
+}
+
+// GET /api/energia: consumo acumulado y ahorro atribuido a cada regla por zona
+void manejarApiEnergia()
+{
+    servidor.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    servidor.send(200, "application/json", "");
+
+    EscritorRespuesta escritor;
+    escritor.agregar("{\"zonas\":[");
+    for (int zona = 0; zona < CANTIDAD_ZONAS; zona++)
+    {
+        const EnergiaZona &cuenta = energiaZona(zona);
+        escritor.agregar("%s{\"nombre\":\"%s\",\"potenciaW\":%u,\"segundosEncendida\":%llu", zona ? "," : "",
+                         zonas[zona].nombre.c_str(), cuenta.potenciaW,
+                         (unsigned long long)(cuenta.milisegundosEncendida / 1000));
+        agregarWh(escritor, "consumoWh", cuenta.consumoMj);
+        agregarWh(escritor, "ahorroTimeoutWh", cuenta.ahorroTimeoutMj);
+        agregarWh(escritor, "ahorroPirWh", cuenta.ahorroPirMj);
+        escritor.agregar("}");
+    }
+    escritor.agregar("]}");
+    escritor.vaciar();
+    servidor.sendContent("");
+}
+
+// PATCH /api/energia
+// Cuerpo: [{"zona":0,"watts":40},...]; se valida todo antes de aplicar
+void manejarConfiguracionEnergia()
+{
+    JsonDocument cuerpo;
+    if (deserializeJson(cuerpo, servidor.arg("plain")) || !cuerpo.is<JsonArray>())
+    {
+        responderError(400, "json", -1);
+        return;
+    }
+    JsonArray lista = cuerpo.as<JsonArray>();
+    int indice = 0;
+    for (JsonVariant cambio : lista)
+    {
+        int zona = cambio["zona"] | -1;
+        long vatios = cambio["watts"] | 0L;
+        if (zona < 0 || zona >= CANTIDAD_ZONAS || vatios <= 0 || vatios > 0xFFFF)
+        {
+            responderError(400, "watts", indice);
+            return;
+        }
+        indice++;
+    }
+    for (JsonVariant cambio : lista)
+    {
+        establecerPotenciaZona(cambio["zona"] | -1, (uint16_t)(cambio["watts"] | 0L));
+    }
+    servidor.send(200, "application/json", "{\"ok\":true}");
+}
+
+static void agregarIntervalos(EscritorRespuesta &escritor, const Horario intervalos[], int cantidad)
+{
+    char inicio[6], fin[6];
+    escritor.agregar("[");
+    for (int i = 0; i < cantidad; i++)
+    {
+        formatearHora(intervalos[i].inicio, inicio);
+        formatearHora(intervalos[i].fin, fin);
+        escritor.agregar("%s\"%s-%s\"", i ? "," : "", inicio, fin);
+    }
+    escritor.agregar("]");
+}
+
+// GET /api/calendario
+void manejarApiCalendario()
+{
+    const DefinicionCalendarios &definicion = definicionCalendarios();
+    servidor.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    servidor.send(200, "application/json", "");
+
+    EscritorRespuesta escritor;
+    char fecha[11];
+    formatearFecha(diaCalendarioActual(), fecha);
+    escritor.agregar("{\"hoy\":\"%s\",\"calendarios\":[", fecha);
+    for (int c = 0; c < CANTIDAD_CALENDARIOS; c++)
+    {
+        escritor.agregar("%s{\"laboral\":%s,\"dias\":[", c ? "," : "", esMinutoLaboral(c) ? "true" : "false");
+        for (int d = 0; d < 7; d++)
+        {
+            escritor.agregar(d ? "," : "");
+            agregarIntervalos(escritor, definicion.semana[c][d].intervalos, definicion.semana[c][d].cantidad);
+        }
+        escritor.agregar("]}");
+    }
+
+    escritor.agregar("],\"excepciones\":[");
+    for (int i = 0; i < definicion.cantidadExcepciones; i++)
+    {
+        const ExcepcionCalendario &excepcion = definicion.excepciones[i];
+        formatearFecha(excepcion.dia, fecha);
+        escritor.agregar("%s{\"fecha\":\"%s\",\"calendarios\":[", i ? "," : "", fecha);
+        bool primero = true;
+        for (int c = 0; c < CANTIDAD_CALENDARIOS; c++)
+        {
+            if (excepcion.calendarios & (1U << c))
+            {
+                escritor.agregar("%s%d", primero ? "" : ",", c);
+                primero = false;
+            }
+        }
+        escritor.agregar("],\"intervalos\":");
+        agregarIntervalos(escritor, excepcion.intervalos, excepcion.cantidad);
+        escritor.agregar("}");
+    }
+
+    escritor.agregar("],\"zonas\":[");
+    for (int z = 0; z < CANTIDAD_ZONAS; z++)
+    {
+        escritor.agregar("%s%u", z ? "," : "", definicion.calendarioZona[z]);
+    }
+    escritor.agregar("]}");
+    escritor.vaciar();
+    servidor.sendContent("");
+}
+
+static bool leerIntervalos(JsonArray lista, Horario destino[], uint8_t &cantidad)
+{
+    if (lista.isNull() || lista.size() > (size_t)INTERVALOS_POR_DIA_CALENDARIO)
+    {
+        return false;
+    }
+    cantidad = 0;
+    for (JsonVariant intervalo : lista)
+    {
+        if (!parsearIntervalo(intervalo | "", destino[cantidad]))
+        {
+            return false;
+        }
+        cantidad++;
+    }
+    return true;
+}
+
+// PATCH /api/calendario
+// Cuerpo (todas las listas opcionales):
+//   {"dias":[{"calendario":0,"dia":5,"intervalos":[]}],                     (dia 0 = lunes)
+//    "excepciones":[{"fecha":"2026-12-25","calendarios":[0,1],"intervalos":[]}],
+//    "borrar":["2026-12-25"],
+//    "zonas":[{"zona":1,"calendario":2}]}
+// Se aplica sobre una copia que se valida entera; si todo es válido se
+// compila y se activa de una vez, y si no, no cambia nada.
+void manejarConfiguracionCalendario()
+{
+    JsonDocument cuerpo;
+    if (deserializeJson(cuerpo, servidor.arg("plain")) || !cuerpo.is<JsonObject>())
+    {
+        responderError(400, "json", -1);
+        return;
+    }
+
+    static DefinicionCalendarios borrador;
+    borrador = definicionCalendarios();
+
+    int indice = 0;
+    for (JsonVariant cambio : cuerpo["dias"].as<JsonArray>())
+    {
+        int calendario = cambio["calendario"] | -1;
+        int dia = cambio["dia"] | -1;
+        if (calendario < 0 || calendario >= CANTIDAD_CALENDARIOS || dia < 0 || dia >= 7 ||
+            !leerIntervalos(cambio["intervalos"], borrador.semana[calendario][dia].intervalos,
+                            borrador.semana[calendario][dia].cantidad))
+        {
+            responderError(400, "dias", indice);
+            return;
+        }
+        indice++;
+    }
+
+    indice = 0;
+    for (JsonVariant fecha : cuerpo["borrar"].as<JsonArray>())
+    {
+        uint16_t dia;
+        if (!parsearFecha(fecha | "", dia))
+        {
+            responderError(400, "borrar", indice);
+            return;
+        }
+        borrarExcepciones(borrador, dia);
+        indice++;
+    }
+
+    indice = 0;
+    for (JsonVariant cambio : cuerpo["excepciones"].as<JsonArray>())
+    {
+        ExcepcionCalendario excepcion = {};
+        bool valida = parsearFecha(cambio["fecha"] | "", excepcion.dia) &&
+                      leerIntervalos(cambio["intervalos"], excepcion.intervalos, excepcion.cantidad);
+        for (JsonVariant calendario : cambio["calendarios"].as<JsonArray>())
+        {
+            int numero = calendario | -1;
+            valida = valida && numero >= 0 && numero < CANTIDAD_CALENDARIOS;
+            excepcion.calendarios |= valida ? (1U << numero) : 0;
+        }
+        if (!valida || excepcion.calendarios == 0)
+        {
+            responderError(400, "excepciones", indice);
+            return;
+        }
+        if (!agregarExcepcion(borrador, excepcion))
+        {
+            responderError(409, "excepciones", indice);
+            return;
+        }
+        indice++;
+    }
+
+    indice = 0;
+    for (JsonVariant cambio : cuerpo["zonas"].as<JsonArray>())
+    {
+        int zona = cambio["zona"] | -1;
+        int calendario = cambio["calendario"] | -1;
+        if (zona < 0 || zona >= CANTIDAD_ZONAS || calendario < 0 || calendario >= CANTIDAD_CALENDARIOS)
+        {
+            responderError(400, "zonas", indice);
+            return;
+        }
+        borrador.calendarioZona[zona] = calendario;
+        indice++;
+    }
+
+    if (!publicarCalendarios(borrador))
+    {
+        responderError(400, "calendario", -1);
+        return;
+    }
+    enviarEstadoPorSocketWeb();
+    servidor.send(200, "application/json", "{\"ok\":true}");
+}
+
+// GET /api/configuracion: versión de la instantánea en uso y política de cada zona
+void manejarApiConfiguracion()
+{
+    servidor.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    servidor.send(200, "application/json", "");
+
+    // Todo sale de la misma instantánea aunque se publique otra mientras se responde
+    const Configuracion &configuracion = configuracionActual();
+    const EstadisticasConfiguracion &estadisticas = estadisticasConfiguracion();
+    EscritorRespuesta escritor;
+    escritor.agregar("{\"version\":%lu,\"publicaciones\":%lu,\"diferidas\":%lu,\"pendiente\":%s,\"zonas\":[",
+                     (unsigned long)configuracion.version, (unsigned long)estadisticas.publicaciones,
+                     (unsigned long)estadisticas.diferidas, estadisticas.pendiente ? "true" : "false");
+    for (int zona = 0; zona < CANTIDAD_ZONAS; zona++)
+    {
+        EstadoAdaptacion adaptacion = estadoAdaptacion(zona);
+        escritor.agregar("%s{\"nombre\":\"%s\",\"calendario\":%u,\"timeoutS\":%lu,\"adaptativo\":%s,"
+                         "\"muestras\":%lu,\"cuantilPausaMs\":%lu,\"timeoutObjetivoS\":%lu,\"apagadosEnFalso\":%lu}",
+                         zona ? "," : "", zonas[zona].nombre.c_str(), configuracion.calendarios.calendarioZona[zona],
+                         (unsigned long)(configuracion.tiempoMaximoEncendidoMs[zona] / 1000),
+                         adaptacion.activa ? "true" : "false", (unsigned long)adaptacion.muestras,
+                         (unsigned long)adaptacion.cuantilPausaMs, (unsigned long)adaptacion.timeoutObjetivoS,
+                         (unsigned long)adaptacion.apagadosEnFalso);
+    }
+    escritor.agregar("]}");
+    escritor.vaciar();
+    servidor.sendContent("");
+}
+
+// PATCH /api/configuracion
+// Cuerpo: [{"zona":0,"timeoutS":600},{"zona":1,"adaptativo":true},...]; se valida
+// todo antes de aplicar. Un timeoutS sin "adaptativo" deja la zona en timeout fijo.
+void manejarConfiguracionPoliticas()
+{
+    JsonDocument cuerpo;
+    if (deserializeJson(cuerpo, servidor.arg("plain")) || !cuerpo.is<JsonArray>())
+    {
+        responderError(400, "json", -1);
+        return;
+    }
+    JsonArray lista = cuerpo.as<JsonArray>();
+    int indice = 0;
+    for (JsonVariant cambio : lista)
+    {
+        int zona = cambio["zona"] | -1;
+        bool hayTimeout = !cambio["timeoutS"].isNull();
+        bool hayAdaptativo = cambio["adaptativo"].is<bool>();
+        long segundos = cambio["timeoutS"] | 0L;
+        if (zona < 0 || zona >= CANTIDAD_ZONAS || (!hayTimeout && !hayAdaptativo) ||
+            (hayTimeout && (segundos < (long)TIMEOUT_MINIMO_S || segundos > (long)TIMEOUT_MAXIMO_S)))
+        {
+            responderError(400, hayAdaptativo && !hayTimeout ? "zona" : "timeoutS", indice);
+            return;
+        }
+        indice++;
+    }
+    for (JsonVariant cambio : lista)
+    {
+        int zona = cambio["zona"] | -1;
+        if (!cambio["timeoutS"].isNull())
+        {
+            establecerTimeoutZona(zona, (uint32_t)(cambio["timeoutS"] | 0L));
+        }
+        fijarAdaptacionZona(zona, cambio["adaptativo"] | false);
+    }
+    enviarEstadoPorSocketWeb();
+
+    char respuesta[48];
+    snprintf(respuesta, sizeof(respuesta), "{\"ok\":true,\"version\":%lu}",
+             (unsigned long)estadisticasConfiguracion().version);
+    servidor.send(200, "application/json", respuesta);
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <WebServer.h>
+#include <WiFi.h>
+
+// API JSON para scripts de automatización (complementa los formularios /on, /off, /update, /settime)
+void manejarApiZonas();
+void manejarApiEstado();
+void atenderPeticionEstado(WiFiClient &cliente, const char *consulta, const char *siNoCoincide);
+void atenderEsperasEstado();
+void manejarMetricas();
+void manejarApiMemoria();
+void manejarApiTrazas();
+void manejarApiVigilancia();
+void manejarDescargaBitacora();
+void manejarApiEstadisticas();
+void manejarApiEnergia();
+void manejarConfiguracionEnergia();
+void manejarApiCalendario();
+void manejarConfiguracionCalendario();
+void manejarApiConfiguracion();
+void manejarConfiguracionPoliticas();
+
+// Primer handler registrado: solo cuenta la petición y deja que la atienda el handler real
+class ContadorPeticionesHttp : public RequestHandler
+{
+public:
+    bool canHandle(HTTPMethod method, String uri) override;
+};
+
+extern ContadorPeticionesHttp contadorPeticionesHttp;
@@ -0,0 +1,306 @@
+#include "bitacora.h"
+#include "config.h"
+#ifdef ARDUINO
+#include <LittleFS.h>
+#endif
+
+struct SegmentoRam
+{
+    CabeceraSegmento cabecera;
+    RegistroEvento registros[REGISTROS_POR_SEGMENTO];
+    uint32_t finDecimas;
+    uint16_t persistidos;   // Registros que ya están en el archivo
+    bool cerrado;
+};
+
+static const int SEGMENTOS_RAM = 2;
+static SegmentoRam segmentosRam[SEGMENTOS_RAM];
+static int segmentoAbierto = 0;
+static EntradaIndiceBitacora indice[SEGMENTOS_BITACORA];
+static uint32_t siguienteSecuencia = 1;
+static uint32_t arranqueActual = 0;
+static uint32_t totalEventos = 0;
+static uint32_t totalPerdidos = 0;
+
+static void abrirSegmento(SegmentoRam &segmento, uint32_t ahora)
+{
+    memset(&segmento, 0, sizeof(segmento));
+    segmento.cabecera.magia = MAGIA_SEGMENTO_BITACORA;
+    segmento.cabecera.secuencia = siguienteSecuencia++;
+    segmento.cabecera.arranque = arranqueActual;
+    segmento.cabecera.inicioDecimas = ahora;
+    segmento.finDecimas = ahora;
+}
+
+static void cerrarSegmentoAbierto()
+{
+    segmentosRam[segmentoAbierto].cerrado = true;
+    segmentoAbierto = (segmentoAbierto + 1) % SEGMENTOS_RAM;
+
+    // Si el siguiente buffer aún no llegó al archivo (LittleFS ausente o lento) se pierde
+    SegmentoRam &siguiente = segmentosRam[segmentoAbierto];
+    if (siguiente.cabecera.cantidad > siguiente.persistidos)
+    {
+        totalPerdidos += siguiente.cabecera.cantidad - siguiente.persistidos;
+    }
+    siguiente.cabecera.cantidad = 0;
+    siguiente.cerrado = false;
+}
+
+void registrarEvento(TipoEvento tipo, int zona)
+{
+    uint32_t ahora = millis() / 100;
+    SegmentoRam *segmento = &segmentosRam[segmentoAbierto];
+    if (segmento->cabecera.cantidad == 0)
+    {
+        abrirSegmento(*segmento, ahora);
+    }
+
+    // Pausas largas: registros de salto mientras quede lugar; si no, segmento nuevo
+    uint32_t delta = ahora - segmento->finDecimas;
+    while (delta > DELTA_MAXIMO_BITACORA && segmento->cabecera.cantidad < REGISTROS_POR_SEGMENTO - 1)
+    {
+        segmento->registros[segmento->cabecera.cantidad++] = {DELTA_MAXIMO_BITACORA, EVENTO_SALTO, 0};
+        delta -= DELTA_MAXIMO_BITACORA;
+    }
+    if (delta > DELTA_MAXIMO_BITACORA)
+    {
+        cerrarSegmentoAbierto();
+        segmento = &segmentosRam[segmentoAbierto];
+        abrirSegmento(*segmento, ahora);
+        delta = 0;
+    }
+
+    segmento->registros[segmento->cabecera.cantidad++] = {(uint16_t)delta, (uint8_t)tipo, (uint8_t)zona};
+    segmento->finDecimas = ahora;
+    totalEventos++;
+
+    if (segmento->cabecera.cantidad == REGISTROS_POR_SEGMENTO)
+    {
+        cerrarSegmentoAbierto();
+    }
+}
+
+static bool segmentoEnRango(uint32_t arranqueSegmento, uint32_t inicio, uint32_t fin,
+                            uint32_t arranque, uint32_t desde, uint32_t hasta)
+{
+    return (arranque == 0 || arranqueSegmento == arranque) && inicio <= hasta && fin >= desde;
+}
+
+static bool secuenciaEnRam(uint32_t secuencia)
+{
+    for (int i = 0; i < SEGMENTOS_RAM; i++)
+    {
+        if (segmentosRam[i].cabecera.cantidad > 0 && segmentosRam[i].cabecera.secuencia == secuencia)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+int buscarSegmentosBitacora(uint32_t arranque, uint32_t desde, uint32_t hasta, uint16_t ranuras[], int capacidad)
+{
+    int cantidad = 0;
+    for (uint16_t ranura = 0; ranura < SEGMENTOS_BITACORA && cantidad < capacidad; ranura++)
+    {
+        const EntradaIndiceBitacora &entrada = indice[ranura];
+        if (entrada.secuencia == 0 || secuenciaEnRam(entrada.secuencia) ||
+            !segmentoEnRango(entrada.arranque, entrada.inicioDecimas, entrada.finDecimas, arranque, desde, hasta))
+        {
+            continue;
+        }
+
+        // Inserción ordenada por secuencia: el archivo es circular
+        int posicion = cantidad++;
+        while (posicion > 0 && indice[ranuras[posicion - 1]].secuencia > entrada.secuencia)
+        {
+            ranuras[posicion] = ranuras[posicion - 1];
+            posicion--;
+        }
+        ranuras[posicion] = ranura;
+    }
+    return cantidad;
+}
+
+int segmentosRamEnRango(uint32_t arranque, uint32_t desde, uint32_t hasta, SegmentoBitacora destino[], int capacidad)
+{
+    int cantidad = 0;
+    // El segmento que no está abierto es el más antiguo
+    for (int i = 1; i <= SEGMENTOS_RAM && cantidad < capacidad; i++)
+    {
+        SegmentoRam &segmento = segmentosRam[(segmentoAbierto + i) % SEGMENTOS_RAM];
+        if (segmento.cabecera.cantidad == 0 ||
+            !segmentoEnRango(segmento.cabecera.arranque, segmento.cabecera.inicioDecimas, segmento.finDecimas,
+                             arranque, desde, hasta))
+        {
+            continue;
+        }
+        segmento.cabecera.crc = calcularCrcSegmento(segmento.cabecera, segmento.registros);
+        destino[cantidad].cabecera = &segmento.cabecera;
+        destino[cantidad].registros = segmento.registros;
+        cantidad++;
+    }
+    return cantidad;
+}
+
+uint32_t eventosRegistrados()
+{
+    return totalEventos;
+}
+
+uint32_t eventosPerdidos()
+{
+    return totalPerdidos;
+}
+
+#ifdef ARDUINO
+static const char *const RUTA_BITACORA = "/bitacora.bin";
+static bool archivoListo = false;
+static unsigned long ultimoVolcado = 0;
+
+static void actualizarIndice(uint16_t ranura, const CabeceraSegmento &cabecera, const RegistroEvento registros[])
+{
+    uint32_t fin = cabecera.inicioDecimas;
+    for (int i = 0; i < cabecera.cantidad; i++)
+    {
+        fin += registros[i].deltaDecimas;
+    }
+    indice[ranura] = {cabecera.secuencia, cabecera.arranque, cabecera.inicioDecimas, fin};
+}
+
+bool leerSegmentoBitacora(uint16_t ranura, uint8_t destino[BYTES_SEGMENTO_BITACORA])
+{
+    if (!archivoListo || ranura >= SEGMENTOS_BITACORA)
+    {
+        return false;
+    }
+    File archivo = LittleFS.open(RUTA_BITACORA, "r");
+    bool ok = archivo && archivo.seek(ranura * BYTES_SEGMENTO_BITACORA) &&
+              archivo.read(destino, BYTES_SEGMENTO_BITACORA) == BYTES_SEGMENTO_BITACORA;
+    archivo.close();
+    return ok;
+}
+
+static bool escribirSegmento(SegmentoRam &segmento)
+{
+    uint16_t ranura = segmento.cabecera.secuencia % SEGMENTOS_BITACORA;
+    segmento.cabecera.crc = calcularCrcSegmento(segmento.cabecera, segmento.registros);
+
+    File archivo = LittleFS.open(RUTA_BITACORA, "r+");
+    bool ok = archivo && archivo.seek(ranura * BYTES_SEGMENTO_BITACORA) &&
+              archivo.write(reinterpret_cast<const uint8_t *>(&segmento.cabecera), sizeof(CabeceraSegmento)) == sizeof(CabeceraSegmento) &&
+              archivo.write(reinterpret_cast<const uint8_t *>(segmento.registros), sizeof(segmento.registros)) == sizeof(segmento.registros);
+    archivo.close();
+    if (!ok)
+    {
+        Serial.printf("❌ Bitácora: no se pudo escribir el segmento %u\n", segmento.cabecera.secuencia);
+        return false;
+    }
+    segmento.persistidos = segmento.cabecera.cantidad;
+    indice[ranura] = {segmento.cabecera.secuencia, segmento.cabecera.arranque,
+                      segmento.cabecera.inicioDecimas, segmento.finDecimas};
+    return true;
+}
+
+void iniciarBitacora(uint32_t arranque)
+{
+    arranqueActual = arranque;
+    if (!LittleFS.begin(true))
+    {
+        Serial.println("❌ Bitácora: LittleFS no disponible, los eventos solo quedan en RAM");
+        return;
+    }
+
+    const size_t tamanoArchivo = SEGMENTOS_BITACORA * BYTES_SEGMENTO_BITACORA;
+    File archivo = LittleFS.open(RUTA_BITACORA, "r");
+    if (!archivo || archivo.size() != tamanoArchivo)
+    {
+        archivo.close();
+        archivo = LittleFS.open(RUTA_BITACORA, "w");
+        uint8_t ceros[BYTES_SEGMENTO_BITACORA] = {};
+        for (int i = 0; i < SEGMENTOS_BITACORA; i++)
+        {
+            archivo.write(ceros, sizeof(ceros));
+        }
+        archivo.close();
+        archivo = LittleFS.open(RUTA_BITACORA, "r");
+        Serial.printf("📝 Bitácora: archivo nuevo de %u bytes\n", (unsigned)tamanoArchivo);
+    }
+
+    // Reconstruir el índice leyendo cada segmento y descartando los que no pasan el CRC
+    uint8_t buffer[BYTES_SEGMENTO_BITACORA];
+    int validos = 0;
+    for (uint16_t ranura = 0; ranura < SEGMENTOS_BITACORA; ranura++)
+    {
+        indice[ranura].secuencia = 0;
+        if (archivo.read(buffer, sizeof(buffer)) != sizeof(buffer))
+        {
+            break;
+        }
+        const CabeceraSegmento *cabecera = reinterpret_cast<const CabeceraSegmento *>(buffer);
+        const RegistroEvento *registros = reinterpret_cast<const RegistroEvento *>(buffer + sizeof(CabeceraSegmento));
+        if (!segmentoValido(*cabecera, registros))
+        {
+            continue;
+        }
+        actualizarIndice(ranura, *cabecera, registros);
+        validos++;
+        if (cabecera->secuencia >= siguienteSecuencia)
+        {
+            siguienteSecuencia = cabecera->secuencia + 1;
+        }
+    }
+    archivo.close();
+    archivoListo = true;
+    Serial.printf("📝 Bitácora: %d segmentos válidos, próxima secuencia %u\n", validos, siguienteSecuencia);
+}
+
+// Llamado desde loop(): primero los segmentos cerrados, luego el abierto cada INTERVALO_VOLCADO_BITACORA_MS
+void volcarBitacora()
+{
+    if (!archivoListo)
+    {
+        return;
+    }
+
+    for (int i = 1; i <= SEGMENTOS_RAM; i++)
+    {
+        int posicion = (segmentoAbierto + i) % SEGMENTOS_RAM;
+        SegmentoRam &segmento = segmentosRam[posicion];
+        if (segmento.cabecera.cantidad == 0 || segmento.persistidos == segmento.cabecera.cantidad)
+        {
+            if (segmento.cerrado)
+            {
+                segmento.cabecera.cantidad = 0;
+                segmento.cerrado = false;
+            }
+            continue;
+        }
+        if (posicion == segmentoAbierto && millis() - ultimoVolcado < INTERVALO_VOLCADO_BITACORA_MS)
+        {
+            continue;
+        }
+        if (escribirSegmento(segmento))
+        {
+            ultimoVolcado = millis();
+        }
+        return; // Una escritura por vuelta de loop
+    }
+}
+#else
+// Compilación de host: sin sistema de archivos, la bitácora vive solo en RAM
+bool leerSegmentoBitacora(uint16_t, uint8_t[BYTES_SEGMENTO_BITACORA])
+{
+    return false;
+}
+
+void iniciarBitacora(uint32_t arranque)
+{
+    arranqueActual = arranque;
+}
+
+void volcarBitacora()
+{
+}
+#endif
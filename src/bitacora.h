@@ -0,0 +1,38 @@
+#pragma once
+#include <Arduino.h>
+#include "formato_bitacora.h"
+
+// Bitácora binaria de eventos de zona: los eventos se acumulan en segmentos
+// en RAM (el abierto y, mientras se escribe, el anterior) y se vuelcan a
+// /bitacora.bin en LittleFS con CRC. Un índice en RAM por segmento permite
+// consultar por rango de tiempo sin leer el archivo completo.
+
+struct EntradaIndiceBitacora
+{
+    uint32_t secuencia;      // 0 = ranura vacía
+    uint32_t arranque;
+    uint32_t inicioDecimas;
+    uint32_t finDecimas;
+};
+
+// Segmento listo para enviar: en RAM se apunta directo al buffer, sin copiar
+struct SegmentoBitacora
+{
+    const CabeceraSegmento *cabecera;
+    const RegistroEvento *registros;
+};
+
+void iniciarBitacora(uint32_t arranque);
+void registrarEvento(TipoEvento tipo, int zona);
+void volcarBitacora();
+
+// Segmentos que se solapan con [desde, hasta] (décimas desde el arranque);
+// arranque = 0 acepta cualquiera. Devuelve ranuras de archivo en orden de
+// secuencia y, aparte, cuántos segmentos en RAM (aún no volcados del todo)
+// entran en el rango.
+int buscarSegmentosBitacora(uint32_t arranque, uint32_t desde, uint32_t hasta, uint16_t ranuras[], int capacidad);
+int segmentosRamEnRango(uint32_t arranque, uint32_t desde, uint32_t hasta, SegmentoBitacora destino[], int capacidad);
+bool leerSegmentoBitacora(uint16_t ranura, uint8_t destino[BYTES_SEGMENTO_BITACORA]);
+
+uint32_t eventosRegistrados();
+uint32_t eventosPerdidos();
@@ -0,0 +1,42 @@
+#pragma once
+#include <stddef.h>
+#include <string.h>
+
+// Cadena de capacidad fija almacenada en línea (sin heap). Pensada para el
+// estado de larga vida (nombres de zona): se asigna rara vez y se lee en cada
+// difusión sin copias ni reservas.
+template <size_t Capacidad>
+class CadenaFija
+{
+public:
+    CadenaFija() { datos[0] = '\0'; }
+    CadenaFija(const char *texto) { asignar(texto); }
+
+    // Copia el texto; si no cabe se trunca y devuelve false
+    bool asignar(const char *texto)
+    {
+        size_t largoTexto = texto ? strlen(texto) : 0;
+        bool cabe = largoTexto <= Capacidad;
+        largo = cabe ? largoTexto : Capacidad;
+        memcpy(datos, texto ? texto : "", largo);
+        datos[largo] = '\0';
+        return cabe;
+    }
+
+    CadenaFija &operator=(const char *texto)
+    {
+        asignar(texto);
+        return *this;
+    }
+
+    const char *c_str() const { return datos; }
+    size_t length() const { return largo; }
+    static constexpr size_t capacidad() { return Capacidad; }
+
+    bool operator==(const char *texto) const { return strcmp(datos, texto) == 0; }
+    bool operator!=(const char *texto) const { return !(*this == texto); }
+
+private:
+    char datos[Capacidad + 1];
+    size_t largo = 0;
+};
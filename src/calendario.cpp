@@ -0,0 +1,437 @@
+#include "calendario.h"
+#include "config.h"
+#include "configuracion.h"
+#include "zones.h"
+#include "persistencia.h"
+#include <Arduino.h>
+
+static const int MINUTOS_DIA = 24 * 60;
+static const uint64_t MICROS_POR_MINUTO = 60000000ULL;
+
+static_assert(CANTIDAD_CALENDARIOS <= 8, "Las excepciones guardan los calendarios en 8 bits");
+
+static DefinicionCalendarios definicion;
+static bool definicionLista = false;
+
+// Excepción de hoy para cada calendario (-1 si no hay), recalculada al
+// cambiar el día o la versión de la configuración
+static uint32_t versionCacheDia = 0;
+static uint16_t diaCache = 0;
+static int8_t excepcionHoy[CANTIDAD_CALENDARIOS];
+
+// Zonas en horario laboral según la última llamada a actualizarModosCalendario()
+static MascaraZonas zonasLaborales = 0;
+static bool modosIniciados = false;
+
+// Días desde el 1/1/1970 del calendario gregoriano (algoritmo de H. Hinnant)
+static int32_t diasDesdeCivil(int anio, unsigned mes, unsigned dia)
+{
+    anio -= mes <= 2;
+    const int32_t era = (anio >= 0 ? anio : anio - 399) / 400;
+    const unsigned anioEra = (unsigned)(anio - era * 400);
+    const unsigned diaAnio = (153 * (mes > 2 ? mes - 3 : mes + 9) + 2) / 5 + dia - 1;
+    const unsigned diaEra = anioEra * 365 + anioEra / 4 - anioEra / 100 + diaAnio;
+    return era * 146097 + (int32_t)diaEra - 719468;
+}
+
+static void civilDesdeDias(int32_t dias, int &anio, unsigned &mes, unsigned &dia)
+{
+    dias += 719468;
+    const int32_t era = (dias >= 0 ? dias : dias - 146096) / 146097;
+    const unsigned diaEra = (unsigned)(dias - era * 146097);
+    const unsigned anioEra = (diaEra - diaEra / 1460 + diaEra / 36524 - diaEra / 146096) / 365;
+    const unsigned diaAnio = diaEra - (365 * anioEra + anioEra / 4 - anioEra / 100);
+    const unsigned mesDesdeMarzo = (5 * diaAnio + 2) / 153;
+    dia = diaAnio - (153 * mesDesdeMarzo + 2) / 5 + 1;
+    mes = mesDesdeMarzo < 10 ? mesDesdeMarzo + 3 : mesDesdeMarzo - 9;
+    anio = (int)anioEra + era * 400 + (mes <= 2);
+}
+
+bool parsearFecha(const char *cadena, uint16_t &dia)
+{
+    int anio, mes, diaMes;
+    if (sscanf(cadena, "%d-%d-%d", &anio, &mes, &diaMes) != 3 || anio < 1970 || anio > 2149 ||
+        mes < 1 || mes > 12 || diaMes < 1 || diaMes > 31)
+    {
+        return false;
+    }
+    int32_t dias = diasDesdeCivil(anio, mes, diaMes);
+    // Descarta fechas como el 31 de abril, que caerían en el mes siguiente
+    int anioVuelta;
+    unsigned mesVuelta, diaVuelta;
+    civilDesdeDias(dias, anioVuelta, mesVuelta, diaVuelta);
+    if ((int)mesVuelta != mes || (int)diaVuelta != diaMes || dias > UINT16_MAX)
+    {
+        return false;
+    }
+    dia = (uint16_t)dias;
+    return true;
+}
+
+void formatearFecha(uint16_t dia, char destino[11])
+{
+    int anio;
+    unsigned mes, diaMes;
+    civilDesdeDias(dia, anio, mes, diaMes);
+    snprintf(destino, 11, "%04u-%02u-%02u", (unsigned)anio % 10000, mes % 100, diaMes % 100);
+}
+
+bool parsearIntervalo(const char *cadena, Horario &intervalo)
+{
+    int horaInicio, minutoInicio, horaFin, minutoFin;
+    if (sscanf(cadena, "%d:%d-%d:%d", &horaInicio, &minutoInicio, &horaFin, &minutoFin) != 4 ||
+        horaInicio < 0 || horaInicio >= 24 || minutoInicio < 0 || minutoInicio >= 60 ||
+        horaFin < 0 || horaFin > 24 || minutoFin < 0 || minutoFin >= 60 || (horaFin == 24 && minutoFin != 0))
+    {
+        return false;
+    }
+    intervalo.inicio = horaInicio * 60 + minutoInicio;
+    intervalo.fin = horaFin * 60 + minutoFin;
+    return intervalo.inicio < intervalo.fin;
+}
+
+uint16_t diaCalendarioActual()
+{
+    return (uint16_t)(microsLocales() / (MINUTOS_DIA * MICROS_POR_MINUTO));
+}
+
+static bool definicionValida(const DefinicionCalendarios &nueva)
+{
+    for (int c = 0; c < CANTIDAD_CALENDARIOS; c++)
+    {
+        for (int d = 0; d < 7; d++)
+        {
+            if (nueva.semana[c][d].cantidad > INTERVALOS_POR_DIA_CALENDARIO)
+            {
+                return false;
+            }
+        }
+    }
+    if (nueva.cantidadExcepciones > MAX_EXCEPCIONES_CALENDARIO)
+    {
+        return false;
+    }
+    for (int i = 0; i < nueva.cantidadExcepciones; i++)
+    {
+        if (nueva.excepciones[i].cantidad > INTERVALOS_POR_DIA_CALENDARIO ||
+            (nueva.excepciones[i].calendarios >> CANTIDAD_CALENDARIOS) != 0)
+        {
+            return false;
+        }
+    }
+    for (int z = 0; z < CANTIDAD_ZONAS; z++)
+    {
+        if (nueva.calendarioZona[z] >= CANTIDAD_CALENDARIOS)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Pone en 1 los bits [desde, hasta) de la semana
+static void marcarMinutos(uint32_t *semana, int desde, int hasta)
+{
+    while (desde < hasta)
+    {
+        int palabra = desde / 32;
+        int bit = desde % 32;
+        int bits = min(32 - bit, hasta - desde);
+        uint32_t mascara = bits == 32 ? UINT32_MAX : ((1UL << bits) - 1) << bit;
+        semana[palabra] |= mascara;
+        desde += bits;
+    }
+}
+
+static void compilar(CalendariosCompilados &destino, const DefinicionCalendarios &origen)
+{
+    memset(destino.semana, 0, sizeof(destino.semana));
+    for (int c = 0; c < CANTIDAD_CALENDARIOS; c++)
+    {
+        for (int d = 0; d < 7; d++)
+        {
+            const DiaCalendario &dia = origen.semana[c][d];
+            for (int i = 0; i < dia.cantidad; i++)
+            {
+                int fin = min((int)dia.intervalos[i].fin, MINUTOS_DIA);
+                marcarMinutos(destino.semana[c], d * MINUTOS_DIA + dia.intervalos[i].inicio, d * MINUTOS_DIA + fin);
+            }
+        }
+    }
+
+    // Inserción estable: pocas excepciones y casi siempre ya ordenadas
+    destino.cantidadExcepciones = origen.cantidadExcepciones;
+    for (int i = 0; i < origen.cantidadExcepciones; i++)
+    {
+        int j = i;
+        while (j > 0 && destino.excepciones[j - 1].dia > origen.excepciones[i].dia)
+        {
+            destino.excepciones[j] = destino.excepciones[j - 1];
+            j--;
+        }
+        destino.excepciones[j] = origen.excepciones[i];
+    }
+    memcpy(destino.calendarioZona, origen.calendarioZona, sizeof(destino.calendarioZona));
+}
+
+static void activarDefinicion()
+{
+    // horariosLaborales refleja el primer día laborable del calendario 0
+    for (int d = 0; d < 7; d++)
+    {
+        const DiaCalendario &dia = definicion.semana[0][d];
+        if (dia.cantidad > 0)
+        {
+            for (int i = 0; i < CANTIDAD_HORARIOS && i < dia.cantidad; i++)
+            {
+                horariosLaborales[i] = dia.intervalos[i];
+            }
+            break;
+        }
+    }
+    publicarConfiguracion();
+}
+
+// Sin nada guardado: el calendario 0 usa horariosLaborales de lunes a viernes
+// y los demás quedan sin horario laboral
+static void armarDefinicionInicial()
+{
+    memset(&definicion, 0, sizeof(definicion));
+    for (int d = 0; d < 5; d++)
+    {
+        DiaCalendario &dia = definicion.semana[0][d];
+        dia.cantidad = min(CANTIDAD_HORARIOS, INTERVALOS_POR_DIA_CALENDARIO);
+        for (int i = 0; i < dia.cantidad; i++)
+        {
+            dia.intervalos[i] = horariosLaborales[i];
+        }
+    }
+}
+
+// La definición inicial sale de horariosLaborales, así que no cambia lo que
+// ya publicó la configuración
+static void asegurarDefinicion()
+{
+    if (!definicionLista)
+    {
+        armarDefinicionInicial();
+        definicionLista = true;
+    }
+}
+
+void compilarCalendarios(CalendariosCompilados &destino)
+{
+    asegurarDefinicion();
+    compilar(destino, definicion);
+}
+
+void restaurarCalendarios()
+{
+    bool restaurada = restaurarClave(CLAVE_CALENDARIOS, "calendario", &definicion, sizeof(definicion)) &&
+                      definicionValida(definicion);
+    if (!restaurada)
+    {
+        // Versiones anteriores solo guardaban las dos franjas diarias
+        leerClaveAnterior("horarios", horariosLaborales, sizeof(Horario) * CANTIDAD_HORARIOS);
+        armarDefinicionInicial();
+        marcarClaveModificada(CLAVE_CALENDARIOS);
+    }
+    definicionLista = true;
+    activarDefinicion();
+    modosIniciados = false;
+}
+
+const DefinicionCalendarios &definicionCalendarios()
+{
+    asegurarDefinicion();
+    return definicion;
+}
+
+bool publicarCalendarios(const DefinicionCalendarios &nueva)
+{
+    if (!definicionValida(nueva))
+    {
+        return false;
+    }
+    asegurarDefinicion();
+    if (&nueva != &definicion)
+    {
+        definicion = nueva;
+    }
+    activarDefinicion();
+    marcarClaveModificada(CLAVE_CALENDARIOS);
+    marcarCambioEstado();
+    return true;
+}
+
+// Reemplaza la excepción de la misma fecha y calendarios, o agrega una nueva
+bool agregarExcepcion(DefinicionCalendarios &destino, const ExcepcionCalendario &excepcion)
+{
+    for (int i = 0; i < destino.cantidadExcepciones; i++)
+    {
+        if (destino.excepciones[i].dia == excepcion.dia &&
+            destino.excepciones[i].calendarios == excepcion.calendarios)
+        {
+            destino.excepciones[i] = excepcion;
+            return true;
+        }
+    }
+    if (destino.cantidadExcepciones >= MAX_EXCEPCIONES_CALENDARIO)
+    {
+        return false;
+    }
+    destino.excepciones[destino.cantidadExcepciones++] = excepcion;
+    return true;
+}
+
+int borrarExcepciones(DefinicionCalendarios &destino, uint16_t dia)
+{
+    int quedan = 0;
+    for (int i = 0; i < destino.cantidadExcepciones; i++)
+    {
+        if (destino.excepciones[i].dia != dia)
+        {
+            destino.excepciones[quedan++] = destino.excepciones[i];
+        }
+    }
+    int borradas = destino.cantidadExcepciones - quedan;
+    destino.cantidadExcepciones = quedan;
+    return borradas;
+}
+
+// Edición del formulario clásico: la franja 'indice' de cada día del
+// calendario 0 que la tenga; los días sin esa franja (fines de semana) no cambian
+void aplicarHorarioBase(int indice, uint16_t inicio, uint16_t fin)
+{
+    asegurarDefinicion();
+    for (int d = 0; d < 7; d++)
+    {
+        DiaCalendario &dia = definicion.semana[0][d];
+        if (indice < dia.cantidad)
+        {
+            dia.intervalos[indice] = {inicio, fin};
+        }
+    }
+    publicarCalendarios(definicion);
+}
+
+static void actualizarCacheDia(const Configuracion &configuracion, uint16_t dia)
+{
+    const CalendariosCompilados *compilado = &configuracion.calendarios;
+    versionCacheDia = configuracion.version;
+    diaCache = dia;
+    for (int c = 0; c < CANTIDAD_CALENDARIOS; c++)
+    {
+        excepcionHoy[c] = -1;
+    }
+
+    // Primera excepción con esa fecha (búsqueda binaria) y las siguientes del mismo día
+    int bajo = 0;
+    int alto = compilado->cantidadExcepciones;
+    while (bajo < alto)
+    {
+        int medio = (bajo + alto) / 2;
+        if (compilado->excepciones[medio].dia < dia)
+        {
+            bajo = medio + 1;
+        }
+        else
+        {
+            alto = medio;
+        }
+    }
+    for (int i = bajo; i < compilado->cantidadExcepciones && compilado->excepciones[i].dia == dia; i++)
+    {
+        for (int c = 0; c < CANTIDAD_CALENDARIOS; c++)
+        {
+            if (excepcionHoy[c] < 0 && (compilado->excepciones[i].calendarios & (1U << c)))
+            {
+                excepcionHoy[c] = i;
+            }
+        }
+    }
+}
+
+bool esMinutoLaboral(int calendario)
+{
+    if (calendario < 0 || calendario >= CANTIDAD_CALENDARIOS)
+    {
+        return false;
+    }
+    const Configuracion &configuracion = configuracionActual();
+    const CalendariosCompilados *compilado = &configuracion.calendarios;
+
+    uint64_t minutos = microsLocales() / MICROS_POR_MINUTO;
+    uint16_t dia = (uint16_t)(minutos / MINUTOS_DIA);
+    int minutoDia = minutos % MINUTOS_DIA;
+    if (configuracion.version != versionCacheDia || dia != diaCache)
+    {
+        actualizarCacheDia(configuracion, dia);
+    }
+
+    if (excepcionHoy[calendario] >= 0)
+    {
+        const ExcepcionCalendario &excepcion = compilado->excepciones[excepcionHoy[calendario]];
+        for (int i = 0; i < excepcion.cantidad; i++)
+        {
+            if (minutoDia >= excepcion.intervalos[i].inicio && minutoDia < excepcion.intervalos[i].fin)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // El 1/1/1970 fue jueves: día 3 de una semana que empieza en lunes
+    int minutoSemana = ((dia + 3) % 7) * MINUTOS_DIA + minutoDia;
+    return (compilado->semana[calendario][minutoSemana / 32] >> (minutoSemana % 32)) & 1;
+}
+
+// Las zonas del calendario 0 siguen a estaEnHorarioLaboral, que actualiza el
+// loop (y los tests fijan directamente)
+bool zonaEnHorarioLaboral(int zona)
+{
+    if (configuracionActual().calendarios.calendarioZona[zona] == 0)
+    {
+        return estaEnHorarioLaboral;
+    }
+    return (zonasLaborales >> zona) & 1;
+}
+
+bool actualizarModosCalendario(MascaraZonas &zonasEntran, MascaraZonas &zonasSalen)
+{
+    const CalendariosCompilados *compilado = &configuracionActual().calendarios;
+
+    // Cada calendario en uso se consulta una vez
+    int8_t modos[CANTIDAD_CALENDARIOS];
+    for (int c = 0; c < CANTIDAD_CALENDARIOS; c++)
+    {
+        modos[c] = -1;
+    }
+    modos[0] = estaEnHorarioLaboral;
+
+    MascaraZonas nuevas = 0;
+    for (int z = 0; z < CANTIDAD_ZONAS; z++)
+    {
+        uint8_t calendario = compilado->calendarioZona[z];
+        if (modos[calendario] < 0)
+        {
+            modos[calendario] = esMinutoLaboral(calendario);
+        }
+        if (modos[calendario])
+        {
+            nuevas |= (MascaraZonas)1 << z;
+        }
+    }
+
+    // El modo inicial lo fija setup(), como antes: no se trata como cambio
+    if (!modosIniciados)
+    {
+        modosIniciados = true;
+        zonasLaborales = nuevas;
+    }
+    zonasEntran = nuevas & ~zonasLaborales;
+    zonasSalen = zonasLaborales & ~nuevas;
+    zonasLaborales = nuevas;
+    return zonasEntran || zonasSalen;
+}
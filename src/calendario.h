@@ -0,0 +1,73 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+#include "time_utils.h"
+
+// Calendarios de horario laboral: cada uno define franjas por día de la
+// semana, las excepciones por fecha (feriados, jornadas especiales) reemplazan
+// el día completo y cada zona sigue un calendario. La definición editable se
+// compila en un mapa de bits de la semana (un bit por minuto) más un índice
+// de excepciones ordenado por fecha, así que consultar si un minuto es laboral
+// es un acceso a un bit; la excepción del día se busca una vez por día.
+//
+// El calendario 0 es el "horario laboral" de siempre: define estaEnHorarioLaboral
+// y sus franjas de los días laborables son las que edita establecerHorario().
+
+struct DiaCalendario
+{
+    uint8_t cantidad;
+    Horario intervalos[INTERVALOS_POR_DIA_CALENDARIO];
+};
+
+struct ExcepcionCalendario
+{
+    uint16_t dia;          // Días desde el 1/1/1970
+    uint8_t calendarios;   // Un bit por calendario al que se aplica
+    uint8_t cantidad;      // 0 = día no laboral
+    Horario intervalos[INTERVALOS_POR_DIA_CALENDARIO];
+};
+
+struct DefinicionCalendarios
+{
+    DiaCalendario semana[CANTIDAD_CALENDARIOS][7];   // 0 = lunes
+    ExcepcionCalendario excepciones[MAX_EXCEPCIONES_CALENDARIO];
+    uint8_t cantidadExcepciones;
+    uint8_t calendarioZona[CANTIDAD_ZONAS];
+};
+
+const int MINUTOS_SEMANA_CALENDARIO = 7 * 24 * 60;
+const int PALABRAS_SEMANA_CALENDARIO = (MINUTOS_SEMANA_CALENDARIO + 31) / 32;
+
+// Forma compilada, parte de la instantánea de configuración (configuracion.h)
+struct CalendariosCompilados
+{
+    uint32_t semana[CANTIDAD_CALENDARIOS][PALABRAS_SEMANA_CALENDARIO];
+    ExcepcionCalendario excepciones[MAX_EXCEPCIONES_CALENDARIO];   // Ordenadas por día
+    uint8_t cantidadExcepciones;
+    uint8_t calendarioZona[CANTIDAD_ZONAS];
+};
+
+// Restaura la definición de NVS (o la arma con horariosLaborales de lunes a
+// viernes) y la compila; llamado desde restaurarConfiguracionHoraria()
+void restaurarCalendarios();
+const DefinicionCalendarios &definicionCalendarios();
+
+// Edición: se copia la definición, se modifica la copia y se publica entera.
+// Publicar arma una nueva instantánea de configuración con la definición
+// compilada, así que una lectura nunca ve una compilación a medias.
+bool publicarCalendarios(const DefinicionCalendarios &nueva);
+void compilarCalendarios(CalendariosCompilados &destino);
+bool agregarExcepcion(DefinicionCalendarios &definicion, const ExcepcionCalendario &excepcion);
+int borrarExcepciones(DefinicionCalendarios &definicion, uint16_t dia);
+void aplicarHorarioBase(int indice, uint16_t inicio, uint16_t fin);
+
+bool esMinutoLaboral(int calendario);
+bool zonaEnHorarioLaboral(int zona);
+// Llamado desde loop() después de actualizar estaEnHorarioLaboral: devuelve
+// true si alguna zona entró o salió de su horario laboral
+bool actualizarModosCalendario(MascaraZonas &zonasEntran, MascaraZonas &zonasSalen);
+
+uint16_t diaCalendarioActual();
+bool parsearFecha(const char *cadena, uint16_t &dia);   // "AAAA-MM-DD"
+void formatearFecha(uint16_t dia, char destino[11]);
+bool parsearIntervalo(const char *cadena, Horario &intervalo);   // "HH:MM-HH:MM", fin hasta 24:00
@@ -0,0 +1,183 @@
+#include "comandos.h"
+#include "metricas.h"
+#include "trazas.h"
+#include <atomic>
+
+static_assert((CAPACIDAD_COLA_COMANDOS & (CAPACIDAD_COLA_COMANDOS - 1)) == 0,
+              "CAPACIDAD_COLA_COMANDOS debe ser potencia de 2");
+static_assert(CAPACIDAD_COLA_COMANDOS >= MAX_CAMBIOS_POR_LOTE, "Un lote completo tiene que entrar en la cola");
+static_assert(CANTIDAD_ZONAS <= 255, "Las órdenes guardan la zona en 8 bits");
+
+static const uint32_t MASCARA_COLA = CAPACIDAD_COLA_COMANDOS - 1;
+
+// La ranura de la posición p está libre para escribir si su secuencia vale p
+// y lista para leer si vale p + 1; al leerla pasa a p + CAPACIDAD (vuelta siguiente)
+struct RanuraComando
+{
+    std::atomic<uint32_t> secuencia;
+    uint8_t zona;
+    bool encender;
+    uint32_t traza;
+};
+
+struct ColaComandos
+{
+    RanuraComando ranuras[CAPACIDAD_COLA_COMANDOS];
+    std::atomic<uint32_t> escritura;
+    std::atomic<uint32_t> lectura;   // Solo la avanza el consumidor; atómica para leer la profundidad
+
+    ColaComandos() : escritura(0), lectura(0)
+    {
+        for (uint32_t i = 0; i < (uint32_t)CAPACIDAD_COLA_COMANDOS; i++)
+        {
+            ranuras[i].secuencia.store(i, std::memory_order_relaxed);
+        }
+    }
+};
+
+static ColaComandos cola;
+static uint32_t trazaAplicada = 0;
+static unsigned long momentoAplicacion = 0;
+
+static void registrarProfundidad()
+{
+    int32_t profundidad = profundidadColaComandos();
+    fijarMedidor(MEDIDOR_COLA_COMANDOS, profundidad);
+    int32_t maxima = medidores[MEDIDOR_COLA_COMANDOS_MAXIMA].load(std::memory_order_relaxed);
+    while (profundidad > maxima &&
+           !medidores[MEDIDOR_COLA_COMANDOS_MAXIMA].compare_exchange_weak(maxima, profundidad, std::memory_order_relaxed))
+    {
+    }
+}
+
+bool encolarCambiosZonas(const CambioZona cambios[], int cantidad, uint32_t idTraza)
+{
+    if (cantidad == 0)
+    {
+        return true;
+    }
+    if (cantidad < 0 || cantidad > CAPACIDAD_COLA_COMANDOS)
+    {
+        return false;
+    }
+    for (int i = 0; i < cantidad; i++)
+    {
+        if (cambios[i].zona < 0 || cambios[i].zona >= CANTIDAD_ZONAS)
+        {
+            return false;
+        }
+    }
+
+    // El consumidor libera en orden: si la última ranura del lote está libre,
+    // las anteriores también
+    uint32_t posicion = cola.escritura.load(std::memory_order_relaxed);
+    while (true)
+    {
+        uint32_t ultima = posicion + cantidad - 1;
+        uint32_t secuencia = cola.ranuras[ultima & MASCARA_COLA].secuencia.load(std::memory_order_acquire);
+        int32_t diferencia = (int32_t)(secuencia - ultima);
+        if (diferencia == 0)
+        {
+            if (cola.escritura.compare_exchange_weak(posicion, posicion + cantidad, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diferencia < 0)
+        {
+            // Cola llena: el loop no alcanzó a vaciarla
+            incrementarContador(CONTADOR_COMANDOS_DESCARTADOS);
+            return false;
+        }
+        else
+        {
+            posicion = cola.escritura.load(std::memory_order_relaxed);
+        }
+    }
+
+    for (int i = 0; i < cantidad; i++)
+    {
+        RanuraComando &ranura = cola.ranuras[(posicion + i) & MASCARA_COLA];
+        ranura.zona = (uint8_t)cambios[i].zona;
+        ranura.encender = cambios[i].encender;
+        ranura.traza = idTraza;
+        ranura.secuencia.store(posicion + i + 1, std::memory_order_release);
+    }
+    sumarContador(CONTADOR_COMANDOS_ENCOLADOS, cantidad);
+    registrarProfundidad();
+    return true;
+}
+
+int aplicarComandosPendientes()
+{
+    bool ordenada[CANTIDAD_ZONAS] = {};
+    bool encender[CANTIDAD_ZONAS];
+    uint32_t trazas[CAPACIDAD_COLA_COMANDOS];
+    int cantidadTrazas = 0;
+    int leidos = 0;
+
+    // Se lee hasta la primera ranura sin publicar: lo que siga queda para la
+    // vuelta siguiente
+    uint32_t posicion = cola.lectura.load(std::memory_order_relaxed);
+    while (leidos < CAPACIDAD_COLA_COMANDOS)
+    {
+        RanuraComando &ranura = cola.ranuras[posicion & MASCARA_COLA];
+        if (ranura.secuencia.load(std::memory_order_acquire) != posicion + 1)
+        {
+            break;
+        }
+        int zona = ranura.zona;
+        if (ordenada[zona])
+        {
+            // Una orden posterior para la misma zona reemplaza a la anterior
+            incrementarContador(CONTADOR_COMANDOS_COALESCIDOS);
+        }
+        ordenada[zona] = true;
+        encender[zona] = ranura.encender;
+        // Un lote comparte la traza: basta con anotarla una vez
+        if (ranura.traza != 0 && (cantidadTrazas == 0 || trazas[cantidadTrazas - 1] != ranura.traza))
+        {
+            trazas[cantidadTrazas++] = ranura.traza;
+        }
+        ranura.secuencia.store(posicion + CAPACIDAD_COLA_COMANDOS, std::memory_order_release);
+        posicion++;
+        leidos++;
+    }
+    if (leidos == 0)
+    {
+        return 0;
+    }
+    cola.lectura.store(posicion, std::memory_order_release);
+
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        if (ordenada[i])
+        {
+            encolarSucesoZona(i, encender[i] ? SUCESO_ENCENDER : SUCESO_APAGAR);
+        }
+    }
+    despacharSucesosZonas();
+    momentoAplicacion = millis();
+    for (int i = 0; i < cantidadTrazas; i++)
+    {
+        marcarTrazaAplicada(trazas[i]);
+        trazaAplicada = trazas[i];
+    }
+    registrarProfundidad();
+    return leidos;
+}
+
+int profundidadColaComandos()
+{
+    return (int)(cola.escritura.load(std::memory_order_relaxed) - cola.lectura.load(std::memory_order_relaxed));
+}
+
+uint32_t ultimaTrazaAplicada()
+{
+    return trazaAplicada;
+}
+
+unsigned long momentoUltimaAplicacion()
+{
+    return momentoAplicacion;
+}
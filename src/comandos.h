@@ -0,0 +1,29 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+#include "zones.h"
+
+// Cola de órdenes de zona entre los handlers de red y el control. Los
+// handlers (HTTP, WebSocket, API) solo encolan y responden; el loop vacía la
+// cola una vez por vuelta con aplicarComandosPendientes(), se queda con la
+// última orden de cada zona (encender, apagar, encender = encender) y escribe
+// los relays de una sola vez con despacharSucesosZonas().
+//
+// Es un anillo acotado sin locks con un número de secuencia por ranura:
+// varios productores reservan ranuras con un compare-exchange y un único
+// consumidor (el loop) las libera en orden. Un lote reserva todas sus ranuras
+// de una vez, así que llega entero o no llega.
+
+// Devuelve false si alguna zona no es válida o no queda lugar para el lote
+bool encolarCambiosZonas(const CambioZona cambios[], int cantidad, uint32_t idTraza);
+
+// Solo desde el loop. Devuelve cuántas órdenes se leyeron de la cola.
+int aplicarComandosPendientes();
+
+int profundidadColaComandos();
+
+// Traza más reciente cuyas órdenes ya escribieron los relays y millis() de esa
+// escritura. Las trazas se numeran al encolar, así que toda traza menor o
+// igual también está aplicada.
+uint32_t ultimaTrazaAplicada();
+unsigned long momentoUltimaAplicacion();
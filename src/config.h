@@ -1,5 +1,6 @@
 #include <Arduino.h>
 #pragma once
+#include <type_traits>
 
 // Configuración WiFi - Declaraciones extern
 extern const char *ssid;
@@ -7,7 +8,93 @@ extern const char *password;
 
 // Constantes
 const unsigned long TIEMPO_MAXIMO_ENCENDIDO = 300000; // 5 minutos
+const unsigned long AVISO_EXPIRACION_MS = 60000;      // Último tramo del timeout (estado "por_expirar")
+const int MAX_SUCESOS_PENDIENTES = 16;                // Sucesos de zona encolados antes de despachar
 const int VALOR_RELAY_ENCENDIDO = LOW;
 const int VALOR_RELAY_APAGADO = HIGH;
-const int CANTIDAD_ZONAS = 2;
-const int CANTIDAD_HORARIOS = 2;
\ No newline at end of file
+// Las compilaciones de benchmark (env:bench_*) agregan zonas con -DZONAS_COMPILACION=N
+#ifndef ZONAS_COMPILACION
+#define ZONAS_COMPILACION 2
+#endif
+const int CANTIDAD_ZONAS = ZONAS_COMPILACION;
+const int CANTIDAD_HORARIOS = 2;
+const int CANTIDAD_CALENDARIOS = 4;                // Calendarios asignables a las zonas (el 0 es el horario laboral)
+const int INTERVALOS_POR_DIA_CALENDARIO = 4;       // Franjas laborales por día en cada calendario
+const int MAX_EXCEPCIONES_CALENDARIO = 16;         // Feriados y jornadas especiales guardados
+const int LARGO_MAXIMO_NOMBRE_ZONA = 15;
+
+// Un bit por zona (zonas encendidas, modos por calendario)
+typedef std::conditional<(CANTIDAD_ZONAS > 32), uint64_t, uint32_t>::type MascaraZonas;
+
+// API y clientes en red
+const int MAX_CAMBIOS_POR_LOTE = 32;       // Límite de operaciones en un PATCH /api/zones o comando "set"
+const int MAX_ESPERAS_ESTADO = 4;          // Clientes en long-poll simultáneos en GET /api/state (puerto de eventos)
+const long ESPERA_MAXIMA_ESTADO_S = 30;    // Tope del parámetro ?wait= (segundos)
+const int MAX_SUSCRIPTORES_SSE = 4;        // Conexiones simultáneas a /events
+const uint16_t PUERTO_EVENTOS = 82;        // WiFiServer propio para /events y el long-poll de /api/state
+const int MAX_PETICIONES_EVENTOS = 2;      // Conexiones al puerto de eventos leyendo cabeceras a la vez
+const int LARGO_LINEA_PETICION_EVENTOS = 96;               // Búfer por línea de cabecera (< 256)
+const unsigned long ESPERA_MAXIMA_PETICION_EVENTOS_MS = 2000; // Plazo para recibir las cabeceras
+const int CAPACIDAD_COLA_COMANDOS = 64;    // Órdenes de zona en espera del control (potencia de 2, >= MAX_CAMBIOS_POR_LOTE)
+
+// Telemetría de memoria
+const unsigned long INTERVALO_MUESTREO_MEMORIA_MS = 60000; // 1 muestra por minuto
+const int MUESTRAS_MEMORIA = 60;                           // Historial de 1 hora
+const uint32_t BLOQUE_MINIMO_SEGURO = 8192;                // Bloque contiguo por debajo del cual la muestra es crítica
+const int MUESTRAS_CRITICAS_PARA_REINICIO = 5;
+const bool REINICIO_POR_FRAGMENTACION = false;             // Reiniciar de forma controlada al persistir la fragmentación
+
+// Planificador del loop (ver planificador.h)
+const int MAX_TAREAS_LOOP = 16;
+const uint32_t INTERVALO_CONTROL_US = 10000;   // Separación máxima entre pasadas de control con red o fondo pendientes
+const uint32_t PORCION_VUELTA_US = 20000;      // Tiempo por vuelta para retomar tareas de red y fondo que cedieron
+const unsigned long ESPERA_OCIOSA_MS = 10;     // Sin trabajo pendiente el loop duerme entre vueltas
+const unsigned long MAXIMO_SIN_DORMIR_MS = 100; // Con trabajo pendiente igual duerme un tick cada tanto (IDLE, red en un solo núcleo)
+
+// Vigilancia de etapas del loop
+const uint32_t INTERVALO_VIGILANCIA_MS = 50;   // Período del timer que observa la etapa en curso
+const int EXCESOS_GUARDADOS = 16;              // Excesos conservados en RTC entre reinicios
+
+// Bitácora de eventos (formato en formato_bitacora.h)
+const unsigned long INTERVALO_VOLCADO_BITACORA_MS = 60000; // Volcado del segmento abierto a LittleFS
+
+// Estadísticas de ocupación
+const unsigned long INTERVALO_ACUMULACION_ESTADISTICAS_MS = 1000; // Tiempo encendida sumado por el tick del loop
+
+// Contabilidad de energía
+const uint16_t POTENCIA_ZONA_POR_DEFECTO_W = 60;                     // Carga de cada zona hasta que se configure
+const unsigned long INTERVALO_PERSISTENCIA_ENERGIA_MS = 15UL * 60000; // Guardado periódico en NVS
+
+// Arranque
+const uint32_t PILA_TAREA_RED = 8192;   // Bytes de pila de la tarea que levanta WiFi, mDNS, DNS y servidores
+const int NUCLEO_TAREA_RED = 0;         // Núcleo del stack WiFi; el loop de Arduino corre en el 1
+
+// Persistencia de configuración y estado (NVS)
+const unsigned long ESPERA_SILENCIO_PERSISTENCIA_MS = 2000;   // Sin cambios durante este tiempo se escribe
+const unsigned long ESPERA_MAXIMA_PERSISTENCIA_MS = 30000;    // Tope de espera con cambios continuos
+const int MINUTOS_ENTRE_GUARDADOS_RELOJ = 10;                 // La hora se guarda cada 10 minutos de reloj
+
+// Configuración en uso (instantáneas de solo lectura, ver configuracion.h)
+const int BUFERES_CONFIGURACION = 3;          // Activa, retirada esperando su período de gracia y libre
+const int MAX_LECTORES_CONFIGURACION = 4;     // Tareas que leen la configuración y anuncian su quiescencia
+const uint32_t TIMEOUT_MINIMO_S = 30;         // Rango aceptado para el apagado automático de cada zona
+const uint32_t TIMEOUT_MAXIMO_S = 4 * 3600;
+
+// Timeouts adaptativos por zona (ver adaptacion.h)
+const bool ADAPTACION_POR_DEFECTO = true;              // Cada zona aprende su timeout hasta que se fije uno a mano
+const uint32_t TIMEOUT_ADAPTATIVO_MINIMO_S = 60;       // Rango en el que se mueve el timeout aprendido
+const uint32_t TIMEOUT_ADAPTATIVO_MAXIMO_S = 30 * 60;
+const float CUANTIL_TIMEOUT_ADAPTATIVO = 0.95f;        // Pausa entre movimientos que el timeout debe cubrir...
+const float MARGEN_TIMEOUT_ADAPTATIVO = 1.5f;          // ...multiplicada por este margen
+const uint32_t MUESTRAS_MINIMAS_ADAPTACION = 30;       // Antes de esto se mantiene el timeout configurado
+const uint32_t VENTANA_REACTIVACION_S = 60;            // Actividad tan pronto tras un timeout: apagado en falso
+const uint16_t PESO_REACTIVACION = 8;                  // Un apagado en falso cuenta como tantas pausas
+const uint16_t PESO_MAXIMO_BOSQUEJO = 4000;            // Al llegar se reducen las cuentas a la mitad (olvido)
+const uint32_t HISTERESIS_TIMEOUT_ADAPTATIVO_PCT = 10; // Cambios menores no se publican
+const unsigned long INTERVALO_PERSISTENCIA_ADAPTACION_MS = 60UL * 60000;
+
+// Reloj de pared
+const char *const SERVIDOR_SNTP = "";               // Servidor SNTP de la red local; vacío = solo /settime
+const long DESFASE_HORARIO_SEGUNDOS = 0;            // Hora local menos UTC, para la hora que entrega SNTP
+const uint32_t INTERVALO_MINIMO_DERIVA_S = 3600;    // Separación mínima entre sincronizaciones para medir deriva
+const int32_t DERIVA_MAXIMA_PPB = 500000;           // Tope de la corrección de deriva (500 ppm)
@@ -0,0 +1,193 @@
+#include "configuracion.h"
+#include "persistencia.h"
+#include "zones.h"
+#include <atomic>
+
+enum EstadoBufer : uint8_t
+{
+    BUFER_LIBRE,
+    BUFER_ACTIVO,
+    BUFER_RETIRADO
+};
+
+static Configuracion buferes[BUFERES_CONFIGURACION];
+static EstadoBufer estados[BUFERES_CONFIGURACION];
+static uint32_t epocaRetiro[BUFERES_CONFIGURACION];   // Época a partir de la cual nadie lo lee
+static std::atomic<const Configuracion *> activa(nullptr);
+
+// Cada publicación abre una época; cada lector anota la última que vio en un
+// punto de quiescencia (0 = ranura sin usar)
+static std::atomic<uint32_t> epoca(1);
+static std::atomic<uint32_t> epocaLectores[MAX_LECTORES_CONFIGURACION];
+static std::atomic<int> cantidadLectores(0);
+
+static EstadisticasConfiguracion estadisticas;
+
+// Definición editable de los timeouts; la instantánea tiene la copia que se lee
+static uint32_t tiemposMaximosMs[CANTIDAD_ZONAS];
+static bool politicasListas = false;
+
+static void asegurarPoliticas()
+{
+    if (!politicasListas)
+    {
+        for (int i = 0; i < CANTIDAD_ZONAS; i++)
+        {
+            tiemposMaximosMs[i] = TIEMPO_MAXIMO_ENCENDIDO;
+        }
+        politicasListas = true;
+    }
+}
+
+static bool timeoutValido(uint32_t milisegundos)
+{
+    return milisegundos >= TIMEOUT_MINIMO_S * 1000UL && milisegundos <= TIMEOUT_MAXIMO_S * 1000UL;
+}
+
+// Un búfer retirado vuelve a estar libre cuando todos los lectores pasaron
+// por un punto de quiescencia en su época de retiro o después
+static void reclamarBuferes()
+{
+    uint32_t minima = epoca.load(std::memory_order_acquire);
+    int lectores = cantidadLectores.load(std::memory_order_acquire);
+    for (int i = 0; i < lectores; i++)
+    {
+        uint32_t vista = epocaLectores[i].load(std::memory_order_acquire);
+        if (vista != 0 && vista < minima)
+        {
+            minima = vista;
+        }
+    }
+    for (int i = 0; i < BUFERES_CONFIGURACION; i++)
+    {
+        if (estados[i] == BUFER_RETIRADO && epocaRetiro[i] <= minima)
+        {
+            estados[i] = BUFER_LIBRE;
+        }
+    }
+}
+
+static int buferLibre()
+{
+    reclamarBuferes();
+    for (int i = 0; i < BUFERES_CONFIGURACION; i++)
+    {
+        if (estados[i] == BUFER_LIBRE)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool publicarConfiguracion()
+{
+    int indice = buferLibre();
+    if (indice < 0)
+    {
+        if (!estadisticas.pendiente)
+        {
+            estadisticas.pendiente = true;
+            estadisticas.diferidas++;
+        }
+        return false;
+    }
+
+    asegurarPoliticas();
+    Configuracion &nueva = buferes[indice];
+    nueva.version = ++estadisticas.version;
+    memcpy(nueva.horarios, horariosLaborales, sizeof(nueva.horarios));
+    memcpy(nueva.tiempoMaximoEncendidoMs, tiemposMaximosMs, sizeof(nueva.tiempoMaximoEncendidoMs));
+    compilarCalendarios(nueva.calendarios);
+
+    const Configuracion *anterior = activa.load(std::memory_order_relaxed);
+    estados[indice] = BUFER_ACTIVO;
+    activa.store(&nueva, std::memory_order_release);
+    if (anterior)
+    {
+        int indiceAnterior = anterior - buferes;
+        estados[indiceAnterior] = BUFER_RETIRADO;
+        // Quien cargó el puntero anterior lo hizo antes de esta época
+        epocaRetiro[indiceAnterior] = epoca.fetch_add(1, std::memory_order_acq_rel) + 1;
+    }
+    estadisticas.publicaciones++;
+    estadisticas.pendiente = false;
+    return true;
+}
+
+const Configuracion &configuracionActual()
+{
+    const Configuracion *configuracion = activa.load(std::memory_order_acquire);
+    if (!configuracion)
+    {
+        // Primera lectura antes de restaurar nada: valores por defecto
+        publicarConfiguracion();
+        configuracion = activa.load(std::memory_order_acquire);
+    }
+    return *configuracion;
+}
+
+int registrarLectorConfiguracion()
+{
+    int lector = cantidadLectores.load(std::memory_order_relaxed);
+    if (lector >= MAX_LECTORES_CONFIGURACION)
+    {
+        return -1;
+    }
+    epocaLectores[lector].store(epoca.load(std::memory_order_acquire), std::memory_order_release);
+    cantidadLectores.store(lector + 1, std::memory_order_release);
+    return lector;
+}
+
+void marcarLectorQuiescente(int lector)
+{
+    if (lector >= 0 && lector < MAX_LECTORES_CONFIGURACION)
+    {
+        epocaLectores[lector].store(epoca.load(std::memory_order_acquire), std::memory_order_release);
+    }
+}
+
+void atenderConfiguracion()
+{
+    if (estadisticas.pendiente)
+    {
+        publicarConfiguracion();
+    }
+}
+
+const EstadisticasConfiguracion &estadisticasConfiguracion()
+{
+    return estadisticas;
+}
+
+void restaurarPoliticasZonas()
+{
+    politicasListas = false;
+    asegurarPoliticas();
+    if (restaurarClave(CLAVE_POLITICAS, "politicas", tiemposMaximosMs, sizeof(tiemposMaximosMs)))
+    {
+        for (int i = 0; i < CANTIDAD_ZONAS; i++)
+        {
+            if (!timeoutValido(tiemposMaximosMs[i]))
+            {
+                tiemposMaximosMs[i] = TIEMPO_MAXIMO_ENCENDIDO;
+                marcarClaveModificada(CLAVE_POLITICAS);
+            }
+        }
+    }
+    publicarConfiguracion();
+}
+
+bool establecerTimeoutZona(int zona, uint32_t segundos)
+{
+    if (zona < 0 || zona >= CANTIDAD_ZONAS || !timeoutValido(segundos * 1000UL))
+    {
+        return false;
+    }
+    asegurarPoliticas();
+    tiemposMaximosMs[zona] = segundos * 1000UL;
+    marcarClaveModificada(CLAVE_POLITICAS);
+    marcarCambioEstado();
+    publicarConfiguracion();
+    return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+#include "time_utils.h"
+#include "calendario.h"
+
+// Configuración en uso como instantáneas inmutables y versionadas. Los
+// módulos editan su propia definición (calendarios, timeouts por zona) y
+// publicarConfiguracion() arma una instantánea nueva en un búfer libre que se
+// activa con un solo cambio de puntero atómico. Los lectores obtienen la
+// activa con configuracionActual() sin locks y la pueden usar hasta su
+// siguiente punto de quiescencia; un búfer reemplazado solo se reutiliza
+// cuando todos los lectores registrados anunciaron uno después del cambio.
+//
+// Hay un único escritor (el loop, que también atiende HTTP y WebSocket). Si
+// no queda un búfer libre la publicación queda pendiente y la completa
+// atenderConfiguracion().
+
+struct Configuracion
+{
+    uint32_t version;
+    Horario horarios[CANTIDAD_HORARIOS];
+    uint32_t tiempoMaximoEncendidoMs[CANTIDAD_ZONAS];
+    CalendariosCompilados calendarios;
+};
+
+struct EstadisticasConfiguracion
+{
+    uint32_t version;
+    uint32_t publicaciones;
+    uint32_t diferidas;     // Publicaciones que esperaron un período de gracia
+    bool pendiente;
+};
+
+// Lectura: válida hasta el próximo marcarLectorQuiescente() del lector
+const Configuracion &configuracionActual();
+int registrarLectorConfiguracion();
+void marcarLectorQuiescente(int lector);
+
+// Escritura: devuelve false si la publicación quedó pendiente
+bool publicarConfiguracion();
+void atenderConfiguracion();
+const EstadisticasConfiguracion &estadisticasConfiguracion();
+
+// Timeouts de apagado automático por zona, guardados en NVS
+void restaurarPoliticasZonas();
+bool establecerTimeoutZona(int zona, uint32_t segundos);
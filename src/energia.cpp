@@ -0,0 +1,255 @@
+#include "energia.h"
+#include "zones.h"
+#include "persistencia.h"
+#ifdef ARDUINO
+#include <Preferences.h>
+#endif
+
+static EnergiaZona energia[CANTIDAD_ZONAS];
+static unsigned long ultimaActualizacion[CANTIDAD_ZONAS];
+static bool ahorroTimeoutActivo[CANTIDAD_ZONAS];
+static unsigned long encendidoVirtualHasta[CANTIDAD_ZONAS];   // Encendido que habría provocado el PIR
+static bool potenciasIniciadas = false;
+static unsigned long ultimaPersistencia = 0;
+
+// Bloque guardado en NVS: un byte de versión y los campos de cada zona en
+// little-endian, sin el relleno que el compilador agrega a EnergiaZona. Un
+// bloque de otro tamaño (otra cantidad de zonas) o versión se descarta.
+const uint8_t VERSION_BLOQUE_ENERGIA = 1;
+const size_t BYTES_ENERGIA_ZONA = 4 * sizeof(uint64_t) + sizeof(uint16_t);
+static uint8_t bloqueGuardado[1 + CANTIDAD_ZONAS * BYTES_ENERGIA_ZONA];
+
+static uint8_t *escribirEntero(uint8_t *destino, uint64_t valor, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; i++)
+    {
+        *destino++ = (uint8_t)(valor >> (8 * i));
+    }
+    return destino;
+}
+
+static const uint8_t *leerEntero(const uint8_t *origen, uint64_t &valor, size_t bytes)
+{
+    valor = 0;
+    for (size_t i = 0; i < bytes; i++)
+    {
+        valor |= (uint64_t)*origen++ << (8 * i);
+    }
+    return origen;
+}
+
+static void serializarEnergia()
+{
+    uint8_t *destino = bloqueGuardado;
+    *destino++ = VERSION_BLOQUE_ENERGIA;
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        destino = escribirEntero(destino, energia[i].milisegundosEncendida, sizeof(uint64_t));
+        destino = escribirEntero(destino, energia[i].consumoMj, sizeof(uint64_t));
+        destino = escribirEntero(destino, energia[i].ahorroTimeoutMj, sizeof(uint64_t));
+        destino = escribirEntero(destino, energia[i].ahorroPirMj, sizeof(uint64_t));
+        destino = escribirEntero(destino, energia[i].potenciaW, sizeof(uint16_t));
+    }
+}
+
+static bool deserializarEnergia()
+{
+    if (bloqueGuardado[0] != VERSION_BLOQUE_ENERGIA)
+    {
+        return false;
+    }
+    const uint8_t *origen = bloqueGuardado + 1;
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        uint64_t potencia;
+        origen = leerEntero(origen, energia[i].milisegundosEncendida, sizeof(uint64_t));
+        origen = leerEntero(origen, energia[i].consumoMj, sizeof(uint64_t));
+        origen = leerEntero(origen, energia[i].ahorroTimeoutMj, sizeof(uint64_t));
+        origen = leerEntero(origen, energia[i].ahorroPirMj, sizeof(uint64_t));
+        origen = leerEntero(origen, potencia, sizeof(uint16_t));
+        energia[i].potenciaW = potencia ? (uint16_t)potencia : POTENCIA_ZONA_POR_DEFECTO_W;
+    }
+    return true;
+}
+
+// La caché de NVS guarda bloqueGuardado: se actualiza antes de cada marca
+static void marcarEnergiaModificada()
+{
+    serializarEnergia();
+    marcarClaveModificada(CLAVE_ENERGIA);
+}
+
+static void iniciarPotencias()
+{
+    if (potenciasIniciadas)
+    {
+        return;
+    }
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        energia[i].potenciaW = POTENCIA_ZONA_POR_DEFECTO_W;
+    }
+    potenciasIniciadas = true;
+}
+
+// Lleva la zona hasta "ahora": consumo si está encendida, ahorro si está
+// apagada y alguna regla la mantiene así
+static void acumularEnergia(int zona, unsigned long ahora)
+{
+    iniciarPotencias();
+    EnergiaZona &cuenta = energia[zona];
+    unsigned long desde = ultimaActualizacion[zona];
+    unsigned long transcurrido = ahora - desde;
+    ultimaActualizacion[zona] = ahora;
+
+    if (zonas[zona].estaActivo)
+    {
+        cuenta.milisegundosEncendida += transcurrido;
+        cuenta.consumoMj += (uint64_t)cuenta.potenciaW * transcurrido;
+    }
+    else if (ahorroTimeoutActivo[zona])
+    {
+        cuenta.ahorroTimeoutMj += (uint64_t)cuenta.potenciaW * transcurrido;
+    }
+    else if ((long)(encendidoVirtualHasta[zona] - desde) > 0)
+    {
+        unsigned long virtualRestante = encendidoVirtualHasta[zona] - desde;
+        cuenta.ahorroPirMj += (uint64_t)cuenta.potenciaW * (virtualRestante < transcurrido ? virtualRestante : transcurrido);
+    }
+}
+
+void cambioEstadoEnergia(int zona, bool encender)
+{
+    acumularEnergia(zona, millis());
+    if (encender)
+    {
+        // La zona vuelve a estar encendida de verdad: terminan los escenarios virtuales
+        ahorroTimeoutActivo[zona] = false;
+        encendidoVirtualHasta[zona] = ultimaActualizacion[zona];
+    }
+}
+
+void apagadoTimeoutEnergia(int zona)
+{
+    acumularEnergia(zona, millis());
+    ahorroTimeoutActivo[zona] = true;
+}
+
+void movimientoEnergia(int zona)
+{
+    unsigned long ahora = millis();
+    acumularEnergia(zona, ahora);
+    if (!zonas[zona].estaActivo)
+    {
+        encendidoVirtualHasta[zona] = ahora + TIEMPO_MAXIMO_ENCENDIDO;
+    }
+}
+
+// Al entrar en horario laboral la zona habría quedado en manos del personal
+void cambioModoEnergia(bool horarioLaboral, MascaraZonas zonasAfectadas)
+{
+    unsigned long ahora = millis();
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        if (!((zonasAfectadas >> i) & 1))
+        {
+            continue;
+        }
+        acumularEnergia(i, ahora);
+        if (horarioLaboral)
+        {
+            ahorroTimeoutActivo[i] = false;
+            encendidoVirtualHasta[i] = ahora;
+        }
+    }
+}
+
+bool establecerPotenciaZona(int zona, uint16_t vatios)
+{
+    if (zona < 0 || zona >= CANTIDAD_ZONAS || vatios == 0)
+    {
+        return false;
+    }
+    // Lo acumulado hasta ahora se cuenta con la potencia anterior
+    acumularEnergia(zona, millis());
+    energia[zona].potenciaW = vatios;
+    marcarEnergiaModificada();
+    return true;
+}
+
+const EnergiaZona &energiaZona(int zona)
+{
+    acumularEnergia(zona, millis());
+    return energia[zona];
+}
+
+#ifdef ARDUINO
+// Versiones anteriores guardaban un bloque por zona en el espacio "energia"
+static bool migrarEnergiaAnterior()
+{
+    Preferences anterior;
+    if (!anterior.begin("energia", false))
+    {
+        return false;
+    }
+    bool migrada = false;
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        char clave[8];
+        snprintf(clave, sizeof(clave), "zona%d", i);
+        if (anterior.getBytes(clave, &energia[i], sizeof(EnergiaZona)) == sizeof(EnergiaZona))
+        {
+            migrada = true;
+        }
+    }
+    anterior.clear();
+    anterior.end();
+    return migrada;
+}
+#else
+static bool migrarEnergiaAnterior()
+{
+    return false;
+}
+#endif
+
+void iniciarEnergia()
+{
+    iniciarPotencias();
+    bool restaurada = restaurarClave(CLAVE_ENERGIA, "energia", bloqueGuardado, sizeof(bloqueGuardado));
+    if (restaurada && !deserializarEnergia())
+    {
+        Serial.printf("⚠️ Bloque de energía con versión %u desconocida, se descarta\n", bloqueGuardado[0]);
+        restaurada = false;
+    }
+    if (!restaurada && migrarEnergiaAnterior())
+    {
+        marcarEnergiaModificada();
+    }
+    else
+    {
+        serializarEnergia();
+    }
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        ultimaActualizacion[i] = millis();
+        Serial.printf("⚡ Zona %d: %u W, %llu Wh consumidos desde la instalación\n", i + 1,
+                      energia[i].potenciaW, (unsigned long long)(energia[i].consumoMj / 3600000ULL));
+    }
+}
+
+// Llamado desde loop(): cada INTERVALO_PERSISTENCIA_ENERGIA_MS lleva las
+// cuentas al instante actual y las deja marcadas para la caché de NVS
+void persistirEnergia()
+{
+    if (millis() - ultimaPersistencia < INTERVALO_PERSISTENCIA_ENERGIA_MS)
+    {
+        return;
+    }
+    ultimaPersistencia = millis();
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        acumularEnergia(i, ultimaPersistencia);
+    }
+    marcarEnergiaModificada();
+}
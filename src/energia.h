@@ -0,0 +1,34 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Contabilidad de energía por zona en aritmética entera: el tiempo en
+// milisegundos y la energía en milijulios (vatios × ms), sin redondeos al
+// acumular. El ahorro se atribuye a cada regla comparando con un escenario
+// en el que la regla no existe:
+//   - timeout: sin el apagado automático la zona habría seguido encendida
+//     hasta un apagado manual o hasta volver al horario laboral
+//   - PIR: con un sensor convencional un movimiento con la zona apagada la
+//     habría encendido durante TIEMPO_MAXIMO_ENCENDIDO desde el último movimiento
+
+struct EnergiaZona
+{
+    uint64_t milisegundosEncendida;
+    uint64_t consumoMj;
+    uint64_t ahorroTimeoutMj;
+    uint64_t ahorroPirMj;
+    uint16_t potenciaW;
+};
+
+// Llamar antes de que cambie zonas[zona].estaActivo
+void cambioEstadoEnergia(int zona, bool encender);
+// Llamar después de apagar la zona por timeout
+void apagadoTimeoutEnergia(int zona);
+void movimientoEnergia(int zona);
+void cambioModoEnergia(bool horarioLaboral, MascaraZonas zonasAfectadas = ~(MascaraZonas)0);
+
+bool establecerPotenciaZona(int zona, uint16_t vatios);
+const EnergiaZona &energiaZona(int zona);
+
+void iniciarEnergia();
+void persistirEnergia();
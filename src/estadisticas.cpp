@@ -0,0 +1,83 @@
+#include "estadisticas.h"
+#include "zones.h"
+#include "time_utils.h"
+
+static EstadisticasZona estadisticas[CANTIDAD_ZONAS];
+static unsigned long ultimaAcumulacion[CANTIDAD_ZONAS];
+static unsigned long inicioSesion[CANTIDAD_ZONAS];
+static int cubetaAbierta = -1;
+static unsigned long ultimoTick = 0;
+
+int cubetaHoraSemana()
+{
+    return diaSemanaActual() * 24 + horaActual();
+}
+
+// Suma a la cubeta abierta el tiempo encendida desde la última acumulación
+static void acumularTiempoEncendida(int zona, unsigned long ahora)
+{
+    if (cubetaAbierta < 0)
+    {
+        cubetaAbierta = cubetaHoraSemana();
+    }
+    if (zonas[zona].estaActivo)
+    {
+        estadisticas[zona].milisegundosEncendida[cubetaAbierta] += ahora - ultimaAcumulacion[zona];
+    }
+    ultimaAcumulacion[zona] = ahora;
+}
+
+void cambioEstadoEstadisticas(int zona, bool encender)
+{
+    if (zonas[zona].estaActivo == encender)
+    {
+        return;
+    }
+    unsigned long ahora = millis();
+    acumularTiempoEncendida(zona, ahora);
+    if (encender)
+    {
+        estadisticas[zona].encendidos++;
+        inicioSesion[zona] = ahora;
+    }
+}
+
+void movimientoEstadisticas(int zona)
+{
+    if (cubetaAbierta < 0)
+    {
+        cubetaAbierta = cubetaHoraSemana();
+    }
+    estadisticas[zona].movimientos[cubetaAbierta]++;
+}
+
+// Llamar antes de apagar la zona: la sesión va desde el encendido hasta ahora
+void apagadoTimeoutEstadisticas(int zona)
+{
+    estadisticas[zona].apagadosTimeout++;
+    estadisticas[zona].segundosHastaTimeout += (millis() - inicioSesion[zona]) / 1000;
+}
+
+// Llamado desde loop(): suma el tiempo encendida de todas las zonas cada
+// INTERVALO_ACUMULACION_ESTADISTICAS_MS y, al cambiar la hora (o si se ajusta
+// el reloj), cierra la cubeta anterior con el tiempo que le corresponde
+void actualizarEstadisticas()
+{
+    int cubeta = cubetaHoraSemana();
+    unsigned long ahora = millis();
+    if (cubeta == cubetaAbierta && ahora - ultimoTick < INTERVALO_ACUMULACION_ESTADISTICAS_MS)
+    {
+        return;
+    }
+    ultimoTick = ahora;
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        acumularTiempoEncendida(i, ahora);
+    }
+    cubetaAbierta = cubeta;
+}
+
+const EstadisticasZona &estadisticasZona(int zona)
+{
+    return estadisticas[zona];
+}
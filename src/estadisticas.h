@@ -0,0 +1,31 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Agregados de ocupación por zona, mantenidos de forma incremental en cada
+// cambio de estado, flanco PIR y en el tick del loop (cada
+// INTERVALO_ACUMULACION_ESTADISTICAS_MS y en cada cambio de hora): tiempo
+// encendida y movimientos por hora de la semana (lunes 00:00 = cubeta 0) y
+// tiempo medio hasta el apagado automático. Consultarlos no modifica nada ni
+// recorre historial.
+
+const int HORAS_SEMANA = 7 * 24;
+
+struct EstadisticasZona
+{
+    uint32_t milisegundosEncendida[HORAS_SEMANA];
+    uint32_t movimientos[HORAS_SEMANA];
+    uint32_t encendidos;
+    uint32_t apagadosTimeout;
+    uint32_t segundosHastaTimeout;   // Suma de la duración de las sesiones cerradas por timeout
+};
+
+// Llamar antes de que cambie zonas[zona].estaActivo
+void cambioEstadoEstadisticas(int zona, bool encender);
+void movimientoEstadisticas(int zona);
+void apagadoTimeoutEstadisticas(int zona);
+// Tick del loop: suma el tiempo encendida y cierra la cubeta al cambiar la hora
+void actualizarEstadisticas();
+
+int cubetaHoraSemana();
+const EstadisticasZona &estadisticasZona(int zona);
@@ -0,0 +1,86 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Formato de la bitácora binaria de eventos. Lo comparten el firmware
+// (/bitacora.bin en LittleFS y GET /log.bin) y tools/decodificar_bitacora.cpp,
+// por eso solo depende de la biblioteca estándar de C.
+//
+// El archivo es un arreglo circular de SEGMENTOS_BITACORA segmentos de tamaño
+// fijo. Cada segmento es una cabecera seguida de REGISTROS_POR_SEGMENTO
+// registros de 4 bytes, de los cuales solo los primeros "cantidad" son
+// válidos. Todo en little-endian (el del ESP32 y de las PC).
+
+enum TipoEvento : uint8_t
+{
+    EVENTO_SALTO,                   // Sin evento: solo avanza el reloj 0xFFFF décimas
+    EVENTO_ENCENDIDO_MANUAL,
+    EVENTO_APAGADO_MANUAL,
+    EVENTO_APAGADO_TIMEOUT,
+    EVENTO_MOVIMIENTO_ENCENDIDA,    // PIR con la zona encendida: extiende el tiempo
+    EVENTO_MOVIMIENTO_APAGADA,      // PIR con la zona apagada: no se enciende (ahorro)
+    CANTIDAD_TIPOS_EVENTO
+};
+
+struct RegistroEvento
+{
+    uint16_t deltaDecimas;  // Décimas de segundo desde el registro anterior del segmento
+    uint8_t tipo;           // TipoEvento
+    uint8_t zona;
+};
+
+struct CabeceraSegmento
+{
+    uint32_t magia;
+    uint32_t secuencia;      // Crece durante toda la vida del archivo, también entre arranques
+    uint32_t arranque;       // Número de arranque del equipo
+    uint32_t inicioDecimas;  // Décimas de segundo desde el arranque hasta el primer registro
+    uint16_t cantidad;       // Registros válidos
+    uint16_t reservado;
+    uint32_t crc;            // CRC-32 de la cabecera (con crc = 0) y de los registros válidos
+};
+
+const uint32_t MAGIA_SEGMENTO_BITACORA = 0x31544942; // "BIT1"
+const int REGISTROS_POR_SEGMENTO = 128;
+const int SEGMENTOS_BITACORA = 64;
+const size_t BYTES_SEGMENTO_BITACORA = sizeof(CabeceraSegmento) + REGISTROS_POR_SEGMENTO * sizeof(RegistroEvento);
+const uint16_t DELTA_MAXIMO_BITACORA = 0xFFFF;
+
+static_assert(sizeof(RegistroEvento) == 4, "Los registros de la bitácora ocupan 4 bytes");
+static_assert(sizeof(CabeceraSegmento) == 24, "La cabecera de segmento no debe tener relleno");
+
+inline const char *nombreTipoEvento(uint8_t tipo)
+{
+    static const char *const nombres[CANTIDAD_TIPOS_EVENTO] = {
+        "salto", "encendido_manual", "apagado_manual", "apagado_timeout", "movimiento_encendida", "movimiento_apagada"};
+    return tipo < CANTIDAD_TIPOS_EVENTO ? nombres[tipo] : "desconocido";
+}
+
+// CRC-32 IEEE (el mismo de zlib); se encadena pasando el resultado anterior
+inline uint32_t crc32Bitacora(uint32_t crc, const uint8_t *datos, size_t largo)
+{
+    crc = ~crc;
+    while (largo--)
+    {
+        crc ^= *datos++;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+inline uint32_t calcularCrcSegmento(const CabeceraSegmento &cabecera, const RegistroEvento registros[])
+{
+    CabeceraSegmento copia = cabecera;
+    copia.crc = 0;
+    uint32_t crc = crc32Bitacora(0, reinterpret_cast<const uint8_t *>(&copia), sizeof(copia));
+    return crc32Bitacora(crc, reinterpret_cast<const uint8_t *>(registros), cabecera.cantidad * sizeof(RegistroEvento));
+}
+
+inline bool segmentoValido(const CabeceraSegmento &cabecera, const RegistroEvento registros[])
+{
+    return cabecera.magia == MAGIA_SEGMENTO_BITACORA && cabecera.cantidad <= REGISTROS_POR_SEGMENTO &&
+           cabecera.crc == calcularCrcSegmento(cabecera, registros);
+}
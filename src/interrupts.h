@@ -7,4 +7,8 @@ extern bool estadosAnterioresPIR[];
 extern unsigned long ultimaLecturaPIR;
 
 // Función principal para procesar PIR por polling
-void procesarInterrupcionesPIR();
\ No newline at end of file
+void procesarInterrupcionesPIR();
+
+// Último nivel leído del PIR, también en horario laboral: es el "sensorActual"
+// publicado y cada cambio avanza la generación de estado
+bool nivelSensorPIR(int zona);
\ No newline at end of file
@@ -11,6 +11,21 @@
 #include "websocket.h"
 #include "time_utils.h"
 #include "interrupts.h"
+#include "api.h"
+#include "sse.h"
+#include "metricas.h"
+#include "memoria.h"
+#include "vigilancia.h"
+#include "bitacora.h"
+#include "estadisticas.h"
+#include "energia.h"
+#include "persistencia.h"
+#include "calendario.h"
+#include "configuracion.h"
+#include "adaptacion.h"
+#include "comandos.h"
+#include "planificador.h"
+#include <atomic>
 
 // Variables para mejorar sincronización WebSocket
 unsigned long ultimaActualizacionSensor = 0;
@@ -20,20 +35,14 @@ bool estadoSensoresAnterior[CANTIDAD_ZONAS] = {false, false};
 DNSServer dnsServer;
 const byte DNS_PORT = 53;
 
-void setup() {
-  delay(2000);
-  Serial.begin(115200);
-  Serial.println("Iniciando sistema...");
+// La red se levanta en una tarea aparte; el loop no atiende HTTP, WebSocket
+// ni DNS hasta que esta bandera se activa
+static std::atomic<bool> redLista(false);
 
-  // Inicializar pines
-  for (int i = 0; i < CANTIDAD_ZONAS; i++) {
-    pinMode(zonas[i].pinPir, INPUT);
-    for (int j = 0; j < 2; j++) {
-      pinMode(zonas[i].pinesRelay[j], OUTPUT);
-      digitalWrite(zonas[i].pinesRelay[j], VALOR_RELAY_APAGADO);
-    }
-  }
+// El loop lee la configuración en uso; entre vueltas no retiene referencias
+static int lectorConfiguracionLoop = -1;
 
+static void iniciarRed() {
   // Configurar como punto de acceso WiFi
   WiFi.softAP(ssid, password);
   Serial.println("\nPunto de acceso creado");
@@ -63,19 +72,31 @@ void setup() {
   Serial.printf("🌐 IP directa: http://%s\n", WiFi.softAPIP().toString().c_str());
   Serial.println("===========================================\n");
 
-  // Iniciar el reloj interno
-  referenciaDelTiempo = millis();
-
-  // Las interrupciones PIR han sido reemplazadas por lectura en loop()
-  // Esto es más estable y eficiente para sensores PIR que tienen retardo interno
-  Serial.println("Sensores PIR configurados para lectura por polling (más estable)");
-
-  // Configurar rutas del servidor web
+  // Configurar rutas del servidor web (el contador de peticiones va primero para ver todas)
+  servidor.addHandler(&contadorPeticionesHttp);
   servidor.on("/", manejarPaginaPrincipal);
   servidor.on("/on", manejarControlManual);
   servidor.on("/off", manejarControlManual);
   servidor.on("/update", HTTP_POST, manejarActualizacionHorarios);
   servidor.on("/settime", HTTP_POST, manejarConfiguracionHora);
+  servidor.on("/api/zones", HTTP_PATCH, manejarApiZonas);
+  servidor.on("/api/state", HTTP_GET, manejarApiEstado);
+  servidor.on("/metrics", HTTP_GET, manejarMetricas);
+  servidor.on("/api/memoria", HTTP_GET, manejarApiMemoria);
+  servidor.on("/api/trazas", HTTP_GET, manejarApiTrazas);
+  servidor.on("/api/vigilancia", HTTP_GET, manejarApiVigilancia);
+  servidor.on("/log.bin", HTTP_GET, manejarDescargaBitacora);
+  servidor.on("/api/stats", HTTP_GET, manejarApiEstadisticas);
+  servidor.on("/api/energia", HTTP_GET, manejarApiEnergia);
+  servidor.on("/api/energia", HTTP_PATCH, manejarConfiguracionEnergia);
+  servidor.on("/api/calendario", HTTP_GET, manejarApiCalendario);
+  servidor.on("/api/calendario", HTTP_PATCH, manejarConfiguracionCalendario);
+  servidor.on("/api/configuracion", HTTP_GET, manejarApiConfiguracion);
+  servidor.on("/api/configuracion", HTTP_PATCH, manejarConfiguracionPoliticas);
+
+  // Cabeceras que WebServer debe conservar para los handlers
+  const char *cabecerasRecolectadas[] = {"If-None-Match"};
+  servidor.collectHeaders(cabecerasRecolectadas, 1);
   
   // Captive Portal: Redirigir cualquier dominio no reconocido
   servidor.onNotFound([]() {
@@ -105,56 +126,193 @@ void setup() {
   servidor.begin();
   Serial.println("Servidor HTTP iniciado");
   Serial.println("Servidor WebSocket iniciado en puerto 81");
-  
-  // Inicializar estado del sistema
-  estaEnHorarioLaboral = verificarSiEsHorarioLaboral();
-  Serial.printf("Estado inicial: %s\n", estaEnHorarioLaboral ? "Horario Laboral" : "Fuera de Horario");
-  
-  // Mostrar estado inicial de las zonas
-  for (int i = 0; i < CANTIDAD_ZONAS; i++) {
-    Serial.printf("Zona %d: %s, PIR pin %d, Relays %d y %d\n", 
-      i+1, zonas[i].nombre.c_str(), zonas[i].pinPir, 
-      zonas[i].pinesRelay[0], zonas[i].pinesRelay[1]);
+  iniciarServidorEventos();
+}
+
+static void tareaRed(void *) {
+  iniciarRed();
+  iniciarSntp();
+  marcarHitoArranque(HITO_ARRANQUE_RED);
+  redLista.store(true, std::memory_order_release);
+
+  Serial.printf("⚡ Arranque: relays (%s) en %lu µs, configuración en %lu ms, loop en %lu ms, red en %lu ms\n",
+    origenRestauracionZonas(), (unsigned long)hitoArranqueUs(HITO_ARRANQUE_RELAYS),
+    (unsigned long)hitoArranqueUs(HITO_ARRANQUE_CONFIGURACION) / 1000,
+    (unsigned long)hitoArranqueUs(HITO_ARRANQUE_LOOP) / 1000,
+    (unsigned long)hitoArranqueUs(HITO_ARRANQUE_RED) / 1000);
+  vTaskDelete(nullptr);
+}
+
+// Etapas del loop como tareas del planificador (ver planificador.h). Las de
+// control corren en cada pasada; las de red solo cuando la red está lista.
+static ResultadoTarea tareaHttp(ContextoTarea &) {
+  if (redLista.load(std::memory_order_acquire)) {
+    servidor.handleClient();
   }
+  return TAREA_TERMINADA;
 }
 
-void loop() {
-  servidor.handleClient();
-  socketWeb.loop();
-  actualizarRelojInterno();
-  
-  // Mantener servicios de dominio personalizado activos
-  dnsServer.processNextRequest();  // Captive Portal
+static ResultadoTarea tareaWebSocket(ContextoTarea &) {
+  if (redLista.load(std::memory_order_acquire)) {
+    socketWeb.loop();
+  }
+  return TAREA_TERMINADA;
+}
+
+static ResultadoTarea tareaDns(ContextoTarea &) {
+  if (redLista.load(std::memory_order_acquire)) {
+    dnsServer.processNextRequest();  // Captive Portal
+    incrementarContador(CONTADOR_CICLOS_DNS);
+  }
   // Nota: MDNS no necesita update() en ESP32 Arduino
+  return TAREA_TERMINADA;
+}
 
-  // Actualizar modo horario
-  bool nuevoModoHorario = verificarSiEsHorarioLaboral();
-  if (estaEnHorarioLaboral != nuevoModoHorario) {
-    estaEnHorarioLaboral = nuevoModoHorario;
-    Serial.printf("*** CAMBIO DE MODO *** De %s a %s\n", 
-      !estaEnHorarioLaboral ? "Horario Laboral" : "Fuera de Horario",
-      estaEnHorarioLaboral ? "Horario Laboral" : "Fuera de Horario");
-
-    if (!estaEnHorarioLaboral) {
-      for (int i = 0; i < CANTIDAD_ZONAS; i++) {
-        if (zonas[i].estaActivo) {
-          zonas[i].ultimoMovimiento = millis();
-          Serial.printf("Zona %d: Tiempo de movimiento actualizado por cambio de modo\n", i + 1);
-        }
-      }
-    }
+static ResultadoTarea tareaReloj(ContextoTarea &) {
+  actualizarRelojInterno();
+  return TAREA_TERMINADA;
+}
+
+static ResultadoTarea tareaModo(ContextoTarea &) {
+  if (actualizarModoZonas()) {
+    enviarEstadoPorSocketWeb();
+  }
+  return TAREA_TERMINADA;
+}
+
+// Órdenes de zona que dejaron los handlers de red
+static ResultadoTarea tareaComandos(ContextoTarea &) {
+  if (aplicarComandosPendientes() > 0) {
+    responderComandosAplicados();
     enviarEstadoPorSocketWeb();
   }
+  return TAREA_TERMINADA;
+}
 
+static ResultadoTarea tareaPir(ContextoTarea &) {
   procesarInterrupcionesPIR();
+  return TAREA_TERMINADA;
+}
+
+static ResultadoTarea tareaApagado(ContextoTarea &) {
   controlarApagadoAutomatico();
+  if (aplicarTimeoutsAdaptativos()) {
+    enviarEstadoPorSocketWeb();
+  }
+  return TAREA_TERMINADA;
+}
 
-  // Enviar estado WebSocket periódicamente
+static ResultadoTarea tareaEsperas(ContextoTarea &) {
+  if (redLista.load(std::memory_order_acquire)) {
+    atenderServidorEventos();
+  }
+  atenderEsperasEstado();
+  return TAREA_TERMINADA;
+}
+
+// Enviar estado WebSocket periódicamente
+static ResultadoTarea tareaDifusion(ContextoTarea &) {
   static unsigned long ultimoEnvioWebSocket = 0;
   if (millis() - ultimoEnvioWebSocket > 500) {
     enviarEstadoPorSocketWeb();
     ultimoEnvioWebSocket = millis();
   }
+  return TAREA_TERMINADA;
+}
+
+static ResultadoTarea tareaEstadisticas(ContextoTarea &) {
+  actualizarEstadisticas();
+  return TAREA_TERMINADA;
+}
+
+static ResultadoTarea tareaMemoria(ContextoTarea &) {
+  muestrearMemoria();
+  return TAREA_TERMINADA;
+}
+
+// Una clave de NVS por paso: el control corre entre escrituras de flash
+static ResultadoTarea tareaPersistencia(ContextoTarea &contexto) {
+  TAREA_INICIO(contexto);
+  persistirEnergia();
+  while (atenderPersistencia()) {
+    TAREA_CEDER(contexto);
+  }
+  TAREA_FIN(contexto);
+}
+
+static ResultadoTarea tareaBitacora(ContextoTarea &) {
+  volcarBitacora();
+  return TAREA_TERMINADA;
+}
 
-  delay(10);
-}
\ No newline at end of file
+static void registrarTareasLoop() {
+  registrarTareaLoop("reloj", ETAPA_LOOP_RELOJ, PRIORIDAD_CONTROL, tareaReloj);
+  registrarTareaLoop("modo", ETAPA_LOOP_MODO, PRIORIDAD_CONTROL, tareaModo);
+  registrarTareaLoop("comandos", ETAPA_LOOP_COMANDOS, PRIORIDAD_CONTROL, tareaComandos);
+  registrarTareaLoop("pir", ETAPA_LOOP_PIR, PRIORIDAD_CONTROL, tareaPir);
+  registrarTareaLoop("apagado", ETAPA_LOOP_APAGADO, PRIORIDAD_CONTROL, tareaApagado);
+  registrarTareaLoop("http", ETAPA_LOOP_HTTP, PRIORIDAD_RED, tareaHttp);
+  registrarTareaLoop("websocket", ETAPA_LOOP_WEBSOCKET, PRIORIDAD_RED, tareaWebSocket);
+  registrarTareaLoop("dns", ETAPA_LOOP_DNS, PRIORIDAD_RED, tareaDns);
+  registrarTareaLoop("esperas", ETAPA_LOOP_ESPERAS, PRIORIDAD_RED, tareaEsperas);
+  registrarTareaLoop("difusion", ETAPA_LOOP_DIFUSION, PRIORIDAD_RED, tareaDifusion);
+  registrarTareaLoop("estadisticas", ETAPA_LOOP_ESTADISTICAS, PRIORIDAD_FONDO, tareaEstadisticas);
+  registrarTareaLoop("memoria", ETAPA_LOOP_MEMORIA, PRIORIDAD_FONDO, tareaMemoria);
+  registrarTareaLoop("persistencia", ETAPA_LOOP_PERSISTENCIA, PRIORIDAD_FONDO, tareaPersistencia);
+  registrarTareaLoop("bitacora", ETAPA_LOOP_BITACORA, PRIORIDAD_FONDO, tareaBitacora);
+}
+
+void setup() {
+  // Lo primero: devolver los relays al estado anterior a un reinicio por
+  // watchdog, pánico o caída de tensión, antes de cualquier espera
+  restaurarRelaysArranqueRapido();
+  marcarHitoArranque(HITO_ARRANQUE_RELAYS);
+
+  Serial.begin(115200);
+  Serial.println("Iniciando sistema...");
+  iniciarVigilancia();
+
+  // Configuración y estado guardados antes del último corte
+  iniciarPersistencia();
+  restaurarConfiguracionHoraria();
+  restaurarPoliticasZonas();
+  iniciarAdaptacion();
+  restaurarEstadoZonas();
+  iniciarEnergia();
+  lectorConfiguracionLoop = registrarLectorConfiguracion();
+  registrarTareasLoop();
+  marcarHitoArranque(HITO_ARRANQUE_CONFIGURACION);
+  iniciarBitacora(numeroArranque());
+
+  // Las interrupciones PIR han sido reemplazadas por lectura en loop()
+  // Esto es más estable y eficiente para sensores PIR que tienen retardo interno
+  Serial.println("Sensores PIR configurados para lectura por polling (más estable)");
+
+  // WiFi, mDNS, DNS y servidores en segundo plano: el control de zonas
+  // empieza a funcionar sin esperarlos
+  if (xTaskCreatePinnedToCore(tareaRed, "red", PILA_TAREA_RED, nullptr, 1, nullptr, NUCLEO_TAREA_RED) != pdPASS) {
+    Serial.println("❌ No se pudo crear la tarea de red, se inicia en setup()");
+    iniciarRed();
+    marcarHitoArranque(HITO_ARRANQUE_RED);
+    redLista.store(true, std::memory_order_release);
+  }
+
+  // El modo ya lo calculó restaurarEstadoZonas()
+  Serial.printf("Estado inicial: %s\n", estaEnHorarioLaboral ? "Horario Laboral" : "Fuera de Horario");
+  
+  // Mostrar estado inicial de las zonas
+  for (int i = 0; i < CANTIDAD_ZONAS; i++) {
+    Serial.printf("Zona %d: %s, PIR pin %d, Relays %d y %d\n", 
+      i+1, zonas[i].nombre.c_str(), zonas[i].pinPir, 
+      zonas[i].pinesRelay[0], zonas[i].pinesRelay[1]);
+  }
+}
+
+void loop() {
+  marcarHitoArranque(HITO_ARRANQUE_LOOP);
+  incrementarContador(CONTADOR_ITERACIONES_LOOP);
+  marcarLectorQuiescente(lectorConfiguracionLoop);
+  atenderConfiguracion();
+  bool hayPendientes = ejecutarVueltaPlanificador();
+  esperarVueltaPlanificador(hayPendientes);
+}
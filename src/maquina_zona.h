@@ -0,0 +1,159 @@
+#pragma once
+#include <stdint.h>
+
+// Máquina de estados de cada zona. Todo lo que le pasa a una zona llega como
+// un suceso (flanco PIR, aviso o vencimiento del timeout, cambio de modo,
+// orden del usuario) y la tabla de abajo dice a qué estado pasa y qué
+// acciones hay que ejecutar; zones.cpp encola los sucesos y los despacha
+// juntos. Solo depende de stdint para poder probarla aislada.
+
+enum EstadoZona : uint8_t
+{
+    ESTADO_APAGADA,                  // Fuera de horario: el PIR no la enciende
+    ESTADO_APAGADA_LABORAL,
+    ESTADO_ENCENDIDA_LABORAL,        // Encendida a mano en horario laboral: solo se apaga a mano
+    ESTADO_ENCENDIDA_FUERA_HORARIO,  // Corre el timeout desde el último movimiento
+    ESTADO_POR_EXPIRAR,              // Último tramo del timeout sin movimiento
+    CANTIDAD_ESTADOS_ZONA
+};
+
+enum SucesoZona : uint8_t
+{
+    SUCESO_MOVIMIENTO,      // Flanco de subida del PIR fuera de horario
+    SUCESO_AVISO,           // Entra en el último tramo del timeout
+    SUCESO_TIMEOUT,         // Venció el timeout sin movimiento
+    SUCESO_ENTRA_HORARIO,   // La zona entra en horario laboral según su calendario
+    SUCESO_SALE_HORARIO,
+    SUCESO_ENCENDER,        // Orden del usuario (HTTP, WebSocket, API)
+    SUCESO_APAGAR,
+    CANTIDAD_SUCESOS_ZONA
+};
+
+enum AccionZona : uint8_t
+{
+    ACCION_ENCENDER = 1 << 0,
+    ACCION_APAGAR = 1 << 1,
+    ACCION_REINICIAR_TIMER = 1 << 2,   // Último movimiento = ahora
+    ACCION_MOVIMIENTO = 1 << 3,        // Bitácora, estadísticas y energía del flanco PIR
+    ACCION_TIMEOUT = 1 << 4,           // Contabilidad del apagado automático
+    ACCION_MANUAL = 1 << 5             // Bitácora del encendido o apagado manual
+};
+
+struct TransicionZona
+{
+    EstadoZona siguiente;
+    uint8_t acciones;
+};
+
+// Filas: estado actual; columnas: suceso, en el orden de SucesoZona
+constexpr TransicionZona TABLA_TRANSICIONES_ZONA[][CANTIDAD_SUCESOS_ZONA] = {
+    // ESTADO_APAGADA
+    {{ESTADO_APAGADA, ACCION_MOVIMIENTO},
+     {ESTADO_APAGADA, 0},
+     {ESTADO_APAGADA, 0},
+     {ESTADO_APAGADA_LABORAL, 0},
+     {ESTADO_APAGADA, 0},
+     {ESTADO_ENCENDIDA_FUERA_HORARIO, ACCION_ENCENDER | ACCION_REINICIAR_TIMER | ACCION_MANUAL},
+     {ESTADO_APAGADA, 0}},
+    // ESTADO_APAGADA_LABORAL
+    {{ESTADO_APAGADA_LABORAL, 0},
+     {ESTADO_APAGADA_LABORAL, 0},
+     {ESTADO_APAGADA_LABORAL, 0},
+     {ESTADO_APAGADA_LABORAL, 0},
+     {ESTADO_APAGADA, 0},
+     {ESTADO_ENCENDIDA_LABORAL, ACCION_ENCENDER | ACCION_REINICIAR_TIMER | ACCION_MANUAL},
+     {ESTADO_APAGADA_LABORAL, 0}},
+    // ESTADO_ENCENDIDA_LABORAL
+    {{ESTADO_ENCENDIDA_LABORAL, 0},
+     {ESTADO_ENCENDIDA_LABORAL, 0},
+     {ESTADO_ENCENDIDA_LABORAL, 0},
+     {ESTADO_ENCENDIDA_LABORAL, 0},
+     {ESTADO_ENCENDIDA_FUERA_HORARIO, ACCION_REINICIAR_TIMER},   // El timeout cuenta desde el cambio de modo
+     {ESTADO_ENCENDIDA_LABORAL, ACCION_REINICIAR_TIMER},
+     {ESTADO_APAGADA_LABORAL, ACCION_APAGAR | ACCION_MANUAL}},
+    // ESTADO_ENCENDIDA_FUERA_HORARIO
+    {{ESTADO_ENCENDIDA_FUERA_HORARIO, ACCION_MOVIMIENTO | ACCION_REINICIAR_TIMER},
+     {ESTADO_POR_EXPIRAR, 0},
+     {ESTADO_APAGADA, ACCION_APAGAR | ACCION_TIMEOUT},
+     {ESTADO_ENCENDIDA_LABORAL, 0},
+     {ESTADO_ENCENDIDA_FUERA_HORARIO, 0},
+     {ESTADO_ENCENDIDA_FUERA_HORARIO, ACCION_REINICIAR_TIMER},
+     {ESTADO_APAGADA, ACCION_APAGAR | ACCION_MANUAL}},
+    // ESTADO_POR_EXPIRAR
+    {{ESTADO_ENCENDIDA_FUERA_HORARIO, ACCION_MOVIMIENTO | ACCION_REINICIAR_TIMER},
+     {ESTADO_POR_EXPIRAR, 0},
+     {ESTADO_APAGADA, ACCION_APAGAR | ACCION_TIMEOUT},
+     {ESTADO_ENCENDIDA_LABORAL, 0},
+     {ESTADO_POR_EXPIRAR, 0},
+     {ESTADO_ENCENDIDA_FUERA_HORARIO, ACCION_REINICIAR_TIMER},
+     {ESTADO_APAGADA, ACCION_APAGAR | ACCION_MANUAL}},
+};
+
+constexpr bool estadoEncendido(EstadoZona estado)
+{
+    return estado == ESTADO_ENCENDIDA_LABORAL || estado == ESTADO_ENCENDIDA_FUERA_HORARIO ||
+           estado == ESTADO_POR_EXPIRAR;
+}
+
+constexpr bool estadoLaboral(EstadoZona estado)
+{
+    return estado == ESTADO_APAGADA_LABORAL || estado == ESTADO_ENCENDIDA_LABORAL;
+}
+
+constexpr EstadoZona estadoParaZona(bool encendida, bool laboral)
+{
+    return encendida ? (laboral ? ESTADO_ENCENDIDA_LABORAL : ESTADO_ENCENDIDA_FUERA_HORARIO)
+                     : (laboral ? ESTADO_APAGADA_LABORAL : ESTADO_APAGADA);
+}
+
+constexpr TransicionZona transicionZona(EstadoZona estado, SucesoZona suceso)
+{
+    return TABLA_TRANSICIONES_ZONA[estado][suceso];
+}
+
+// Comprobaciones de la tabla en tiempo de compilación (recursivas para que
+// también valgan con el C++11 del núcleo de Arduino). Una fila incompleta deja
+// transiciones {ESTADO_APAGADA, 0} que rompen alguna de estas reglas.
+constexpr bool transicionCoherente(EstadoZona estado, SucesoZona suceso, TransicionZona transicion)
+{
+    return transicion.siguiente < CANTIDAD_ESTADOS_ZONA &&
+           // Los relays cambian si y solo si cambia el estado encendido
+           estadoEncendido(transicion.siguiente) ==
+               ((estadoEncendido(estado) && !(transicion.acciones & ACCION_APAGAR)) ||
+                (transicion.acciones & ACCION_ENCENDER)) &&
+           !((transicion.acciones & ACCION_ENCENDER) && estadoEncendido(estado)) &&
+           !((transicion.acciones & ACCION_APAGAR) && !estadoEncendido(estado)) &&
+           // El modo solo lo cambian los sucesos de modo
+           estadoLaboral(transicion.siguiente) ==
+               (suceso == SUCESO_ENTRA_HORARIO ? true
+                : suceso == SUCESO_SALE_HORARIO ? false
+                                                : estadoLaboral(estado)) &&
+           // En horario laboral no hay movimiento ni timeout
+           !((transicion.acciones & (ACCION_MOVIMIENTO | ACCION_TIMEOUT)) && estadoLaboral(estado)) &&
+           // El timeout solo apaga y solo lo produce su suceso
+           (!(transicion.acciones & ACCION_TIMEOUT) ||
+            (suceso == SUCESO_TIMEOUT && (transicion.acciones & ACCION_APAGAR))) &&
+           // Las órdenes del usuario siempre quedan en el estado pedido
+           (suceso != SUCESO_ENCENDER || estadoEncendido(transicion.siguiente)) &&
+           (suceso != SUCESO_APAGAR || !estadoEncendido(transicion.siguiente));
+}
+
+constexpr bool tablaZonaCoherente(int indice = 0)
+{
+    return indice >= CANTIDAD_ESTADOS_ZONA * CANTIDAD_SUCESOS_ZONA ||
+           (transicionCoherente((EstadoZona)(indice / CANTIDAD_SUCESOS_ZONA),
+                                (SucesoZona)(indice % CANTIDAD_SUCESOS_ZONA),
+                                TABLA_TRANSICIONES_ZONA[indice / CANTIDAD_SUCESOS_ZONA][indice % CANTIDAD_SUCESOS_ZONA]) &&
+            tablaZonaCoherente(indice + 1));
+}
+
+static_assert(sizeof(TABLA_TRANSICIONES_ZONA) / sizeof(TABLA_TRANSICIONES_ZONA[0]) == CANTIDAD_ESTADOS_ZONA,
+              "La tabla de transiciones necesita una fila por estado");
+static_assert(tablaZonaCoherente(), "La tabla de transiciones de zona no es coherente");
+
+inline const char *nombreEstadoZona(uint8_t estado)
+{
+    static const char *const nombres[CANTIDAD_ESTADOS_ZONA] = {
+        "apagada", "apagada_laboral", "encendida_laboral", "encendida", "por_expirar"};
+    return estado < CANTIDAD_ESTADOS_ZONA ? nombres[estado] : "desconocido";
+}
@@ -0,0 +1,107 @@
+#include "memoria.h"
+#include "config.h"
+#include "zones.h"
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Tareas vigiladas: la del loop de Arduino, la pila TCP/IP y el timer del sistema
+static const char *const nombresTareas[] = {"loopTask", "tiT", "esp_timer", "IDLE0", "IDLE1"};
+static const int CANTIDAD_TAREAS = sizeof(nombresTareas) / sizeof(nombresTareas[0]);
+
+static MuestraMemoria historialMemoria[MUESTRAS_MEMORIA];
+static int siguienteMuestra = 0;
+static int muestrasGuardadas = 0;
+static int muestrasCriticasSeguidas = 0;
+static unsigned long ultimoMuestreo = 0;
+static MuestraMemoria muestraActual;
+
+static void evaluarReinicioPorFragmentacion()
+{
+    if (muestraActual.bloqueMaximo >= BLOQUE_MINIMO_SEGURO)
+    {
+        muestrasCriticasSeguidas = 0;
+        return;
+    }
+
+    muestrasCriticasSeguidas++;
+    Serial.printf("⚠️ Memoria fragmentada: bloque máximo %u B (libre %u B), muestra crítica %d/%d\n",
+                  muestraActual.bloqueMaximo, muestraActual.heapLibre,
+                  muestrasCriticasSeguidas, MUESTRAS_CRITICAS_PARA_REINICIO);
+
+    if (!REINICIO_POR_FRAGMENTACION || muestrasCriticasSeguidas < MUESTRAS_CRITICAS_PARA_REINICIO)
+    {
+        return;
+    }
+
+    // Reinicio controlado: solo con todas las zonas apagadas para no dejar a oscuras a nadie
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        if (zonas[i].estaActivo)
+        {
+            Serial.println("Reinicio por fragmentación pospuesto: hay zonas encendidas");
+            return;
+        }
+    }
+    Serial.println("🔄 Reiniciando por fragmentación del heap");
+    Serial.flush();
+    ESP.restart();
+}
+
+void muestrearMemoria()
+{
+    unsigned long tiempoActual = millis();
+    if (muestrasGuardadas > 0 && tiempoActual - ultimoMuestreo < INTERVALO_MUESTREO_MEMORIA_MS)
+    {
+        return;
+    }
+    ultimoMuestreo = tiempoActual;
+
+    muestraActual.segundosActivo = tiempoActual / 1000;
+    muestraActual.heapLibre = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    muestraActual.bloqueMaximo = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    muestraActual.heapMinimo = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+
+    historialMemoria[siguienteMuestra] = muestraActual;
+    siguienteMuestra = (siguienteMuestra + 1) % MUESTRAS_MEMORIA;
+    if (muestrasGuardadas < MUESTRAS_MEMORIA)
+    {
+        muestrasGuardadas++;
+    }
+
+    evaluarReinicioPorFragmentacion();
+}
+
+// Copia el historial del más antiguo al más reciente
+int obtenerHistorialMemoria(MuestraMemoria destino[], int capacidad)
+{
+    int cantidad = min(capacidad, muestrasGuardadas);
+    int inicio = (siguienteMuestra - cantidad + MUESTRAS_MEMORIA) % MUESTRAS_MEMORIA;
+    for (int i = 0; i < cantidad; i++)
+    {
+        destino[i] = historialMemoria[(inicio + i) % MUESTRAS_MEMORIA];
+    }
+    return cantidad;
+}
+
+int obtenerPilasTareas(PilaTarea destino[], int capacidad)
+{
+    int cantidad = 0;
+    for (int i = 0; i < CANTIDAD_TAREAS && cantidad < capacidad; i++)
+    {
+        TaskHandle_t tarea = xTaskGetHandle(nombresTareas[i]);
+        if (tarea == nullptr)
+        {
+            continue;
+        }
+        destino[cantidad].nombre = nombresTareas[i];
+        destino[cantidad].libreMinima = uxTaskGetStackHighWaterMark(tarea);
+        cantidad++;
+    }
+    return cantidad;
+}
+
+const MuestraMemoria &ultimaMuestraMemoria()
+{
+    return muestraActual;
+}
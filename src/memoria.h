@@ -0,0 +1,25 @@
+#pragma once
+#include <Arduino.h>
+
+// Telemetría de memoria: muestreo periódico del heap y de la pila libre de
+// las tareas principales, con historial circular para detectar fragmentación
+// progresiva en equipos que llevan semanas encendidos.
+
+struct MuestraMemoria
+{
+    uint32_t segundosActivo;
+    uint32_t heapLibre;
+    uint32_t bloqueMaximo;  // Mayor bloque contiguo reservable
+    uint32_t heapMinimo;    // Mínimo histórico desde el arranque
+};
+
+struct PilaTarea
+{
+    const char *nombre;
+    uint32_t libreMinima;   // Marca de agua alta (bytes que nunca se usaron)
+};
+
+void muestrearMemoria();
+int obtenerHistorialMemoria(MuestraMemoria destino[], int capacidad);
+int obtenerPilasTareas(PilaTarea destino[], int capacidad);
+const MuestraMemoria &ultimaMuestraMemoria();
@@ -0,0 +1,31 @@
+#include "metricas.h"
+
+std::atomic<uint32_t> contadores[CANTIDAD_CONTADORES];
+std::atomic<int32_t> medidores[CANTIDAD_MEDIDORES];
+std::atomic<uint32_t> conmutacionesRelay[CANTIDAD_ZONAS];
+
+// Mismo orden que los enum de metricas.h
+const DescripcionMetrica descripcionesContadores[CANTIDAD_CONTADORES] = {
+    {"sdi_iteraciones_loop_total", "Vueltas de loop() completadas"},
+    {"sdi_peticiones_http_total", "Peticiones HTTP recibidas en el puerto 80"},
+    {"sdi_difusiones_estado_total", "Difusiones de estado (WebSocket y SSE)"},
+    {"sdi_frames_ws_total", "Frames de estado enviados a clientes WebSocket"},
+    {"sdi_eventos_sse_total", "Eventos enviados a suscriptores SSE"},
+    {"sdi_comandos_ws_total", "Comandos WebSocket aplicados"},
+    {"sdi_comandos_ws_rechazados_total", "Comandos WebSocket rechazados"},
+    {"sdi_ciclos_dns_total", "Ciclos de atención del servidor DNS"},
+    {"sdi_flancos_pir_total", "Flancos de subida detectados en sensores PIR"},
+    {"sdi_apagados_timeout_total", "Zonas apagadas por falta de movimiento"},
+    {"sdi_excesos_etapa_loop_total", "Etapas de loop() que excedieron su presupuesto"},
+    {"sdi_comandos_encolados_total", "Órdenes de zona encoladas por los handlers de red"},
+    {"sdi_comandos_coalescidos_total", "Órdenes de zona reemplazadas por otra posterior antes de aplicarse"},
+    {"sdi_comandos_descartados_total", "Lotes de órdenes rechazados con la cola llena"},
+    {"sdi_apagados_en_falso_total", "Apagados por timeout seguidos de actividad en la zona"},
+};
+
+const DescripcionMetrica descripcionesMedidores[CANTIDAD_MEDIDORES] = {
+    {"sdi_clientes_ws", "Clientes WebSocket conectados"},
+    {"sdi_suscriptores_sse", "Suscriptores SSE conectados"},
+    {"sdi_cola_comandos", "Órdenes de zona en la cola esperando al loop"},
+    {"sdi_cola_comandos_maxima", "Mayor profundidad de la cola de comandos desde el arranque"},
+};
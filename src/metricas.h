@@ -0,0 +1,69 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+
+// Registro de métricas en memoria estática: contadores y medidores atómicos
+// que cualquier módulo puede actualizar sin reservar heap ni tomar locks.
+// GET /metrics los expone en formato de texto de Prometheus.
+
+enum Contador : uint8_t
+{
+    CONTADOR_ITERACIONES_LOOP,
+    CONTADOR_PETICIONES_HTTP,
+    CONTADOR_DIFUSIONES_ESTADO,
+    CONTADOR_FRAMES_WS,
+    CONTADOR_EVENTOS_SSE,
+    CONTADOR_COMANDOS_WS,
+    CONTADOR_COMANDOS_WS_RECHAZADOS,
+    CONTADOR_CICLOS_DNS,
+    CONTADOR_FLANCOS_PIR,
+    CONTADOR_APAGADOS_TIMEOUT,
+    CONTADOR_EXCESOS_LOOP,
+    CONTADOR_COMANDOS_ENCOLADOS,
+    CONTADOR_COMANDOS_COALESCIDOS,
+    CONTADOR_COMANDOS_DESCARTADOS,
+    CONTADOR_APAGADOS_EN_FALSO,
+    CANTIDAD_CONTADORES
+};
+
+enum Medidor : uint8_t
+{
+    MEDIDOR_CLIENTES_WS,
+    MEDIDOR_SUSCRIPTORES_SSE,
+    MEDIDOR_COLA_COMANDOS,
+    MEDIDOR_COLA_COMANDOS_MAXIMA,
+    CANTIDAD_MEDIDORES
+};
+
+struct DescripcionMetrica
+{
+    const char *nombre;
+    const char *ayuda;
+};
+
+extern std::atomic<uint32_t> contadores[CANTIDAD_CONTADORES];
+extern std::atomic<int32_t> medidores[CANTIDAD_MEDIDORES];
+extern std::atomic<uint32_t> conmutacionesRelay[CANTIDAD_ZONAS];
+extern const DescripcionMetrica descripcionesContadores[CANTIDAD_CONTADORES];
+extern const DescripcionMetrica descripcionesMedidores[CANTIDAD_MEDIDORES];
+
+inline void incrementarContador(Contador contador)
+{
+    contadores[contador].fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void sumarContador(Contador contador, uint32_t cantidad)
+{
+    contadores[contador].fetch_add(cantidad, std::memory_order_relaxed);
+}
+
+inline void ajustarMedidor(Medidor medidor, int32_t delta)
+{
+    medidores[medidor].fetch_add(delta, std::memory_order_relaxed);
+}
+
+inline void fijarMedidor(Medidor medidor, int32_t valor)
+{
+    medidores[medidor].store(valor, std::memory_order_relaxed);
+}
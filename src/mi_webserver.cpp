@@ -2,6 +2,9 @@
 #include "config.h"
 #include "zones.h"
 #include "time_utils.h"
+#include "configuracion.h"
+#include "trazas.h"
+#include "comandos.h"
 #include <WebServer.h>
 #include <ArduinoJson.h>
 #include <WiFi.h>
@@ -65,6 +68,8 @@ void manejarPaginaPrincipal()
     servidor.sendContent_P(PSTR(".slider:before{position:absolute;content:\"\";height:26px;width:26px;left:4px;bottom:4px;background-color:white;transition:.4s;border-radius:50%;}"));
     servidor.sendContent_P(PSTR("input:checked+.slider{background-color:var(--success);}input:checked+.slider:before{transform:translateX(26px);}"));
     servidor.sendContent_P(PSTR(".countdown-display{font-size:0.8rem;color:var(--warning);margin-top:5px;font-weight:600;}"));
+    servidor.sendContent_P(PSTR(".timeout-display{font-size:0.75rem;opacity:0.7;margin-top:3px;}"));
+    servidor.sendContent_P(PSTR(".actividad{font-size:0.9rem;letter-spacing:1px;color:var(--primary);margin-top:5px;}"));
     servidor.sendContent_P(PSTR("</style></head>"));
 
     // Fragmento 2: Body y contenido principal
@@ -77,32 +82,44 @@ void manejarPaginaPrincipal()
     servidor.sendContent_P(PSTR("<span id=\"connection-status\">Desconectado</span></div></div>"));
     servidor.sendContent_P(PSTR("<div class=\"mode-banner mode-horario\" id=\"mode-banner\">🕐 HORARIO LABORAL ACTIVO</div>"));
 
-    // Fragmento 3: Zonas
+    // Fragmento 3: Zonas, una tarjeta por zona armada en la pila
     servidor.sendContent_P(PSTR("<div class=\"grid-2\">"));
-    servidor.sendContent_P(PSTR("<div class=\"zone-card\" id=\"zone-1-card\">"));
-    servidor.sendContent_P(PSTR("<div class=\"zone-title\">Zona 1</div>"));
-    servidor.sendContent_P(PSTR("<div class=\"zone-status\" id=\"zone-1-status\">APAGADO</div>"));
-    servidor.sendContent_P(PSTR("<div><span class=\"sensor-indicator\" id=\"zone-1-sensor\"></span> Sensor de movimiento</div>"));
-    servidor.sendContent_P(PSTR("<div class=\"actions\"><label class=\"switch\">"));
-    servidor.sendContent_P(PSTR("<input type=\"checkbox\" id=\"zone-1-switch\" onchange=\"toggleZone(0,this.checked)\">"));
-    servidor.sendContent_P(PSTR("<span class=\"slider\"></span></label>"));
-    servidor.sendContent_P(PSTR("<div class=\"countdown-display\" id=\"zone-1-countdown\" style=\"display:none;\"></div></div></div>"));
-
-    servidor.sendContent_P(PSTR("<div class=\"zone-card\" id=\"zone-2-card\">"));
-    servidor.sendContent_P(PSTR("<div class=\"zone-title\">Zona 2</div>"));
-    servidor.sendContent_P(PSTR("<div class=\"zone-status\" id=\"zone-2-status\">APAGADO</div>"));
-    servidor.sendContent_P(PSTR("<div><span class=\"sensor-indicator\" id=\"zone-2-sensor\"></span> Sensor de movimiento</div>"));
-    servidor.sendContent_P(PSTR("<div class=\"actions\"><label class=\"switch\">"));
-    servidor.sendContent_P(PSTR("<input type=\"checkbox\" id=\"zone-2-switch\" onchange=\"toggleZone(1,this.checked)\">"));
-    servidor.sendContent_P(PSTR("<span class=\"slider\"></span></label>"));
-    servidor.sendContent_P(PSTR("<div class=\"countdown-display\" id=\"zone-2-countdown\" style=\"display:none;\"></div></div></div></div></div>"));
+    char fragmento[320];
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        int numero = i + 1;
+        int largo = snprintf(fragmento, sizeof(fragmento),
+                             "<div class=\"zone-card\" id=\"zone-%d-card\"><div class=\"zone-title\">Zona %d</div>"
+                             "<div class=\"zone-status\" id=\"zone-%d-status\">APAGADO</div>"
+                             "<div><span class=\"sensor-indicator\" id=\"zone-%d-sensor\"></span> Sensor de movimiento</div>",
+                             numero, numero, numero, numero);
+        servidor.sendContent(fragmento, largo);
+        largo = snprintf(fragmento, sizeof(fragmento),
+                         "<div class=\"actions\"><label class=\"switch\">"
+                         "<input type=\"checkbox\" id=\"zone-%d-switch\" onchange=\"toggleZone(%d,this.checked)\">"
+                         "<span class=\"slider\"></span></label>",
+                         numero, i);
+        servidor.sendContent(fragmento, largo);
+        largo = snprintf(fragmento, sizeof(fragmento),
+                         "<div class=\"countdown-display\" id=\"zone-%d-countdown\" style=\"display:none;\"></div>"
+                         "<div class=\"timeout-display\" id=\"zone-%d-timeout\"></div>"
+                         "<div class=\"actividad\" id=\"zone-%d-actividad\" title=\"Movimientos por hora, día actual\"></div></div></div>",
+                         numero, numero, numero);
+        servidor.sendContent(fragmento, largo);
+    }
+    servidor.sendContent_P(PSTR("</div></div>"));
 
     // Fragmento 4: Estado de sensores
     servidor.sendContent_P(PSTR("<div class=\"card\"><div class=\"card-header\">"));
     servidor.sendContent_P(PSTR("<div class=\"card-title\">Estado de Sensores de Movimiento</div></div>"));
     servidor.sendContent_P(PSTR("<div style=\"padding:10px;\">"));
-    servidor.sendContent_P(PSTR("<p id=\"movimiento-zona-1\" style=\"margin:8px 0;padding:8px;border-radius:5px;background-color:#f8f9fa;\">Zona 1: Sin movimiento</p>"));
-    servidor.sendContent_P(PSTR("<p id=\"movimiento-zona-2\" style=\"margin:8px 0;padding:8px;border-radius:5px;background-color:#f8f9fa;\">Zona 2: Sin movimiento</p>"));
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        int largo = snprintf(fragmento, sizeof(fragmento),
+                             "<p id=\"movimiento-zona-%d\" style=\"margin:8px 0;padding:8px;border-radius:5px;background-color:#f8f9fa;\">Zona %d: Sin movimiento</p>",
+                             i + 1, i + 1);
+        servidor.sendContent(fragmento, largo);
+    }
     servidor.sendContent_P(PSTR("</div></div>"));
 
     // Fragmento 5: Configuración con valores dinámicos
@@ -110,16 +127,22 @@ void manejarPaginaPrincipal()
     servidor.sendContent_P(PSTR("<div class=\"card-title\">Configuración</div></div>"));
     servidor.sendContent_P(PSTR("<form action=\"/update\" method=\"post\"><div class=\"form-row\">"));
     servidor.sendContent_P(PSTR("<div class=\"form-group\"><label>Horario 1:</label>"));
+    char cadenaHora[6];
+    const Horario *horarios = configuracionActual().horarios;
     servidor.sendContent_P(PSTR("<input type=\"time\" name=\"inicio0\" value=\""));
-    servidor.sendContent(horariosLaborales[0][0]);
+    formatearHora(horarios[0].inicio, cadenaHora);
+    servidor.sendContent(cadenaHora, 5);
     servidor.sendContent_P(PSTR("\"><input type=\"time\" name=\"fin0\" value=\""));
-    servidor.sendContent(horariosLaborales[0][1]);
+    formatearHora(horarios[0].fin, cadenaHora);
+    servidor.sendContent(cadenaHora, 5);
     servidor.sendContent_P(PSTR("\" style=\"margin-top:5px;\"></div>"));
     servidor.sendContent_P(PSTR("<div class=\"form-group\"><label>Horario 2:</label>"));
     servidor.sendContent_P(PSTR("<input type=\"time\" name=\"inicio1\" value=\""));
-    servidor.sendContent(horariosLaborales[1][0]);
+    formatearHora(horarios[1].inicio, cadenaHora);
+    servidor.sendContent(cadenaHora, 5);
     servidor.sendContent_P(PSTR("\"><input type=\"time\" name=\"fin1\" value=\""));
-    servidor.sendContent(horariosLaborales[1][1]);
+    formatearHora(horarios[1].fin, cadenaHora);
+    servidor.sendContent(cadenaHora, 5);
     servidor.sendContent_P(PSTR("\" style=\"margin-top:5px;\"></div></div>"));
     servidor.sendContent_P(PSTR("<button type=\"submit\" class=\"btn btn-primary\" style=\"width:100%;margin-top:10px;\">Actualizar Horarios</button></form>"));
     servidor.sendContent_P(PSTR("<form action=\"/settime\" method=\"post\" style=\"margin-top:15px;\">"));
@@ -142,16 +165,36 @@ void enviarJavaScript()
     servidor.sendContent_P(PSTR("const connectionDot=document.getElementById('connection-dot');"));
     servidor.sendContent_P(PSTR("const connectionStatus=document.getElementById('connection-status');"));
     servidor.sendContent_P(PSTR("let socket;const host=window.location.hostname;"));
+    servidor.sendContent_P(PSTR("let siguienteId=1;const comandosPendientes={};let socketAbierto=false;"));
     servidor.sendContent_P(PSTR("function initWebSocket(){"));
     servidor.sendContent_P(PSTR("socket=new WebSocket(`ws://${host}:81/`);"));
     servidor.sendContent_P(PSTR("socket.addEventListener('open',()=>{"));
     servidor.sendContent_P(PSTR("connectionDot.classList.remove('disconnected');"));
     servidor.sendContent_P(PSTR("connectionDot.classList.add('connected');"));
-    servidor.sendContent_P(PSTR("connectionStatus.textContent='Conectado';syncTimeAutomatically(true);});"));
+    servidor.sendContent_P(PSTR("socketAbierto=true;connectionStatus.textContent='Conectado';syncTimeAutomatically(true);});"));
 
     servidor.sendContent_P(PSTR("socket.addEventListener('message',(event)=>{"));
     servidor.sendContent_P(PSTR("const data=JSON.parse(event.data);"));
-    servidor.sendContent_P(PSTR("console.log('WebSocket recibido:',data);")); // Debug
+    servidor.sendContent_P(PSTR("if(data.ack!==undefined){atenderAck(data);return;}"));
+    servidor.sendContent_P(PSTR("actualizarPanel(data);});"));
+
+    // Si el puerto 81 nunca respondió (proxy o firewall), usar Server-Sent Events en el puerto 82
+    servidor.sendContent_P(PSTR("socket.addEventListener('close',()=>{"));
+    servidor.sendContent_P(PSTR("connectionDot.classList.remove('connected');connectionDot.classList.add('disconnected');"));
+    servidor.sendContent_P(PSTR("if(!socketAbierto){iniciarEventos();return;}"));
+    servidor.sendContent_P(PSTR("connectionStatus.textContent='Desconectado, reconectando...';setTimeout(initWebSocket,3000);});"));
+    servidor.sendContent_P(PSTR("socket.addEventListener('error',()=>socket.close());}"));
+
+    servidor.sendContent_P(PSTR("function iniciarEventos(){"));
+    servidor.sendContent_P(PSTR("const eventos=new EventSource(`http://${host}:82/events`);"));
+    servidor.sendContent_P(PSTR("eventos.onopen=()=>{connectionDot.classList.remove('disconnected');connectionDot.classList.add('connected');"));
+    servidor.sendContent_P(PSTR("connectionStatus.textContent='Conectado (eventos)';syncTimeAutomatically(true);};"));
+    servidor.sendContent_P(PSTR("eventos.onmessage=(event)=>actualizarPanel(JSON.parse(event.data));"));
+    servidor.sendContent_P(PSTR("eventos.onerror=()=>{connectionDot.classList.remove('connected');connectionDot.classList.add('disconnected');"));
+    servidor.sendContent_P(PSTR("connectionStatus.textContent='Desconectado, reconectando...';};}"));
+
+    servidor.sendContent_P(PSTR("function actualizarPanel(data){"));
+    servidor.sendContent_P(PSTR("console.log('Estado recibido:',data);")); // Debug
     servidor.sendContent_P(PSTR("document.getElementById('real-time-clock').textContent="));
     servidor.sendContent_P(PSTR("`${String(data.hora).padStart(2,'0')}:${String(data.minuto).padStart(2,'0')}:${String(data.segundo).padStart(2,'0')}`;"));
     servidor.sendContent_P(PSTR("document.getElementById('mode-indicator').textContent=`Modo: ${data.modo}`;"));
@@ -183,6 +226,11 @@ void enviarJavaScript()
     servidor.sendContent_P(PSTR("const seconds=zona.countdown%60;"));
     servidor.sendContent_P(PSTR("countdownElement.textContent=`Apagado en: ${minutes}:${String(seconds).padStart(2,'0')}`;"));
     servidor.sendContent_P(PSTR("}else{document.getElementById(`zone-${idx}-countdown`).style.display='none';}"));
+    servidor.sendContent_P(PSTR("if(zona.timeoutS){document.getElementById(`zone-${idx}-timeout`).textContent="));
+    servidor.sendContent_P(PSTR("`Timeout ${Math.floor(zona.timeoutS/60)}:${String(zona.timeoutS%60).padStart(2,'0')} (${zona.adaptativo?'aprendido':'fijo'})`;}"));
+
+    // La actividad solo llega en la primera difusión de cada hora
+    servidor.sendContent_P(PSTR("if(zona.actividad){dibujarActividad(idx,zona.actividad);}"));
 
     servidor.sendContent_P(PSTR("const tiempoSinMovimiento=zona.movimiento;"));
     servidor.sendContent_P(PSTR("const sensorActivo=tiempoSinMovimiento<10;"));
@@ -205,20 +253,51 @@ void enviarJavaScript()
     servidor.sendContent_P(PSTR("if(tiempoSinMovimiento<10){movimientoElement.style.color='#dc3545';movimientoElement.style.fontWeight='bold';}"));
     servidor.sendContent_P(PSTR("else if(tiempoSinMovimiento<30){movimientoElement.style.color='#f8961e';movimientoElement.style.fontWeight='600';}"));
     servidor.sendContent_P(PSTR("else{movimientoElement.style.color='#28a745';movimientoElement.style.fontWeight='normal';}}"));
-    servidor.sendContent_P(PSTR("});});"));
-
-    servidor.sendContent_P(PSTR("socket.addEventListener('close',()=>{"));
-    servidor.sendContent_P(PSTR("connectionDot.classList.remove('connected');connectionDot.classList.add('disconnected');"));
-    servidor.sendContent_P(PSTR("connectionStatus.textContent='Desconectado, reconectando...';setTimeout(initWebSocket,3000);});"));
-    servidor.sendContent_P(PSTR("socket.addEventListener('error',()=>socket.close());}"));
+    servidor.sendContent_P(PSTR("});}"));
 
     servidor.sendContent_P(PSTR("document.addEventListener('DOMContentLoaded',()=>{"));
     servidor.sendContent_P(PSTR("const now=new Date();"));
     servidor.sendContent_P(PSTR("document.getElementById('manual-time').value="));
     servidor.sendContent_P(PSTR("`${String(now.getHours()).padStart(2,'0')}:${String(now.getMinutes()).padStart(2,'0')}`;"));
-    servidor.sendContent_P(PSTR("initWebSocket();});"));
+    servidor.sendContent_P(PSTR("initWebSocket();cargarActividad();cargarTrazas();setInterval(cargarTrazas,10000);});"));
+
+    // Comandos por el WebSocket abierto; si no está disponible se usa el endpoint HTTP
+    servidor.sendContent_P(PSTR("function enviarComando(comando){"));
+    servidor.sendContent_P(PSTR("if(!socket||socket.readyState!==WebSocket.OPEN){return false;}"));
+    servidor.sendContent_P(PSTR("comando.id=siguienteId++;comandosPendientes[comando.id]=performance.now();"));
+    servidor.sendContent_P(PSTR("socket.send(JSON.stringify(comando));return true;}"));
+    servidor.sendContent_P(PSTR("function atenderAck(ack){"));
+    servidor.sendContent_P(PSTR("const inicio=comandosPendientes[ack.ack];delete comandosPendientes[ack.ack];"));
+    servidor.sendContent_P(PSTR("if(!ack.ok){console.error('Comando rechazado:',ack.error);return;}"));
+    servidor.sendContent_P(PSTR("if(inicio!==undefined){const rtt=(performance.now()-inicio).toFixed(1);"));
+    servidor.sendContent_P(PSTR("console.log(`Comando ${ack.ack} aplicado en los relays en ${rtt} ms`);"));
+    servidor.sendContent_P(PSTR("document.getElementById('trazas-rtt').textContent=`Último comando: ${rtt} ms ida y vuelta (traza #${ack.traza})`;}"));
+    servidor.sendContent_P(PSTR("setTimeout(cargarTrazas,600);}"));
+
+    // Tarjeta de latencia: percentil 50/95 aproximado desde los histogramas y las últimas trazas
+    servidor.sendContent_P(PSTR("function percentilTrazas(h,limites,p){"));
+    servidor.sendContent_P(PSTR("if(!h.cantidad){return '-';}let acumulado=0;"));
+    servidor.sendContent_P(PSTR("for(let i=0;i<h.cubetas.length;i++){acumulado+=h.cubetas[i];"));
+    servidor.sendContent_P(PSTR("if(acumulado>=h.cantidad*p){return i<limites.length?`≤${(limites[i]/1000).toFixed(1)} ms`:'>2 s';}}return '-';}"));
+    servidor.sendContent_P(PSTR("function formatearUs(us){return us<0?'…':`${(us/1000).toFixed(2)} ms`;}"));
+    // Sparkline de movimientos por hora con caracteres de bloque
+    servidor.sendContent_P(PSTR("function dibujarActividad(idx,actividad){if(!actividad.length){return;}const maximo=Math.max(1,...actividad);"));
+    servidor.sendContent_P(PSTR("document.getElementById(`zone-${idx}-actividad`).textContent="));
+    servidor.sendContent_P(PSTR("actividad.map(v=>v?'▁▂▃▄▅▆▇█'[Math.min(7,Math.floor(v*8/(maximo+1)))]:'·').join('');}"));
+    servidor.sendContent_P(PSTR("function cargarActividad(){fetch('/api/stats').then(r=>r.json()).then(s=>{const inicio=Math.floor(s.cubetaActual/24)*24;"));
+    servidor.sendContent_P(PSTR("s.zonas.forEach((zona,index)=>dibujarActividad(index+1,zona.movimientos.slice(inicio,inicio+24)));"));
+    servidor.sendContent_P(PSTR("}).catch(err=>{console.error('Error cargando actividad:',err);});}"));
+
+    servidor.sendContent_P(PSTR("function cargarTrazas(){fetch('/api/trazas').then(r=>r.json()).then(t=>{"));
+    servidor.sendContent_P(PSTR("const h=t.histogramas;"));
+    servidor.sendContent_P(PSTR("document.getElementById('trazas-resumen').textContent="));
+    servidor.sendContent_P(PSTR("`Aplicar p50 ${percentilTrazas(h.aplicar,t.limites,0.5)} · Total p50 ${percentilTrazas(h.total,t.limites,0.5)}, p95 ${percentilTrazas(h.total,t.limites,0.95)} (${h.total.cantidad} comandos)`;"));
+    servidor.sendContent_P(PSTR("document.getElementById('trazas-lista').innerHTML=t.recientes.slice(0,6).map(r=>"));
+    servidor.sendContent_P(PSTR("`<li>#${r[0]} ${r[1]}${r[2]>=0?' zona '+(r[2]+1):''}: aplicar ${formatearUs(r[3])}, publicar ${formatearUs(r[4])}</li>`).join('');"));
+    servidor.sendContent_P(PSTR("}).catch(err=>{console.error('Error cargando trazas:',err);});}"));
 
     servidor.sendContent_P(PSTR("function toggleZone(zona,estado){"));
+    servidor.sendContent_P(PSTR("if(enviarComando({cmd:'toggle',zona:zona,on:!!estado})){return;}"));
     servidor.sendContent_P(PSTR("const url=estado?`/on?zona=${zona}`:`/off?zona=${zona}`;"));
     servidor.sendContent_P(PSTR("fetch(url).then(response=>{if(!response.ok){console.error('Error al cambiar estado de zona');}})"));
     servidor.sendContent_P(PSTR(".catch(err=>{console.error('Error:',err);});}"));
@@ -232,10 +311,17 @@ void enviarJavaScript()
     servidor.sendContent_P(PSTR("const timeString=`${String(now.getHours()).padStart(2,'0')}:${String(now.getMinutes()).padStart(2,'0')}`;"));
     servidor.sendContent_P(PSTR("const syncType=isAutomatic?'automática':'manual';"));
     servidor.sendContent_P(PSTR("fetch('/settime',{method:'POST',headers:{'Content-Type':'application/x-www-form-urlencoded'},"));
-    servidor.sendContent_P(PSTR("body:`time=${timeString}&auto=${isAutomatic?1:0}`}).then(()=>{"));
+    servidor.sendContent_P(PSTR("body:`time=${timeString}&dia=${(now.getDay()+6)%7}&epoch=${now.getTime()-now.getTimezoneOffset()*60000}&auto=${isAutomatic?1:0}`}).then(()=>{"));
     servidor.sendContent_P(PSTR("console.log(`Hora sincronizada ${syncType}mente:`,timeString);})"));
     servidor.sendContent_P(PSTR(".catch(err=>{console.error('Error sincronizando hora:',err);});}"));
     servidor.sendContent_P(PSTR("</script>"));
+
+    servidor.sendContent_P(PSTR("<div class=\"card\" style=\"margin-top:15px;\">"));
+    servidor.sendContent_P(PSTR("<div class=\"card-header\"><h3 class=\"card-title\">⏱️ Latencia de comandos</h3></div>"));
+    servidor.sendContent_P(PSTR("<div style=\"font-size:0.85rem;line-height:1.4;\">"));
+    servidor.sendContent_P(PSTR("<p id=\"trazas-resumen\">Sin comandos registrados</p>"));
+    servidor.sendContent_P(PSTR("<p id=\"trazas-rtt\" style=\"color:#6c757d;\"></p>"));
+    servidor.sendContent_P(PSTR("<ul id=\"trazas-lista\" style=\"margin-left:20px;\"></ul></div></div>"));
     
     // Footer con información de dominios disponibles
     servidor.sendContent_P(PSTR("<div class=\"card\" style=\"margin-top:15px;background:linear-gradient(135deg,#f8f9fa,#e9ecef);border:2px solid #dee2e6;\">"));
@@ -270,32 +356,17 @@ void manejarControlManual()
     if (servidor.hasArg("zona"))
     {
         int indiceZona = servidor.arg("zona").toInt();
-        if (indiceZona >= 0 && indiceZona < 2)
+        bool encender = (servidor.uri() == "/on");
+        CambioZona cambio = {indiceZona, encender};
+        uint32_t idTraza = iniciarTraza(ORIGEN_HTTP, indiceZona);
+        bool encolado = encolarCambiosZonas(&cambio, 1, idTraza);
+        terminarRecepcionTraza();
+        if (!encolado && indiceZona >= 0 && indiceZona < CANTIDAD_ZONAS)
         {
-            bool encender = (servidor.uri() == "/on");
-
-            if (encender)
-            {
-                configurarEstadoZona(indiceZona, true);
-
-                // Establecer tiempo de movimiento para mantener la luz
-                zonas[indiceZona].ultimoMovimiento = millis();
-
-                if (!estaEnHorarioLaboral)
-                {
-                    Serial.printf("Zona %d encendida manualmente (fuera de horario)\n", indiceZona + 1);
-                }
-                else
-                {
-                    Serial.printf("Zona %d encendida manualmente (horario laboral)\n", indiceZona + 1);
-                }
-            }
-            else
-            {
-                configurarEstadoZona(indiceZona, false);
-                Serial.printf("Zona %d apagada manualmente\n", indiceZona + 1);
-            }
+            servidor.send(503, "text/plain", "Cola de comandos llena");
+            return;
         }
+        servidor.sendHeader("X-Traza", String(idTraza));
     }
     servidor.sendHeader("Location", "/");
     servidor.send(303);
@@ -306,14 +377,18 @@ void manejarActualizacionHorarios()
 
     for (int i = 0; i < cantidadHorarios; i++)
     {
-        String claveInicio = "inicio" + String(i);
-        String claveFin = "fin" + String(i);
-        if (servidor.hasArg(claveInicio) && servidor.hasArg(claveFin))
+        char claveInicio[12];
+        char claveFin[12];
+        snprintf(claveInicio, sizeof(claveInicio), "inicio%d", i);
+        snprintf(claveFin, sizeof(claveFin), "fin%d", i);
+
+        // Validación y conversión a minutos en el borde de la API
+        uint16_t inicio, fin;
+        if (servidor.hasArg(claveInicio) && servidor.hasArg(claveFin) &&
+            parsearHora(servidor.arg(claveInicio).c_str(), inicio) &&
+            parsearHora(servidor.arg(claveFin).c_str(), fin))
         {
-            horariosLaborales[i][0] = servidor.arg(claveInicio);
-            horariosLaborales[i][1] = servidor.arg(claveFin);
-            Serial.printf("Horario actualizado: %s - %s\n",
-                          horariosLaborales[i][0].c_str(), horariosLaborales[i][1].c_str());
+            establecerHorario(i, inicio, fin);
         }
     }
     servidor.sendHeader("Location", "/");
@@ -322,10 +397,28 @@ void manejarActualizacionHorarios()
 
 void manejarConfiguracionHora()
 {
-    if (servidor.hasArg("time"))
+    bool esAutomatico = servidor.hasArg("auto") && servidor.arg("auto") == "1";
+
+    // Hora local del navegador en milisegundos desde 1970: referencia precisa,
+    // también sirve para medir la deriva del reloj entre sincronizaciones
+    if (servidor.hasArg("epoch"))
+    {
+        uint64_t milisegundos = strtoull(servidor.arg("epoch").c_str(), nullptr, 10);
+        if (esAutomatico && segundosDesdeSincronizacionPrecisa() < INTERVALO_MINIMO_DERIVA_S)
+        {
+            Serial.println("Sincronización automática reciente, omitiendo...");
+        }
+        else if (milisegundos > 0)
+        {
+            sincronizarRelojPreciso(milisegundos * 1000ULL);
+            sincronizacionAutomaticaHora = sincronizacionAutomaticaHora || esAutomatico;
+            Serial.printf("Hora sincronizada con el navegador (%s): %02d:%02d:%02d\n",
+                          esAutomatico ? "automática" : "manual", horaActual(), minutoActual(), segundoActual());
+        }
+    }
+    else if (servidor.hasArg("time"))
     {
         String cadenaHora = servidor.arg("time");
-        bool esAutomatico = servidor.hasArg("auto") && servidor.arg("auto") == "1";
 
         int hora, minuto;
         if (sscanf(cadenaHora.c_str(), "%d:%d", &hora, &minuto) == 2)
@@ -335,12 +428,11 @@ void manejarConfiguracionHora()
                 Serial.println("Sincronización automática ya realizada, omitiendo...");
                 return;
             }
-            horaActual = hora;
-            minutoActual = minuto;
-            segundoActual = 0;
-            referenciaDelTiempo = millis();
-
-            if (esAutomatico)
+            if (!establecerHoraActual(hora, minuto))
+            {
+                Serial.printf("Hora inválida ignorada: %s\n", cadenaHora.c_str());
+            }
+            else if (esAutomatico)
             {
                 sincronizacionAutomaticaHora = true;
                 Serial.printf("Hora sincronizada automáticamente: %02d:%02d\n", hora, minuto);
@@ -349,6 +441,11 @@ void manejarConfiguracionHora()
             {
                 Serial.printf("Hora actualizada manualmente: %02d:%02d\n", hora, minuto);
             }
+            // Día de la semana opcional (0 = lunes) para las estadísticas por hora de la semana
+            if (servidor.hasArg("dia"))
+            {
+                establecerDiaSemana(servidor.arg("dia").toInt());
+            }
         }
     }
     servidor.sendHeader("Location", "/");
@@ -0,0 +1,225 @@
+#include "persistencia.h"
+#include "config.h"
+#ifdef ARDUINO
+#include <Preferences.h>
+#endif
+
+struct EntradaPersistente
+{
+    const char *nombre;
+    void *datos;
+    size_t tamano;
+    uint32_t hashGuardado;   // Hash de lo que hay en flash; evita reescribir valores iguales
+    bool guardada;
+    bool modificada;
+};
+
+static EntradaPersistente entradas[CANTIDAD_CLAVES_PERSISTENTES];
+static EstadisticasPersistencia estadisticas;
+static bool hayModificaciones = false;
+static unsigned long primeraModificacion = 0;
+static unsigned long ultimaModificacion = 0;
+
+// FNV-1a de 32 bits: suficiente para detectar cambios, no es un control de integridad
+static uint32_t calcularHash(const void *datos, size_t tamano)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(datos);
+    uint32_t hash = 2166136261UL;
+    for (size_t i = 0; i < tamano; i++)
+    {
+        hash = (hash ^ bytes[i]) * 16777619UL;
+    }
+    return hash;
+}
+
+#ifdef ARDUINO
+static Preferences preferencias;
+
+void iniciarPersistencia()
+{
+    preferencias.begin("config", false);
+}
+
+static bool leerBloque(const char *nombre, void *datos, size_t tamano)
+{
+    return preferencias.getBytesLength(nombre) == tamano && preferencias.getBytes(nombre, datos, tamano) == tamano;
+}
+
+static bool escribirBloque(const char *nombre, const void *datos, size_t tamano)
+{
+    return preferencias.putBytes(nombre, datos, tamano) == tamano;
+}
+#else
+// Compilación de host: un almacén en RAM con el mismo comportamiento que NVS
+static const size_t TAMANO_MAXIMO_BLOQUE_HOST = 1024;
+static uint8_t almacenHost[CANTIDAD_CLAVES_PERSISTENTES][TAMANO_MAXIMO_BLOQUE_HOST];
+static size_t tamanosHost[CANTIDAD_CLAVES_PERSISTENTES];
+
+static int indiceHost(const char *nombre)
+{
+    for (int i = 0; i < CANTIDAD_CLAVES_PERSISTENTES; i++)
+    {
+        if (entradas[i].nombre && strcmp(entradas[i].nombre, nombre) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void iniciarPersistencia()
+{
+}
+
+static bool leerBloque(const char *nombre, void *datos, size_t tamano)
+{
+    int indice = indiceHost(nombre);
+    if (indice < 0 || tamanosHost[indice] != tamano)
+    {
+        return false;
+    }
+    memcpy(datos, almacenHost[indice], tamano);
+    return true;
+}
+
+static bool escribirBloque(const char *nombre, const void *datos, size_t tamano)
+{
+    int indice = indiceHost(nombre);
+    if (indice < 0 || tamano > TAMANO_MAXIMO_BLOQUE_HOST)
+    {
+        return false;
+    }
+    memcpy(almacenHost[indice], datos, tamano);
+    tamanosHost[indice] = tamano;
+    return true;
+}
+#endif
+
+bool restaurarClave(ClavePersistente clave, const char *nombre, void *datos, size_t tamano)
+{
+    EntradaPersistente &entrada = entradas[clave];
+    entrada.nombre = nombre;
+    entrada.datos = datos;
+    entrada.tamano = tamano;
+    entrada.modificada = false;
+    entrada.guardada = leerBloque(nombre, datos, tamano);
+    entrada.hashGuardado = entrada.guardada ? calcularHash(datos, tamano) : 0;
+    return entrada.guardada;
+}
+
+bool leerClaveAnterior(const char *nombre, void *datos, size_t tamano)
+{
+    return leerBloque(nombre, datos, tamano);
+}
+
+void marcarClaveModificada(ClavePersistente clave)
+{
+    unsigned long ahora = millis();
+    if (!hayModificaciones)
+    {
+        hayModificaciones = true;
+        primeraModificacion = ahora;
+    }
+    entradas[clave].modificada = true;
+    ultimaModificacion = ahora;
+}
+
+// Volcado en curso: las claves se escriben de a una desde siguienteClave
+static bool volcadoEnCurso = false;
+static int siguienteClave = 0;
+
+static void empezarVolcado()
+{
+    hayModificaciones = false;
+    volcadoEnCurso = true;
+    siguienteClave = 0;
+}
+
+// Escribe la próxima clave modificada del volcado en curso; las que no
+// cambiaron se descartan sin contar como escritura. Devuelve true si quedan.
+static bool escribirSiguienteClave()
+{
+    while (siguienteClave < CANTIDAD_CLAVES_PERSISTENTES)
+    {
+        EntradaPersistente &entrada = entradas[siguienteClave++];
+        if (!entrada.modificada || entrada.datos == nullptr)
+        {
+            continue;
+        }
+        entrada.modificada = false;
+
+        uint32_t hash = calcularHash(entrada.datos, entrada.tamano);
+        if (entrada.guardada && hash == entrada.hashGuardado)
+        {
+            estadisticas.omitidas++;
+            continue;
+        }
+
+        uint32_t inicio = micros();
+        bool ok = escribirBloque(entrada.nombre, entrada.datos, entrada.tamano);
+        uint32_t duracion = micros() - inicio;
+        estadisticas.ultimaEscrituraUs = duracion;
+        if (duracion > estadisticas.maximaEscrituraUs)
+        {
+            estadisticas.maximaEscrituraUs = duracion;
+        }
+        if (!ok)
+        {
+            // Sigue pendiente: el próximo volcado vuelve a intentarla
+            Serial.printf("❌ No se pudo guardar '%s' en NVS\n", entrada.nombre);
+            estadisticas.fallidas++;
+            marcarClaveModificada((ClavePersistente)(siguienteClave - 1));
+        }
+        else
+        {
+            entrada.guardada = true;
+            entrada.hashGuardado = hash;
+            estadisticas.escrituras++;
+        }
+        break;
+    }
+
+    for (int i = siguienteClave; i < CANTIDAD_CLAVES_PERSISTENTES; i++)
+    {
+        if (entradas[i].modificada && entradas[i].datos != nullptr)
+        {
+            return true;
+        }
+    }
+    volcadoEnCurso = false;
+    return false;
+}
+
+void forzarEscrituraPersistencia()
+{
+    empezarVolcado();
+    while (escribirSiguienteClave())
+    {
+    }
+}
+
+// Llamado desde loop(): empieza un volcado tras un período sin cambios o, si
+// los cambios no paran, al cumplirse la espera máxima desde el primero
+bool atenderPersistencia()
+{
+    if (!volcadoEnCurso)
+    {
+        if (!hayModificaciones)
+        {
+            return false;
+        }
+        unsigned long ahora = millis();
+        if (ahora - ultimaModificacion < ESPERA_SILENCIO_PERSISTENCIA_MS &&
+            ahora - primeraModificacion < ESPERA_MAXIMA_PERSISTENCIA_MS)
+        {
+            return false;
+        }
+        empezarVolcado();
+    }
+    return escribirSiguienteClave();
+}
+
+const EstadisticasPersistencia &estadisticasPersistencia()
+{
+    return estadisticas;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <Arduino.h>
+
+// Caché de escritura diferida sobre NVS: cada módulo registra el bloque de RAM
+// que quiere conservar y avisa con marcarClaveModificada() cuando cambia, lo
+// que solo levanta una bandera. atenderPersistencia() (desde loop) agrupa las
+// ráfagas de cambios en una escritura después de ESPERA_SILENCIO_PERSISTENCIA_MS
+// sin cambios y solo escribe las claves cuyo contenido difiere de lo guardado.
+// Escribe una clave por llamada y devuelve true mientras queden, para que el
+// loop pueda atender el control entre dos escrituras de flash.
+
+enum ClavePersistente : uint8_t
+{
+    CLAVE_CALENDARIOS,
+    CLAVE_RELOJ,
+    CLAVE_ZONAS,
+    CLAVE_ENERGIA,
+    CLAVE_POLITICAS,
+    CLAVE_ADAPTACION,
+    CANTIDAD_CLAVES_PERSISTENTES
+};
+
+struct EstadisticasPersistencia
+{
+    uint32_t escrituras;        // Claves escritas en flash desde el arranque
+    uint32_t omitidas;          // Claves marcadas cuyo contenido no había cambiado
+    uint32_t fallidas;          // Escrituras rechazadas por NVS; la clave queda pendiente
+    uint32_t ultimaEscrituraUs;
+    uint32_t maximaEscrituraUs;
+};
+
+void iniciarPersistencia();
+// Registra el bloque y, si hay una copia guardada del mismo tamaño, la carga en él
+bool restaurarClave(ClavePersistente clave, const char *nombre, void *datos, size_t tamano);
+// Lee un bloque de una versión anterior sin registrarlo: la clave sigue
+// apuntando a lo que se pasó a restaurarClave()
+bool leerClaveAnterior(const char *nombre, void *datos, size_t tamano);
+void marcarClaveModificada(ClavePersistente clave);
+bool atenderPersistencia();
+void forzarEscrituraPersistencia();
+const EstadisticasPersistencia &estadisticasPersistencia();
@@ -0,0 +1,155 @@
+#include "planificador.h"
+#ifdef ARDUINO
+#include "vigilancia.h"
+#endif
+
+struct TareaLoop
+{
+    const char *nombre;
+    uint8_t etapa;
+    PrioridadTarea prioridad;
+    PasoTarea paso;
+    ContextoTarea contexto;
+    bool pendiente;     // Cedió en esta vuelta y espera otro paso
+};
+
+static TareaLoop tareas[MAX_TAREAS_LOOP];
+static int cantidadTareas = 0;
+static EstadisticasPlanificador estadisticas;
+static uint32_t ultimaPasadaControl = 0;
+static bool huboPasadaControl = false;
+static unsigned long ultimoDescanso = 0;
+
+bool registrarTareaLoop(const char *nombre, uint8_t etapa, PrioridadTarea prioridad, PasoTarea paso)
+{
+    if (cantidadTareas == MAX_TAREAS_LOOP)
+    {
+        Serial.printf("❌ No hay lugar para la tarea '%s' del loop\n", nombre);
+        return false;
+    }
+    TareaLoop &tarea = tareas[cantidadTareas++];
+    tarea.nombre = nombre;
+    tarea.etapa = etapa;
+    tarea.prioridad = prioridad;
+    tarea.paso = paso;
+    tarea.contexto.punto = 0;
+    tarea.pendiente = false;
+    return true;
+}
+
+static ResultadoTarea ejecutarPaso(TareaLoop &tarea)
+{
+#ifdef ARDUINO
+    entrarEtapaLoop((EtapaLoop)tarea.etapa);
+#endif
+    ResultadoTarea resultado = tarea.paso(tarea.contexto);
+    tarea.pendiente = resultado == TAREA_PENDIENTE;
+    return resultado;
+}
+
+// Un paso de cada tarea de control; una que cedió sigue en la pasada siguiente
+static void pasadaControl()
+{
+    uint32_t ahora = micros();
+    if (huboPasadaControl)
+    {
+        uint32_t separacion = ahora - ultimaPasadaControl;
+        acumularLatencia(estadisticas.latenciaControl, separacion);
+        if (separacion > estadisticas.latenciaControlMaximaUs)
+        {
+            estadisticas.latenciaControlMaximaUs = separacion;
+        }
+    }
+    ultimaPasadaControl = ahora;
+    huboPasadaControl = true;
+    estadisticas.pasadasControl++;
+
+    for (int i = 0; i < cantidadTareas; i++)
+    {
+        if (tareas[i].prioridad == PRIORIDAD_CONTROL)
+        {
+            ejecutarPaso(tareas[i]);
+        }
+    }
+}
+
+static bool controlVencido()
+{
+    return micros() - ultimaPasadaControl >= INTERVALO_CONTROL_US;
+}
+
+bool ejecutarVueltaPlanificador()
+{
+    uint32_t inicio = micros();
+    estadisticas.vueltas++;
+    pasadaControl();
+
+    // Cada tarea de red y de fondo recibe un paso por vuelta (la red primero).
+    // Las que ceden vuelven a correr mientras dure la porción; las que no
+    // llegan se retoman en la vuelta siguiente donde quedaron.
+    bool primeraRonda = true;
+    bool hayPendientes = true;
+    while (hayPendientes)
+    {
+        hayPendientes = false;
+        for (int prioridad = PRIORIDAD_RED; prioridad <= PRIORIDAD_FONDO; prioridad++)
+        {
+            for (int i = 0; i < cantidadTareas; i++)
+            {
+                TareaLoop &tarea = tareas[i];
+                if (tarea.prioridad != prioridad || (!primeraRonda && !tarea.pendiente))
+                {
+                    continue;
+                }
+                if (!primeraRonda && micros() - inicio >= PORCION_VUELTA_US)
+                {
+                    continue;
+                }
+                if (controlVencido())
+                {
+                    pasadaControl();
+                }
+                if (ejecutarPaso(tarea) == TAREA_PENDIENTE)
+                {
+                    hayPendientes = true;
+                }
+            }
+        }
+        primeraRonda = false;
+        if (micros() - inicio >= PORCION_VUELTA_US)
+        {
+            break;
+        }
+    }
+
+    // Una tarea de control que cedió también cuenta como trabajo pendiente
+    for (int i = 0; i < cantidadTareas && !hayPendientes; i++)
+    {
+        hayPendientes = tareas[i].pendiente;
+    }
+#ifdef ARDUINO
+    terminarVueltaLoop();
+#endif
+    if (hayPendientes)
+    {
+        estadisticas.vueltasConPendientes++;
+    }
+    return hayPendientes;
+}
+
+void esperarVueltaPlanificador(bool hayPendientes)
+{
+    unsigned long ahora = millis();
+    if (hayPendientes && ahora - ultimoDescanso < MAXIMO_SIN_DORMIR_MS)
+    {
+        yield();
+        return;
+    }
+    delay(hayPendientes ? 1 : ESPERA_OCIOSA_MS);
+    ultimoDescanso = millis();
+}
+
+const EstadisticasPlanificador &estadisticasPlanificador()
+{
+    return estadisticas;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+#include "trazas.h"
+
+// Planificador cooperativo de las etapas del loop. Cada subsistema es una
+// tarea con prioridad: las de control (reloj, modo, comandos, PIR, apagado)
+// corren al empezar cada vuelta y otra vez entre dos pasos de red o de fondo
+// cada vez que pasó INTERVALO_CONTROL_US, así que una página lenta o una
+// ráfaga de escrituras no retrasa el control más que un paso.
+//
+// Las tareas no tienen pila propia: son funciones que retoman donde cedieron
+// gracias al punto de reanudación de su ContextoTarea (al estilo de los
+// protothreads, porque el núcleo de Arduino no compila corrutinas de C++20).
+// Entre TAREA_INICIO y TAREA_FIN, TAREA_CEDER devuelve el control con trabajo
+// pendiente; las variables locales no sobreviven a la cesión.
+//
+//   static ResultadoTarea tareaPersistencia(ContextoTarea &contexto)
+//   {
+//       TAREA_INICIO(contexto);
+//       while (atenderPersistencia())
+//       {
+//           TAREA_CEDER(contexto);
+//       }
+//       TAREA_FIN(contexto);
+//   }
+
+enum PrioridadTarea : uint8_t
+{
+    PRIORIDAD_CONTROL,
+    PRIORIDAD_RED,
+    PRIORIDAD_FONDO
+};
+
+enum ResultadoTarea : uint8_t
+{
+    TAREA_TERMINADA,    // Nada más que hacer hasta la próxima vuelta
+    TAREA_PENDIENTE     // Cedió a mitad de trabajo: se retoma en cuanto haya tiempo
+};
+
+struct ContextoTarea
+{
+    uint16_t punto;     // 0 = empezar desde el principio
+};
+
+#define TAREA_INICIO(contexto) \
+    switch ((contexto).punto)  \
+    {                          \
+    case 0:
+#define TAREA_CEDER(contexto)             \
+    do                                    \
+    {                                     \
+        (contexto).punto = __LINE__;      \
+        return TAREA_PENDIENTE;           \
+    case __LINE__:;                       \
+    } while (0)
+#define TAREA_FIN(contexto) \
+    }                       \
+    (contexto).punto = 0;   \
+    return TAREA_TERMINADA
+
+typedef ResultadoTarea (*PasoTarea)(ContextoTarea &contexto);
+
+struct EstadisticasPlanificador
+{
+    uint32_t vueltas;
+    uint32_t vueltasConPendientes;      // Terminaron con tareas que cedieron y esperan turno
+    uint32_t pasadasControl;
+    uint32_t latenciaControlMaximaUs;   // Mayor separación entre dos pasadas de control
+    HistogramaLatencia latenciaControl;
+};
+
+// Las tareas corren en el orden en que se registran dentro de su prioridad;
+// etapa es la EtapaLoop que se anota en la vigilancia durante cada paso
+bool registrarTareaLoop(const char *nombre, uint8_t etapa, PrioridadTarea prioridad, PasoTarea paso);
+
+// Una vuelta completa; devuelve true si quedaron tareas a mitad de trabajo
+bool ejecutarVueltaPlanificador();
+// Entre vueltas: duerme ESPERA_OCIOSA_MS si no hay nada pendiente y si lo hay
+// solo cede la CPU, durmiendo un tick cada MAXIMO_SIN_DORMIR_MS
+void esperarVueltaPlanificador(bool hayPendientes);
+
+const EstadisticasPlanificador &estadisticasPlanificador();
@@ -0,0 +1,290 @@
+#include "sse.h"
+#include "config.h"
+#include "zones.h"
+#include "websocket.h"
+#include "metricas.h"
+#include "api.h"
+#include <WiFi.h>
+#include <ArduinoJson.h>
+
+struct SuscriptorSse
+{
+    WiFiClient cliente;
+    bool activo;
+};
+
+// Conexión aceptada cuyas cabeceras todavía no terminaron de llegar. Se leen
+// línea a línea y solo se guarda lo que hace falta para responder.
+struct PeticionEventos
+{
+    WiFiClient cliente;
+    bool activa;
+    unsigned long inicio;
+    char linea[LARGO_LINEA_PETICION_EVENTOS];
+    uint8_t largoLinea;
+    char metodo[8];
+    char ruta[48];
+    char ultimoId[12];
+    char siNoCoincide[16];
+};
+
+static WiFiServer servidorEventos(PUERTO_EVENTOS);
+static SuscriptorSse suscriptoresSse[MAX_SUSCRIPTORES_SSE];
+static PeticionEventos peticiones[MAX_PETICIONES_EVENTOS];
+
+static void escribirEvento(WiFiClient &cliente, uint32_t generacion, const String &cadenaJson)
+{
+    char cabecera[24];
+    int largo = snprintf(cabecera, sizeof(cabecera), "id: %lu\ndata: ", (unsigned long)generacion);
+    cliente.write((const uint8_t *)cabecera, largo);
+    cliente.write((const uint8_t *)cadenaJson.c_str(), cadenaJson.length());
+    cliente.write((const uint8_t *)"\n\n", 2);
+    incrementarContador(CONTADOR_EVENTOS_SSE);
+}
+
+static void responderYCerrar(WiFiClient &cliente, const char *estado)
+{
+    cliente.printf("HTTP/1.1 %s\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", estado);
+    cliente.stop();
+}
+
+// GET /events
+// Cada evento lleva como id la generación de estado. Como cada evento es el
+// estado completo, reanudar tras una reconexión no requiere repetir historial:
+// si Last-Event-ID coincide con la generación actual el cliente ya está al día;
+// si no, recibe de inmediato el estado vigente.
+static void suscribir(WiFiClient &nuevo, const char *ultimoId)
+{
+    int libre = -1;
+    for (int i = 0; i < MAX_SUSCRIPTORES_SSE; i++)
+    {
+        if (!suscriptoresSse[i].activo || !suscriptoresSse[i].cliente.connected())
+        {
+            suscriptoresSse[i].cliente.stop();
+            libre = i;
+            break;
+        }
+    }
+    if (libre < 0)
+    {
+        responderYCerrar(nuevo, "503 Service Unavailable");
+        return;
+    }
+
+    suscriptoresSse[libre].cliente = nuevo;
+    if (!suscriptoresSse[libre].activo)
+    {
+        ajustarMedidor(MEDIDOR_SUSCRIPTORES_SSE, 1);
+    }
+    suscriptoresSse[libre].activo = true;
+    WiFiClient &cliente = suscriptoresSse[libre].cliente;
+    cliente.setNoDelay(true);
+    // El panel se sirve desde el puerto 80: otro origen para el navegador
+    cliente.print("HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+                  "Access-Control-Allow-Origin: *\r\nConnection: keep-alive\r\n\r\nretry: 3000\n\n");
+
+    if (ultimoId[0] == '\0' || (uint32_t)strtoul(ultimoId, nullptr, 10) != generacionEstado)
+    {
+        JsonDocument documento;
+        construirEstadoJson(documento);
+        String cadenaJson;
+        serializeJson(documento, cadenaJson);
+        escribirEvento(cliente, generacionEstado, cadenaJson);
+    }
+
+    Serial.printf("SSE [%d] suscrito (Last-Event-ID: %s, heap libre: %u)\n",
+                  libre, ultimoId[0] ? ultimoId : "-", ESP.getFreeHeap());
+}
+
+static void despacharPeticion(PeticionEventos &peticion)
+{
+    char *consulta = strchr(peticion.ruta, '?');
+    if (consulta != nullptr)
+    {
+        *consulta++ = '\0';
+    }
+    else
+    {
+        consulta = peticion.ruta + strlen(peticion.ruta);
+    }
+    if (strcmp(peticion.metodo, "GET") != 0)
+    {
+        responderYCerrar(peticion.cliente, "405 Method Not Allowed");
+    }
+    else if (strcmp(peticion.ruta, "/events") == 0)
+    {
+        suscribir(peticion.cliente, peticion.ultimoId);
+    }
+    else if (strcmp(peticion.ruta, "/api/state") == 0)
+    {
+        atenderPeticionEstado(peticion.cliente, consulta, peticion.siNoCoincide);
+    }
+    else
+    {
+        responderYCerrar(peticion.cliente, "404 Not Found");
+    }
+    peticion.cliente = WiFiClient();
+    peticion.activa = false;
+}
+
+static void copiarCabecera(const char *linea, const char *nombre, char *destino, size_t capacidad)
+{
+    size_t largoNombre = strlen(nombre);
+    if (strncasecmp(linea, nombre, largoNombre) != 0)
+    {
+        return;
+    }
+    linea += largoNombre;
+    while (*linea == ' ')
+    {
+        linea++;
+    }
+    snprintf(destino, capacidad, "%s", linea);
+}
+
+// Devuelve true al llegar la línea vacía que cierra las cabeceras
+static bool procesarLinea(PeticionEventos &peticion)
+{
+    const char *linea = peticion.linea;
+    if (peticion.metodo[0] == '\0')
+    {
+        if (sscanf(linea, "%7s %47s", peticion.metodo, peticion.ruta) != 2)
+        {
+            strcpy(peticion.metodo, "?");
+        }
+        return false;
+    }
+    if (linea[0] == '\0')
+    {
+        return true;
+    }
+    copiarCabecera(linea, "Last-Event-ID:", peticion.ultimoId, sizeof(peticion.ultimoId));
+    copiarCabecera(linea, "If-None-Match:", peticion.siNoCoincide, sizeof(peticion.siNoCoincide));
+    return false;
+}
+
+// Lee lo que haya llegado; las líneas más largas que el búfer se recortan
+// (ninguna cabecera que interese es tan larga)
+static void leerPeticion(PeticionEventos &peticion)
+{
+    while (peticion.cliente.available() > 0)
+    {
+        int caracter = peticion.cliente.read();
+        if (caracter < 0)
+        {
+            break;
+        }
+        if (caracter == '\r')
+        {
+            continue;
+        }
+        if (caracter != '\n')
+        {
+            if (peticion.largoLinea < sizeof(peticion.linea) - 1)
+            {
+                peticion.linea[peticion.largoLinea++] = (char)caracter;
+            }
+            continue;
+        }
+        peticion.linea[peticion.largoLinea] = '\0';
+        peticion.largoLinea = 0;
+        if (procesarLinea(peticion))
+        {
+            despacharPeticion(peticion);
+            return;
+        }
+    }
+
+    if (!peticion.cliente.connected())
+    {
+        peticion.cliente.stop();
+        peticion.activa = false;
+    }
+    else if (millis() - peticion.inicio > ESPERA_MAXIMA_PETICION_EVENTOS_MS)
+    {
+        responderYCerrar(peticion.cliente, "408 Request Timeout");
+        peticion.activa = false;
+    }
+}
+
+void iniciarServidorEventos()
+{
+    servidorEventos.begin();
+    servidorEventos.setNoDelay(true);
+    Serial.printf("Servidor de eventos iniciado en puerto %u\n", (unsigned)PUERTO_EVENTOS);
+}
+
+void atenderServidorEventos()
+{
+    WiFiClient nuevo = servidorEventos.available();
+    if (nuevo)
+    {
+        int libre = -1;
+        for (int i = 0; i < MAX_PETICIONES_EVENTOS; i++)
+        {
+            if (!peticiones[i].activa)
+            {
+                libre = i;
+                break;
+            }
+        }
+        if (libre < 0)
+        {
+            responderYCerrar(nuevo, "503 Service Unavailable");
+        }
+        else
+        {
+            PeticionEventos &peticion = peticiones[libre];
+            peticion.cliente = nuevo;
+            peticion.activa = true;
+            peticion.inicio = millis();
+            peticion.largoLinea = 0;
+            peticion.metodo[0] = '\0';
+            peticion.ruta[0] = '\0';
+            peticion.ultimoId[0] = '\0';
+            peticion.siNoCoincide[0] = '\0';
+        }
+    }
+
+    for (int i = 0; i < MAX_PETICIONES_EVENTOS; i++)
+    {
+        if (peticiones[i].activa)
+        {
+            leerPeticion(peticiones[i]);
+        }
+    }
+}
+
+// Envía el mismo frame ya serializado (el del WebSocket) a todos los suscriptores
+void difundirEventoSse(uint32_t generacion, const String &cadenaJson)
+{
+    for (int i = 0; i < MAX_SUSCRIPTORES_SSE; i++)
+    {
+        if (!suscriptoresSse[i].activo)
+        {
+            continue;
+        }
+        WiFiClient &cliente = suscriptoresSse[i].cliente;
+        if (!cliente.connected())
+        {
+            cliente.stop();
+            suscriptoresSse[i].activo = false;
+            ajustarMedidor(MEDIDOR_SUSCRIPTORES_SSE, -1);
+            Serial.printf("SSE [%d] desconectado (heap libre: %u)\n", i, ESP.getFreeHeap());
+            continue;
+        }
+        escribirEvento(cliente, generacion, cadenaJson);
+    }
+}
+
+bool haySuscriptoresSse()
+{
+    for (int i = 0; i < MAX_SUSCRIPTORES_SSE; i++)
+    {
+        if (suscriptoresSse[i].activo)
+        {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <Arduino.h>
+
+// Server-Sent Events: alternativa al WebSocket del puerto 81. Se sirven desde
+// su propio WiFiServer en PUERTO_EVENTOS y no desde WebServer, que atiende un
+// solo cliente a la vez: una conexión que queda abierta lo deja esperando el
+// cierre (unos 2 s) y frena el resto de las peticiones HTTP. Por lo mismo, el
+// long-poll de GET /api/state?wait= también llega por este puerto (api.cpp).
+void iniciarServidorEventos();
+// Cada vuelta del loop: acepta conexiones y lee sus cabeceras sin bloquear
+void atenderServidorEventos();
+void difundirEventoSse(uint32_t generacion, const String &cadenaJson);
+bool haySuscriptoresSse();
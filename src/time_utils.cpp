@@ -1,74 +1,324 @@
 #include "time_utils.h"
 #include "config.h"
+#include "zones.h"
+#include "persistencia.h"
+#include "calendario.h"
 #include <Arduino.h>
+#ifdef ARDUINO
+#include <atomic>
+#include <esp_timer.h>
+#include <esp_sntp.h>
+#endif
 
-String horariosLaborales[CANTIDAD_HORARIOS][2] = {
-    {"08:00", "12:00"},
-    {"14:00", "18:10"}};
+Horario horariosLaborales[CANTIDAD_HORARIOS] = {
+    {8 * 60, 12 * 60},
+    {14 * 60, 18 * 60 + 10}};
 
-int horaActual = 19;
-int minutoActual = 0;
-int segundoActual = 0;
-unsigned long referenciaDelTiempo = 0;
 bool estaEnHorarioLaboral = true;
 
-void actualizarRelojInterno()
+static const uint64_t MICROS_POR_SEGUNDO = 1000000ULL;
+static const uint64_t MICROS_POR_MINUTO = 60 * MICROS_POR_SEGUNDO;
+static const uint64_t MICROS_POR_DIA = 24 * 60 * MICROS_POR_MINUTO;
+
+// El reloj es un único desplazamiento sobre el contador monotónico de 64 bits:
+// hora local = baseLocal + transcurrido desde baseMonotonica, corregido por la
+// deriva aprendida. La hora local se cuenta en microsegundos desde el
+// 1/1/1970 00:00 (jueves); arranca el lunes 5/1/1970 a las 19:00.
+static uint64_t baseMonotonica = 0;
+static uint64_t baseLocal = (4 * 24 + 19) * 60 * MICROS_POR_MINUTO;
+static int32_t derivaPpb = 0;
+
+// Última sincronización precisa (SNTP o reloj del navegador), de la que se mide la deriva
+static bool hayReferenciaPrecisa = false;
+static uint64_t monotonicaReferenciaPrecisa = 0;
+
+// Desglose cacheado: se recalcula solo cuando se lee en otro segundo
+struct HoraPared
+{
+    uint64_t inicioSegundo;
+    uint8_t dia;
+    uint8_t hora;
+    uint8_t minuto;
+    uint8_t segundo;
+};
+static HoraPared horaPared = {UINT64_MAX, 0, 0, 0, 0};
+
+static uint64_t proximoMinutoMonotonico = 0;
+
+#ifdef ARDUINO
+// SNTP entrega la hora en su propia tarea; el loop la aplica en la siguiente vuelta
+static std::atomic<bool> sntpPendiente(false);
+static uint64_t sntpMicrosLocales = 0;
+static uint64_t sntpMonotonica = 0;
+#endif
+
+static uint64_t microsMonotonicos()
 {
+#ifdef ARDUINO
+    return (uint64_t)esp_timer_get_time();
+#else
+    return hostMicros();
+#endif
+}
 
-    unsigned long tiempoActual = millis();
-    unsigned long segundosTranscurridos = (tiempoActual - referenciaDelTiempo) / 1000;
+static uint64_t microsLocalesEn(uint64_t monotonica)
+{
+    uint64_t transcurrido = monotonica - baseMonotonica;
+    // En milisegundos para que el producto no desborde en décadas de funcionamiento
+    int64_t correccion = (int64_t)(transcurrido / 1000) * derivaPpb / 1000000;
+    return baseLocal + transcurrido + correccion;
+}
+
+uint64_t microsLocales()
+{
+    return microsLocalesEn(microsMonotonicos());
+}
 
-    if (segundosTranscurridos > 0)
+static const HoraPared &leerHoraPared()
+{
+    uint64_t local = microsLocales();
+    if (local >= horaPared.inicioSegundo && local - horaPared.inicioSegundo < MICROS_POR_SEGUNDO)
     {
-        segundoActual += segundosTranscurridos;
+        return horaPared;
+    }
+    uint64_t segundos = local / MICROS_POR_SEGUNDO;
+    horaPared.inicioSegundo = segundos * MICROS_POR_SEGUNDO;
+    horaPared.segundo = segundos % 60;
+    horaPared.minuto = (segundos / 60) % 60;
+    horaPared.hora = (segundos / 3600) % 24;
+    horaPared.dia = (segundos / 86400 + 3) % 7;
+    return horaPared;
+}
 
-        // Mostrar hora solo cada minuto para no saturar Serial
-        static int ultimoMinutoMostrado = -1;
+int horaActual()
+{
+    return leerHoraPared().hora;
+}
 
-        if (segundoActual >= 60)
-        {
-            minutoActual += segundoActual / 60;
-            segundoActual %= 60;
-
-            if (minutoActual >= 60)
-            {
-                horaActual += minutoActual / 60;
-                minutoActual %= 60;
-
-                if (horaActual >= 24)
-                {
-                    horaActual %= 24;
-                }
-            }
-        }
+int minutoActual()
+{
+    return leerHoraPared().minuto;
+}
+
+int segundoActual()
+{
+    return leerHoraPared().segundo;
+}
 
-        // Solo mostrar cuando cambie el minuto
-        if (minutoActual != ultimoMinutoMostrado)
+int diaSemanaActual()
+{
+    return leerHoraPared().dia;
+}
+
+int32_t derivaRelojPpb()
+{
+    return derivaPpb;
+}
+
+// Última hora conocida para retomarla tras un corte (el tiempo sin energía se pierde)
+struct RelojGuardado
+{
+    uint64_t microsLocales;
+    int32_t derivaPpb;
+    uint32_t valido;
+};
+static RelojGuardado relojGuardado = {};
+
+static void guardarReloj()
+{
+    relojGuardado = {microsLocales(), derivaPpb, 1};
+    marcarClaveModificada(CLAVE_RELOJ);
+}
+
+static void programarProximoMinuto(uint64_t monotonica)
+{
+    uint64_t local = microsLocalesEn(monotonica);
+    proximoMinutoMonotonico = monotonica + (MICROS_POR_MINUTO - local % MICROS_POR_MINUTO);
+}
+
+static void fijarMicrosLocales(uint64_t monotonica, uint64_t local)
+{
+    baseMonotonica = monotonica;
+    baseLocal = local;
+    horaPared.inicioSegundo = UINT64_MAX;
+    programarProximoMinuto(monotonica);
+}
+
+void restaurarConfiguracionHoraria()
+{
+    restaurarCalendarios();
+    if (restaurarClave(CLAVE_RELOJ, "reloj", &relojGuardado, sizeof(relojGuardado)) && relojGuardado.valido &&
+        relojGuardado.derivaPpb >= -DERIVA_MAXIMA_PPB && relojGuardado.derivaPpb <= DERIVA_MAXIMA_PPB)
+    {
+        derivaPpb = relojGuardado.derivaPpb;
+        fijarMicrosLocales(microsMonotonicos(), relojGuardado.microsLocales);
+        hayReferenciaPrecisa = false;
+        Serial.printf("🕐 Hora restaurada: %02d:%02d (día %d, deriva %ld ppb)\n",
+                      horaActual(), minutoActual(), diaSemanaActual(), (long)derivaPpb);
+    }
+}
+
+// Ajuste manual: mueve el reloj sin aprender deriva, y la próxima medida
+// empieza desde cero porque el error incluye el propio ajuste
+static void ajustarMicrosLocales(uint64_t local)
+{
+    fijarMicrosLocales(microsMonotonicos(), local);
+    hayReferenciaPrecisa = false;
+    marcarCambioEstado();
+    guardarReloj();
+}
+
+static void aplicarSincronizacionPrecisa(uint64_t monotonica, uint64_t referencia)
+{
+    int64_t error = (int64_t)(referencia - microsLocalesEn(monotonica));
+    if (hayReferenciaPrecisa)
+    {
+        uint64_t transcurrido = monotonica - monotonicaReferenciaPrecisa;
+        // Un error mayor al 1 % no es deriva del cristal sino un cambio de hora
+        if (transcurrido >= INTERVALO_MINIMO_DERIVA_S * MICROS_POR_SEGUNDO &&
+            (uint64_t)(error < 0 ? -error : error) < transcurrido / 100)
         {
-            Serial.printf("Hora actual: %02d:%02d:%02d\n", horaActual, minutoActual, segundoActual);
-            ultimoMinutoMostrado = minutoActual;
+            int32_t medida = (int32_t)((double)error * 1e9 / (double)transcurrido);
+            // La mitad de lo medido: el retardo de la referencia se promedia entre sincronizaciones
+            derivaPpb = max<int32_t>(-DERIVA_MAXIMA_PPB, min<int32_t>(DERIVA_MAXIMA_PPB, derivaPpb + medida / 2));
+            Serial.printf("🕐 Deriva del reloj: error %lld µs en %llu s, corrección %ld ppb\n",
+                          (long long)error, (unsigned long long)(transcurrido / MICROS_POR_SEGUNDO), (long)derivaPpb);
         }
+    }
+    hayReferenciaPrecisa = true;
+    monotonicaReferenciaPrecisa = monotonica;
+    fijarMicrosLocales(monotonica, referencia);
+    marcarCambioEstado();
+    guardarReloj();
+}
+
+void sincronizarRelojPreciso(uint64_t microsLocalesReferencia)
+{
+    aplicarSincronizacionPrecisa(microsMonotonicos(), microsLocalesReferencia);
+}
+
+uint32_t segundosDesdeSincronizacionPrecisa()
+{
+    if (!hayReferenciaPrecisa)
+    {
+        return UINT32_MAX;
+    }
+    return (microsMonotonicos() - monotonicaReferenciaPrecisa) / MICROS_POR_SEGUNDO;
+}
+
+#ifdef ARDUINO
+static void alSincronizarSntp(struct timeval *tiempo)
+{
+    if (sntpPendiente.load(std::memory_order_acquire))
+    {
+        return;
+    }
+    sntpMonotonica = microsMonotonicos();
+    sntpMicrosLocales = (uint64_t)(tiempo->tv_sec + DESFASE_HORARIO_SEGUNDOS) * MICROS_POR_SEGUNDO + tiempo->tv_usec;
+    sntpPendiente.store(true, std::memory_order_release);
+}
+
+void iniciarSntp()
+{
+    if (SERVIDOR_SNTP[0] == '\0')
+    {
+        return;
+    }
+    sntp_setoperatingmode(SNTP_OPMODE_POLL);
+    sntp_setservername(0, SERVIDOR_SNTP);
+    sntp_set_time_sync_notification_cb(alSincronizarSntp);
+    sntp_init();
+    Serial.printf("🕐 SNTP con %s\n", SERVIDOR_SNTP);
+}
+#else
+void iniciarSntp()
+{
+}
+#endif
+
+// Llamado desde loop(): la hora se calcula al leerla, así que aquí solo se
+// compara contra el próximo cambio de minuto y se aplica una respuesta SNTP
+void actualizarRelojInterno()
+{
+#ifdef ARDUINO
+    if (sntpPendiente.load(std::memory_order_acquire))
+    {
+        aplicarSincronizacionPrecisa(sntpMonotonica, sntpMicrosLocales);
+        sntpPendiente.store(false, std::memory_order_release);
+    }
+#endif
 
-        referenciaDelTiempo = tiempoActual;
+    uint64_t ahora = microsMonotonicos();
+    if (ahora < proximoMinutoMonotonico)
+    {
+        return;
+    }
+    programarProximoMinuto(ahora);
+
+    // Mostrar hora solo cada minuto para no saturar Serial
+    Serial.printf("Hora actual: %02d:%02d:%02d\n", horaActual(), minutoActual(), segundoActual());
+    if (minutoActual() % MINUTOS_ENTRE_GUARDADOS_RELOJ == 0)
+    {
+        guardarReloj();
     }
 }
 
 bool verificarSiEsHorarioLaboral()
 {
-    for (int i = 0; i < CANTIDAD_HORARIOS; ++i)
+    return esMinutoLaboral(0);
+}
+
+// Convierte "HH:MM" a minutos desde medianoche validando el rango
+bool parsearHora(const char *cadena, uint16_t &minutos)
+{
+    int hora, minuto;
+    if (sscanf(cadena, "%d:%d", &hora, &minuto) != 2 ||
+        hora < 0 || hora >= 24 || minuto < 0 || minuto >= 60)
     {
-        int horaInicio, minutoInicio, horaFin, minutoFin;
-        sscanf(horariosLaborales[i][0].c_str(), "%d:%d", &horaInicio, &minutoInicio);
-        sscanf(horariosLaborales[i][1].c_str(), "%d:%d", &horaFin, &minutoFin);
+        return false;
+    }
+    minutos = hora * 60 + minuto;
+    return true;
+}
 
-        int minutosActuales = horaActual * 60 + minutoActual;
-        int minutosInicio = horaInicio * 60 + minutoInicio;
-        int minutosFin = horaFin * 60 + minutoFin;
+void formatearHora(uint16_t minutos, char destino[6])
+{
+    snprintf(destino, 6, "%02u:%02u", (unsigned)(minutos / 60) % 100, (unsigned)(minutos % 60));
+}
 
-        if (minutosActuales >= minutosInicio && minutosActuales < minutosFin)
-        {
-            return true;
-        }
+bool establecerHoraActual(int hora, int minuto, int segundo)
+{
+    if (hora < 0 || hora >= 24 || minuto < 0 || minuto >= 60 || segundo < 0 || segundo >= 60)
+    {
+        return false;
+    }
+    uint64_t inicioDia = microsLocales() / MICROS_POR_DIA * MICROS_POR_DIA;
+    ajustarMicrosLocales(inicioDia + ((hora * 60 + minuto) * 60 + segundo) * MICROS_POR_SEGUNDO);
+    return true;
+}
+
+bool establecerDiaSemana(int dia)
+{
+    if (dia < 0 || dia >= 7)
+    {
+        return false;
+    }
+    // Siempre hacia adelante: solo importa el día de la semana, no la fecha
+    int dias = (dia - diaSemanaActual() + 7) % 7;
+    ajustarMicrosLocales(microsLocales() + dias * MICROS_POR_DIA);
+    return true;
+}
+
+bool establecerHorario(int indice, uint16_t inicio, uint16_t fin)
+{
+    if (indice < 0 || indice >= CANTIDAD_HORARIOS || inicio >= 24 * 60 || fin > 24 * 60)
+    {
+        return false;
     }
-    return false;
+    horariosLaborales[indice].inicio = inicio;
+    horariosLaborales[indice].fin = fin;
+    aplicarHorarioBase(indice, inicio, fin);
+    Serial.printf("Horario actualizado: %02u:%02u - %02u:%02u\n",
+                  inicio / 60, inicio % 60, fin / 60, fin % 60);
+    return true;
 }
\ No newline at end of file
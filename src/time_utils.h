@@ -2,12 +2,38 @@
 
 #include <Arduino.h>
 
-extern String horariosLaborales[][2];
-extern int horaActual;
-extern int minutoActual;
-extern int segundoActual;
-extern unsigned long referenciaDelTiempo;
+// Intervalo laboral en minutos desde medianoche; se valida al recibirlo
+struct Horario
+{
+    uint16_t inicio;
+    uint16_t fin;
+};
+
+extern Horario horariosLaborales[];
 extern bool estaEnHorarioLaboral;
 
+// Hora de pared: un desplazamiento de 64 bits sobre el contador monotónico de
+// microsegundos. Se calcula al leerla (con el desglose cacheado por segundo),
+// así que no se acumula error ni depende del desborde de millis().
+uint64_t microsLocales();   // Microsegundos desde el 1/1/1970 00:00 hora local
+int horaActual();
+int minutoActual();
+int segundoActual();
+int diaSemanaActual();      // 0 = lunes ... 6 = domingo
+
 void actualizarRelojInterno();
-bool verificarSiEsHorarioLaboral();
\ No newline at end of file
+bool verificarSiEsHorarioLaboral();
+bool parsearHora(const char *cadena, uint16_t &minutos);
+void formatearHora(uint16_t minutos, char destino[6]);
+bool establecerHoraActual(int hora, int minuto, int segundo = 0);
+bool establecerDiaSemana(int dia);
+bool establecerHorario(int indice, uint16_t inicio, uint16_t fin);
+void restaurarConfiguracionHoraria();
+
+// Sincronización con una referencia precisa (SNTP o reloj del navegador): cada
+// una corrige la hora y, si la anterior fue hace al menos
+// INTERVALO_MINIMO_DERIVA_S, ajusta la deriva del cristal con el error medido
+void sincronizarRelojPreciso(uint64_t microsLocalesReferencia);
+uint32_t segundosDesdeSincronizacionPrecisa();   // UINT32_MAX si no hubo ninguna
+int32_t derivaRelojPpb();
+void iniciarSntp();   // Sin efecto si SERVIDOR_SNTP está vacío
\ No newline at end of file
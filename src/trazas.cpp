@@ -0,0 +1,152 @@
+#include "trazas.h"
+
+static Traza trazas[TRAZAS_RECIENTES];
+static int siguienteTraza = 0;
+static uint32_t ultimoId = 0;
+static Traza *trazaEnCurso = nullptr;   // Comando que el handler está aplicando ahora
+static int trazasSinPublicar = 0;
+static HistogramaLatencia histogramas[CANTIDAD_ETAPAS_TRAZA];
+
+void acumularLatencia(HistogramaLatencia &histograma, uint32_t micros)
+{
+    int cubeta = 0;
+    while (cubeta < CUBETAS_LATENCIA - 1 && micros > limiteCubetaLatencia(cubeta))
+    {
+        cubeta++;
+    }
+    histograma.cubetas[cubeta]++;
+    histograma.cantidad++;
+    histograma.sumaMicros += micros;
+}
+
+static void registrarLatencia(EtapaTraza etapa, uint32_t micros)
+{
+    acumularLatencia(histogramas[etapa], micros);
+}
+
+uint32_t limiteCubetaLatencia(int cubeta)
+{
+    return 64UL << cubeta;
+}
+
+uint32_t iniciarTraza(OrigenComando origen, int zona)
+{
+    Traza &traza = trazas[siguienteTraza];
+    siguienteTraza = (siguienteTraza + 1) % TRAZAS_RECIENTES;
+
+    // Si se pisa una traza aún sin publicar, deja de contarse como pendiente
+    if (traza.aplicado != 0 && traza.publicado == 0 && trazasSinPublicar > 0)
+    {
+        trazasSinPublicar--;
+    }
+
+    traza.id = ++ultimoId;
+    traza.origen = origen;
+    traza.zona = zona;
+    traza.recibido = micros();
+    traza.aplicado = 0;
+    traza.publicado = 0;
+    trazaEnCurso = &traza;
+    return traza.id;
+}
+
+static void sellarAplicada(Traza &traza)
+{
+    if (traza.aplicado == 0)
+    {
+        traza.aplicado = micros() | 1; // 0 se reserva para "sin aplicar"
+        registrarLatencia(ETAPA_APLICAR, traza.aplicado - traza.recibido);
+        trazasSinPublicar++;
+    }
+}
+
+// Llamado desde la escritura de relays: solo cuenta la primera del comando en curso
+void marcarTrazaAplicada()
+{
+    if (trazaEnCurso != nullptr)
+    {
+        sellarAplicada(*trazaEnCurso);
+    }
+}
+
+// Comandos que pasaron por la cola: se sellan al escribir sus relays, ya
+// fuera del handler. Los ids son consecutivos, así que su ranura es fija.
+void marcarTrazaAplicada(uint32_t idTraza)
+{
+    Traza &traza = trazas[(idTraza - 1) % TRAZAS_RECIENTES];
+    if (idTraza != 0 && traza.id == idTraza)
+    {
+        sellarAplicada(traza);
+    }
+}
+
+// Fin del handler: las escrituras de relays posteriores (timeouts, etc.) ya no son de este comando
+void terminarRecepcionTraza()
+{
+    trazaEnCurso = nullptr;
+}
+
+// Llamado después de enviar una difusión de estado
+void marcarTrazasPublicadas()
+{
+    if (trazasSinPublicar == 0)
+    {
+        return;
+    }
+    uint32_t ahora = micros() | 1;
+    int pendientes = 0;
+    for (int i = 0; i < TRAZAS_RECIENTES; i++)
+    {
+        Traza &traza = trazas[i];
+        if (traza.aplicado == 0 || traza.publicado != 0)
+        {
+            continue;
+        }
+        if (&traza == trazaEnCurso)
+        {
+            // La difusión salió antes de que el handler terminara de aplicar el comando
+            pendientes++;
+        }
+        else
+        {
+            traza.publicado = ahora;
+            registrarLatencia(ETAPA_PUBLICAR, traza.publicado - traza.aplicado);
+            registrarLatencia(ETAPA_TOTAL, traza.publicado - traza.recibido);
+        }
+    }
+    trazasSinPublicar = pendientes;
+}
+
+const HistogramaLatencia &histogramaLatencia(EtapaTraza etapa)
+{
+    return histogramas[etapa];
+}
+
+// Copia las trazas de la más reciente a la más antigua
+int obtenerTrazasRecientes(Traza destino[], int capacidad)
+{
+    int cantidad = 0;
+    for (int i = 1; i <= TRAZAS_RECIENTES && cantidad < capacidad; i++)
+    {
+        const Traza &traza = trazas[(siguienteTraza - i + TRAZAS_RECIENTES) % TRAZAS_RECIENTES];
+        if (traza.id != 0)
+        {
+            destino[cantidad++] = traza;
+        }
+    }
+    return cantidad;
+}
+
+const char *nombreOrigenComando(OrigenComando origen)
+{
+    switch (origen)
+    {
+    case ORIGEN_HTTP:
+        return "http";
+    case ORIGEN_WEBSOCKET:
+        return "ws";
+    case ORIGEN_API:
+        return "api";
+    }
+    return "?";
+}
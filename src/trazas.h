@@ -0,0 +1,58 @@
+#pragma once
+#include <Arduino.h>
+
+// Trazas de latencia de comandos de punta a punta. Cada comando recibe un id
+// de correlación al llegar y se sella en tres puntos:
+//   recibido  -> el handler HTTP/WebSocket lo acepta
+//   aplicado  -> primera escritura de relays que produce (para los que pasan
+//                por la cola de comandos, al vaciarla el loop)
+//   publicado -> primera difusión de estado enviada después de aplicarlo
+// Las diferencias alimentan histogramas log2 en microsegundos.
+
+enum OrigenComando : uint8_t
+{
+    ORIGEN_HTTP,
+    ORIGEN_WEBSOCKET,
+    ORIGEN_API,
+};
+
+enum EtapaTraza : uint8_t
+{
+    ETAPA_APLICAR,   // recibido -> aplicado
+    ETAPA_PUBLICAR,  // aplicado -> publicado
+    ETAPA_TOTAL,     // recibido -> publicado
+    CANTIDAD_ETAPAS_TRAZA
+};
+
+const int CUBETAS_LATENCIA = 16;    // Cubeta i: hasta 2^(i+6) us (64 us ... ~2 s), la última acumula el resto
+const int TRAZAS_RECIENTES = 16;
+
+struct Traza
+{
+    uint32_t id;
+    OrigenComando origen;
+    int8_t zona;            // -1 si el comando afecta a varias zonas
+    uint32_t recibido;      // micros()
+    uint32_t aplicado;
+    uint32_t publicado;
+};
+
+struct HistogramaLatencia
+{
+    uint32_t cubetas[CUBETAS_LATENCIA];
+    uint32_t cantidad;
+    uint64_t sumaMicros;
+};
+
+uint32_t iniciarTraza(OrigenComando origen, int zona);
+void marcarTrazaAplicada();
+void marcarTrazaAplicada(uint32_t idTraza);
+void terminarRecepcionTraza();
+void marcarTrazasPublicadas();
+
+// También los usan otros módulos para sus propias latencias (planificador.h)
+void acumularLatencia(HistogramaLatencia &histograma, uint32_t micros);
+uint32_t limiteCubetaLatencia(int cubeta);
+const HistogramaLatencia &histogramaLatencia(EtapaTraza etapa);
+int obtenerTrazasRecientes(Traza destino[], int capacidad);
+const char *nombreOrigenComando(OrigenComando origen);
@@ -0,0 +1,243 @@
+#include "vigilancia.h"
+#include "config.h"
+#include "metricas.h"
+#include <esp_attr.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+
+struct DescripcionEtapa
+{
+    const char *nombre;
+    uint32_t presupuestoMs;
+};
+
+// Mismo orden que EtapaLoop. Presupuestos holgados: una vuelta normal tarda
+// unos pocos milisegundos y la página principal es lo más lento en servirse.
+static const DescripcionEtapa etapasLoop[CANTIDAD_ETAPAS_LOOP] = {
+    {"http", 250},
+    {"websocket", 100},
+    {"reloj", 5},
+    {"estadisticas", 20},
+    {"dns", 20},
+    {"modo", 50},
+    {"comandos", 20},
+    {"pir", 20},
+    {"apagado", 20},
+    {"esperas", 50},
+    {"memoria", 20},
+    {"bitacora", 100},
+    {"persistencia", 100},
+    {"difusion", 100},
+};
+
+static const uint32_t MAGIA_VIGILANCIA = 0x56474C50;
+
+// Vive en memoria RTC sin inicializar: conserva su contenido en reinicios por
+// software, pánico y watchdog, y se descarta al encender el equipo.
+struct RegistroVigilancia
+{
+    uint32_t magia;
+    uint32_t arranques;
+    uint32_t siguiente;
+    uint32_t guardados;
+    volatile uint8_t etapaEnCurso;
+    volatile uint32_t duracionEnCursoMs;   // Actualizadas por el timer de vigilancia
+    volatile uint32_t segundosActivo;
+    ExcesoEtapa excesos[EXCESOS_GUARDADOS];
+};
+
+RTC_NOINIT_ATTR static RegistroVigilancia registro;
+
+static volatile uint32_t inicioEtapa = 0;
+static uint32_t maximosEtapas[CANTIDAD_ETAPAS_LOOP];
+static esp_reset_reason_t motivoReinicio = ESP_RST_UNKNOWN;
+static esp_timer_handle_t timerVigilancia = nullptr;
+
+static const char *const nombresHitosArranque[CANTIDAD_HITOS_ARRANQUE] = {"relays", "configuracion", "loop", "red"};
+static volatile uint32_t hitosArranque[CANTIDAD_HITOS_ARRANQUE];
+
+static void agregarExceso(uint8_t etapa, bool reinicio, uint32_t duracionMs, uint32_t segundosActivo, uint32_t arranque)
+{
+    ExcesoEtapa &exceso = registro.excesos[registro.siguiente];
+    exceso.arranque = (uint16_t)arranque;
+    exceso.etapa = etapa;
+    exceso.reinicio = reinicio ? 1 : 0;
+    exceso.duracionMs = duracionMs;
+    exceso.segundosActivo = segundosActivo;
+    registro.siguiente = (registro.siguiente + 1) % EXCESOS_GUARDADOS;
+    if (registro.guardados < (uint32_t)EXCESOS_GUARDADOS)
+    {
+        registro.guardados++;
+    }
+}
+
+// Corre en la tarea esp_timer: solo anota cuánto lleva la etapa en curso, así
+// que si el loop no vuelve nunca (watchdog, pánico) el dato queda en RTC
+static void revisarEtapaEnCurso(void *)
+{
+    registro.segundosActivo = millis() / 1000;
+    if (registro.etapaEnCurso < CANTIDAD_ETAPAS_LOOP)
+    {
+        registro.duracionEnCursoMs = (micros() - inicioEtapa) / 1000;
+    }
+}
+
+static void cerrarEtapa(uint32_t ahora)
+{
+    uint8_t etapa = registro.etapaEnCurso;
+    if (etapa >= CANTIDAD_ETAPAS_LOOP)
+    {
+        return;
+    }
+
+    uint32_t duracionMs = (ahora - inicioEtapa) / 1000;
+    registro.duracionEnCursoMs = 0;
+    if (duracionMs > maximosEtapas[etapa])
+    {
+        maximosEtapas[etapa] = duracionMs;
+    }
+    if (duracionMs > etapasLoop[etapa].presupuestoMs)
+    {
+        agregarExceso(etapa, false, duracionMs, millis() / 1000, registro.arranques);
+        incrementarContador(CONTADOR_EXCESOS_LOOP);
+        Serial.printf("⏱️ Etapa '%s' del loop tardó %u ms (presupuesto %u ms)\n",
+                      etapasLoop[etapa].nombre, duracionMs, etapasLoop[etapa].presupuestoMs);
+    }
+}
+
+void entrarEtapaLoop(EtapaLoop etapa)
+{
+    uint32_t ahora = micros();
+    cerrarEtapa(ahora);
+    inicioEtapa = ahora;
+    registro.etapaEnCurso = etapa;
+}
+
+void terminarVueltaLoop()
+{
+    cerrarEtapa(micros());
+    registro.etapaEnCurso = ETAPA_LOOP_NINGUNA;
+}
+
+void iniciarVigilancia()
+{
+    motivoReinicio = esp_reset_reason();
+    bool registroValido = registro.magia == MAGIA_VIGILANCIA &&
+                          registro.siguiente < (uint32_t)EXCESOS_GUARDADOS &&
+                          registro.guardados <= (uint32_t)EXCESOS_GUARDADOS;
+
+    if (!registroValido || motivoReinicio == ESP_RST_POWERON)
+    {
+        memset(&registro, 0, sizeof(registro));
+        registro.magia = MAGIA_VIGILANCIA;
+        registro.etapaEnCurso = ETAPA_LOOP_NINGUNA;
+    }
+    else if (registro.etapaEnCurso < CANTIDAD_ETAPAS_LOOP && motivoReinicio != ESP_RST_SW)
+    {
+        // El arranque anterior murió dentro de una etapa: se atribuye el reinicio a ella
+        agregarExceso(registro.etapaEnCurso, true, registro.duracionEnCursoMs,
+                      registro.segundosActivo, registro.arranques);
+        Serial.printf("🐕 Reinicio (%s) durante la etapa '%s' tras %u ms\n", motivoUltimoReinicio(),
+                      etapasLoop[registro.etapaEnCurso].nombre, registro.duracionEnCursoMs);
+    }
+
+    registro.arranques++;
+    registro.etapaEnCurso = ETAPA_LOOP_NINGUNA;
+    registro.duracionEnCursoMs = 0;
+
+    Serial.printf("🐕 Vigilancia del loop: arranque #%u, motivo %s, %u excesos registrados\n",
+                  registro.arranques, motivoUltimoReinicio(), registro.guardados);
+    ExcesoEtapa excesos[EXCESOS_GUARDADOS];
+    int cantidad = obtenerExcesosEtapas(excesos, EXCESOS_GUARDADOS);
+    for (int i = 0; i < cantidad && i < 5; i++)
+    {
+        Serial.printf("   arranque #%u, %u s: '%s' %u ms%s\n", excesos[i].arranque, excesos[i].segundosActivo,
+                      nombreEtapaLoop(excesos[i].etapa), excesos[i].duracionMs,
+                      excesos[i].reinicio ? " (reinicio)" : "");
+    }
+
+    esp_timer_create_args_t argumentos = {};
+    argumentos.callback = revisarEtapaEnCurso;
+    argumentos.name = "vigilancia";
+    if (esp_timer_create(&argumentos, &timerVigilancia) != ESP_OK ||
+        esp_timer_start_periodic(timerVigilancia, INTERVALO_VIGILANCIA_MS * 1000ULL) != ESP_OK)
+    {
+        Serial.println("❌ No se pudo iniciar el timer de vigilancia");
+    }
+}
+
+const char *nombreEtapaLoop(uint8_t etapa)
+{
+    return etapa < CANTIDAD_ETAPAS_LOOP ? etapasLoop[etapa].nombre : "?";
+}
+
+uint32_t presupuestoEtapaLoop(uint8_t etapa)
+{
+    return etapa < CANTIDAD_ETAPAS_LOOP ? etapasLoop[etapa].presupuestoMs : 0;
+}
+
+uint32_t maximoEtapaLoop(uint8_t etapa)
+{
+    return etapa < CANTIDAD_ETAPAS_LOOP ? maximosEtapas[etapa] : 0;
+}
+
+// Copia los excesos del más reciente al más antiguo
+int obtenerExcesosEtapas(ExcesoEtapa destino[], int capacidad)
+{
+    int cantidad = 0;
+    for (uint32_t i = 1; i <= registro.guardados && cantidad < capacidad; i++)
+    {
+        destino[cantidad++] = registro.excesos[(registro.siguiente + EXCESOS_GUARDADOS - i) % EXCESOS_GUARDADOS];
+    }
+    return cantidad;
+}
+
+const char *motivoUltimoReinicio()
+{
+    switch (motivoReinicio)
+    {
+    case ESP_RST_POWERON:
+        return "encendido";
+    case ESP_RST_EXT:
+        return "externo";
+    case ESP_RST_SW:
+        return "software";
+    case ESP_RST_PANIC:
+        return "panico";
+    case ESP_RST_INT_WDT:
+        return "watchdog_interrupciones";
+    case ESP_RST_TASK_WDT:
+        return "watchdog_tareas";
+    case ESP_RST_WDT:
+        return "watchdog";
+    case ESP_RST_BROWNOUT:
+        return "brownout";
+    default:
+        return "desconocido";
+    }
+}
+
+uint32_t numeroArranque()
+{
+    return registro.arranques;
+}
+
+// micros() cuenta desde que arranca esp_timer, poco después del reinicio; el
+// tiempo del bootloader de ROM queda fuera de la medida
+void marcarHitoArranque(HitoArranque hito)
+{
+    if (hito < CANTIDAD_HITOS_ARRANQUE && hitosArranque[hito] == 0)
+    {
+        hitosArranque[hito] = max(micros(), 1UL);
+    }
+}
+
+uint32_t hitoArranqueUs(uint8_t hito)
+{
+    return hito < CANTIDAD_HITOS_ARRANQUE ? hitosArranque[hito] : 0;
+}
+
+const char *nombreHitoArranque(uint8_t hito)
+{
+    return hito < CANTIDAD_HITOS_ARRANQUE ? nombresHitosArranque[hito] : "?";
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <Arduino.h>
+
+// Vigilancia de plazos del loop: cada vuelta se divide en etapas (una por
+// tarea del planificador) con un presupuesto en milisegundos por paso. Una
+// etapa que lo excede queda registrada en un anillo en memoria RTC que
+// sobrevive a un reinicio por pánico o watchdog, y un timer independiente
+// anota cuánto lleva la etapa en curso para poder atribuir también los
+// bloqueos que terminan en reinicio.
+
+enum EtapaLoop : uint8_t
+{
+    ETAPA_LOOP_HTTP,
+    ETAPA_LOOP_WEBSOCKET,
+    ETAPA_LOOP_RELOJ,
+    ETAPA_LOOP_ESTADISTICAS,
+    ETAPA_LOOP_DNS,
+    ETAPA_LOOP_MODO,
+    ETAPA_LOOP_COMANDOS,
+    ETAPA_LOOP_PIR,
+    ETAPA_LOOP_APAGADO,
+    ETAPA_LOOP_ESPERAS,
+    ETAPA_LOOP_MEMORIA,
+    ETAPA_LOOP_BITACORA,
+    ETAPA_LOOP_PERSISTENCIA,
+    ETAPA_LOOP_DIFUSION,
+    CANTIDAD_ETAPAS_LOOP,
+    ETAPA_LOOP_NINGUNA = 0xFF
+};
+
+struct ExcesoEtapa
+{
+    uint16_t arranque;        // Número de arranque en que ocurrió
+    uint8_t etapa;
+    uint8_t reinicio;         // 1 si la etapa no terminó: el equipo se reinició durante ella
+    uint32_t duracionMs;
+    uint32_t segundosActivo;
+};
+
+// Hitos del arranque en microsegundos desde el reinicio: cuánto tardan los
+// relays en volver a su estado y cuándo están la configuración, el loop y la red
+enum HitoArranque : uint8_t
+{
+    HITO_ARRANQUE_RELAYS,
+    HITO_ARRANQUE_CONFIGURACION,
+    HITO_ARRANQUE_LOOP,
+    HITO_ARRANQUE_RED,
+    CANTIDAD_HITOS_ARRANQUE
+};
+
+void iniciarVigilancia();
+void entrarEtapaLoop(EtapaLoop etapa);
+void terminarVueltaLoop();
+
+const char *nombreEtapaLoop(uint8_t etapa);
+uint32_t presupuestoEtapaLoop(uint8_t etapa);
+uint32_t maximoEtapaLoop(uint8_t etapa);
+int obtenerExcesosEtapas(ExcesoEtapa destino[], int capacidad);
+const char *motivoUltimoReinicio();
+uint32_t numeroArranque();
+
+void marcarHitoArranque(HitoArranque hito);
+uint32_t hitoArranqueUs(uint8_t hito);   // 0 si todavía no ocurrió
+const char *nombreHitoArranque(uint8_t hito);
@@ -2,40 +2,373 @@
 #include "config.h"
 #include "zones.h"
 #include "time_utils.h"
+#include "interrupts.h"
+#include "sse.h"
+#include "metricas.h"
+#include "trazas.h"
+#include "estadisticas.h"
+#include "calendario.h"
+#include "configuracion.h"
+#include "adaptacion.h"
+#include "comandos.h"
 #include <WebSocketsServer.h>
 #include <ArduinoJson.h>
 
 WebSocketsServer socketWeb = WebSocketsServer(81);
 
+// Suscripciones por cliente: un bit por número de cliente WebSocket.
+// Un cliente recién conectado recibe el estado completo (panel web); con el
+// comando "sub" pasa a recibir solo los temas y zonas que pidió.
+static_assert(WEBSOCKETS_SERVER_CLIENT_MAX <= 32, "Las máscaras de suscripción usan 32 bits");
+static uint32_t clientesEstadoCompleto = 0;
+static uint32_t suscriptoresReloj = 0;
+static uint32_t suscriptoresModo = 0;
+static uint32_t suscriptoresZona[CANTIDAD_ZONAS] = {};
+
+static void limpiarSuscripciones(uint8_t num)
+{
+    uint32_t mascara = ~(1UL << num);
+    clientesEstadoCompleto &= mascara;
+    suscriptoresReloj &= mascara;
+    suscriptoresModo &= mascara;
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        suscriptoresZona[i] &= mascara;
+    }
+}
+
+// {"cmd":"sub","temas":["reloj","modo"],"zonas":[0,3]}  o  {"cmd":"sub","temas":["todo"]}
+static bool suscribirCliente(uint8_t num, JsonDocument &comando)
+{
+    JsonArray temas = comando["temas"];
+    JsonArray listaZonas = comando["zonas"];
+    for (JsonVariant zona : listaZonas)
+    {
+        int indiceZona = zona | -1;
+        if (indiceZona < 0 || indiceZona >= CANTIDAD_ZONAS)
+        {
+            return false;
+        }
+    }
+
+    limpiarSuscripciones(num);
+    uint32_t bit = 1UL << num;
+    for (JsonVariant tema : temas)
+    {
+        const char *nombre = tema | "";
+        if (strcmp(nombre, "todo") == 0)
+        {
+            clientesEstadoCompleto |= bit;
+        }
+        else if (strcmp(nombre, "reloj") == 0)
+        {
+            suscriptoresReloj |= bit;
+        }
+        else if (strcmp(nombre, "modo") == 0)
+        {
+            suscriptoresModo |= bit;
+        }
+    }
+    for (JsonVariant zona : listaZonas)
+    {
+        suscriptoresZona[zona.as<int>()] |= bit;
+    }
+    return true;
+}
+
+// Protocolo de comandos sobre el socket ya abierto (evita un request HTTP + redirección por cambio).
+// Cada mensaje del cliente es un objeto JSON con un "id" elegido por el cliente y un "cmd":
+//   {"id":1,"cmd":"toggle","zona":0,"on":true}
+//   {"id":2,"cmd":"set","zonas":[{"zona":0,"on":true},{"zona":1,"on":false}]}
+//   {"id":3,"cmd":"hora","time":"HH:MM","dia":0}     ("dia" opcional, 0 = lunes)
+//   {"id":4,"cmd":"horario","indice":0,"inicio":"08:00","fin":"12:00"}
+//   {"id":5,"cmd":"sub","temas":["reloj","modo"],"zonas":[0]}
+// "on" tiene que ser true o false. La respuesta solo va al cliente que envió el comando:
+//   {"ack":1,"ok":true,"aplicado":<millis>}  o  {"ack":1,"ok":false,"error":"..."}
+// "aplicado" es el instante en que los relays quedaron escritos: los cambios
+// de zona pasan por la cola de comandos y su ack sale cuando el loop la vacía,
+// en la misma vuelta. Con la cola llena el error es "cola".
+static void responderComando(uint8_t num, long idComando, bool ok, const char *error, unsigned long aplicado, uint32_t idTraza)
+{
+    char respuesta[112];
+    if (ok)
+    {
+        snprintf(respuesta, sizeof(respuesta), "{\"ack\":%ld,\"ok\":true,\"aplicado\":%lu,\"traza\":%u}",
+                 idComando, aplicado, (unsigned)idTraza);
+    }
+    else
+    {
+        snprintf(respuesta, sizeof(respuesta), "{\"ack\":%ld,\"ok\":false,\"error\":\"%s\"}", idComando, error);
+    }
+    socketWeb.sendTXT(num, respuesta);
+}
+
+// Acks de cambios de zona que esperan a que el loop escriba los relays. Cada
+// uno ocupa al menos una ranura de la cola, así que no pueden ser más que
+// CAPACIDAD_COLA_COMANDOS.
+struct AckPendiente
+{
+    uint8_t num;
+    long idComando;
+    uint32_t idTraza;
+};
+
+static AckPendiente acksPendientes[CAPACIDAD_COLA_COMANDOS];
+static int cantidadAcksPendientes = 0;
+
+static void descartarAcksCliente(uint8_t num)
+{
+    int conservados = 0;
+    for (int i = 0; i < cantidadAcksPendientes; i++)
+    {
+        if (acksPendientes[i].num != num)
+        {
+            acksPendientes[conservados++] = acksPendientes[i];
+        }
+    }
+    cantidadAcksPendientes = conservados;
+}
+
+void responderComandosAplicados()
+{
+    uint32_t trazaAplicada = ultimaTrazaAplicada();
+    int conservados = 0;
+    for (int i = 0; i < cantidadAcksPendientes; i++)
+    {
+        const AckPendiente &ack = acksPendientes[i];
+        if ((int32_t)(ack.idTraza - trazaAplicada) <= 0)
+        {
+            responderComando(ack.num, ack.idComando, true, nullptr, momentoUltimaAplicacion(), ack.idTraza);
+        }
+        else
+        {
+            acksPendientes[conservados++] = ack;
+        }
+    }
+    cantidadAcksPendientes = conservados;
+}
+
+// Valida las zonas antes de encolar para distinguir el motivo del rechazo
+static bool encolarCambios(const CambioZona cambios[], int cantidad, uint32_t idTraza, const char *&motivo)
+{
+    for (int i = 0; i < cantidad; i++)
+    {
+        if (cambios[i].zona < 0 || cambios[i].zona >= CANTIDAD_ZONAS)
+        {
+            motivo = "zona";
+            return false;
+        }
+    }
+    motivo = "cola";
+    return cantidadAcksPendientes < CAPACIDAD_COLA_COMANDOS && encolarCambiosZonas(cambios, cantidad, idTraza);
+}
+
+static void procesarComandoSocketWeb(uint8_t num, uint8_t *payload, size_t length)
+{
+    JsonDocument comando;
+    DeserializationError error = deserializeJson(comando, payload, length);
+    if (error)
+    {
+        Serial.printf("[%u] Comando inválido: %s\n", num, error.c_str());
+        responderComando(num, -1, false, "json", 0, 0);
+        return;
+    }
+
+    long idComando = comando["id"] | -1L;
+    const char *tipo = comando["cmd"] | "";
+    bool ok = false;
+    const char *motivo = "cmd";
+    uint32_t idTraza = 0;
+
+    bool cambiaZonas = false;
+
+    if (strcmp(tipo, "toggle") == 0)
+    {
+        cambiaZonas = true;
+        if (comando["on"].is<bool>())
+        {
+            CambioZona cambio = {comando["zona"] | -1, comando["on"].as<bool>()};
+            idTraza = iniciarTraza(ORIGEN_WEBSOCKET, cambio.zona);
+            ok = encolarCambios(&cambio, 1, idTraza, motivo);
+        }
+        else
+        {
+            motivo = "on";
+        }
+    }
+    else if (strcmp(tipo, "set") == 0)
+    {
+        CambioZona cambios[MAX_CAMBIOS_POR_LOTE];
+        int cantidad = 0;
+        JsonArray lista = comando["zonas"];
+        ok = !lista.isNull() && lista.size() <= (size_t)MAX_CAMBIOS_POR_LOTE;
+        motivo = ok ? "on" : "zona";
+        for (JsonVariant cambio : lista)
+        {
+            if (!ok || !cambio["on"].is<bool>())
+            {
+                ok = false;
+                break;
+            }
+            cambios[cantidad].zona = cambio["zona"] | -1;
+            cambios[cantidad].encender = cambio["on"].as<bool>();
+            cantidad++;
+        }
+        if (ok)
+        {
+            idTraza = iniciarTraza(ORIGEN_WEBSOCKET, -1);
+            ok = encolarCambios(cambios, cantidad, idTraza, motivo);
+        }
+        // Un lote vacío no pasa por la cola: se confirma ya
+        cambiaZonas = cantidad > 0;
+    }
+    else if (strcmp(tipo, "hora") == 0)
+    {
+        int hora, minuto;
+        const char *cadenaHora = comando["time"] | "";
+        ok = sscanf(cadenaHora, "%d:%d", &hora, &minuto) == 2 && establecerHoraActual(hora, minuto) &&
+             (comando["dia"].isNull() || establecerDiaSemana(comando["dia"] | -1));
+        motivo = "hora";
+    }
+    else if (strcmp(tipo, "horario") == 0)
+    {
+        uint16_t inicio, fin;
+        ok = parsearHora(comando["inicio"] | "", inicio) && parsearHora(comando["fin"] | "", fin) &&
+             establecerHorario(comando["indice"] | -1, inicio, fin);
+        motivo = "horario";
+    }
+    else if (strcmp(tipo, "sub") == 0)
+    {
+        ok = suscribirCliente(num, comando);
+        motivo = "zona";
+    }
+
+    terminarRecepcionTraza();
+    incrementarContador(ok ? CONTADOR_COMANDOS_WS : CONTADOR_COMANDOS_WS_RECHAZADOS);
+
+    // Los cambios de zona se confirman y se difunden al aplicarse
+    if (ok && cambiaZonas)
+    {
+        acksPendientes[cantidadAcksPendientes++] = {num, idComando, idTraza};
+        return;
+    }
+    responderComando(num, idComando, ok, motivo, millis(), idTraza);
+
+    // Difundir de inmediato para que el resto de clientes no espere al siguiente
+    // ciclo de 500 ms
+    if (ok)
+    {
+        enviarEstadoPorSocketWeb();
+    }
+}
+
 void eventoSocketWeb(uint8_t num, WStype_t type, uint8_t *payload, size_t length)
 {
     switch (type)
     {
     case WStype_DISCONNECTED:
-        Serial.printf("[%u] Desconectado!\n", num);
+        limpiarSuscripciones(num);
+        descartarAcksCliente(num);
+        ajustarMedidor(MEDIDOR_CLIENTES_WS, -1);
+        Serial.printf("[%u] Desconectado! (heap libre: %u)\n", num, ESP.getFreeHeap());
         break;
     case WStype_CONNECTED:
     {
         IPAddress ip = socketWeb.remoteIP(num);
-        Serial.printf("[%u] Conectado desde %d.%d.%d.%d\n", num, ip[0], ip[1], ip[2], ip[3]);
+        Serial.printf("[%u] Conectado desde %d.%d.%d.%d (heap libre: %u)\n", num, ip[0], ip[1], ip[2], ip[3], ESP.getFreeHeap());
+        limpiarSuscripciones(num);
+        clientesEstadoCompleto |= 1UL << num;
+        ajustarMedidor(MEDIDOR_CLIENTES_WS, 1);
         enviarEstadoPorSocketWeb();
         break;
     }
     case WStype_TEXT:
-        // Manejar comandos del cliente si es necesario
+        procesarComandoSocketWeb(num, payload, length);
         break;
     }
 }
 
-void enviarEstadoPorSocketWeb()
+static void construirZonaJson(JsonObject objetoZona, int i, bool incluirActividad)
 {
+    objetoZona["nombre"] = zonas[i].nombre.c_str();
+    objetoZona["activo"] = zonas[i].estaActivo;
+    objetoZona["laboral"] = zonaEnHorarioLaboral(i);
+    objetoZona["estado"] = nombreEstadoZona(zonas[i].estado);
+    objetoZona["timeoutS"] = configuracionActual().tiempoMaximoEncendidoMs[i] / 1000;
+    objetoZona["adaptativo"] = estadoAdaptacion(i).activa;
+
+    // Calcular tiempo desde último movimiento de forma segura
+    unsigned long tiempoDesdeMovimiento = 0;
+    if (zonas[i].ultimoMovimiento > 0)
+    {
+        tiempoDesdeMovimiento = (millis() - zonas[i].ultimoMovimiento) / 1000;
+    }
+    else
+    {
+        tiempoDesdeMovimiento = 999999; // Nunca hubo movimiento
+    }
+    objetoZona["movimiento"] = tiempoDesdeMovimiento;
+
+    objetoZona["tiempoEncendido"] = zonas[i].tiempoEncendido > 0 ? (millis() - zonas[i].tiempoEncendido) / 1000 : 0; // Tiempo desde que se encendió
+    objetoZona["sensorActual"] = nivelSensorPIR(i);                                                                  // Última lectura del sensor PIR
+    // Calcular countdown si está activo
+    if (zonas[i].estaActivo && zonas[i].ultimoMovimiento > 0)
+    {
+        unsigned long tiempoRestante = 0;
+
+        if (zonaEnHorarioLaboral(i))
+        {
+            // EN HORARIO LABORAL: SIN COUNTDOWN - Las luces permanecen encendidas para trabajar
+            tiempoRestante = 0; // No hay countdown en horario laboral
+        }
+        else
+        {
+            // FUERA DE HORARIO: Sistema de seguridad con countdown individual por zona
+            unsigned long tiempoSinMovimientoZona = millis() - zonas[i].ultimoMovimiento;
+            unsigned long tiempoMaximo = configuracionActual().tiempoMaximoEncendidoMs[i];
+            
+            if (tiempoSinMovimientoZona >= tiempoMaximo)
+            {
+                tiempoRestante = 0; // Se apagará inmediatamente
+            }
+            else
+            {
+                // Calcular tiempo restante hasta apagado (timeout de la zona desde el último movimiento)
+                tiempoRestante = (tiempoMaximo - tiempoSinMovimientoZona) / 1000;
+            }
+        }
+
+        objetoZona["countdown"] = tiempoRestante;
+    }
+    else
+    {
+        objetoZona["countdown"] = 0;
+    }
+
+    // Actividad: movimientos acumulados en cada hora del día de la semana actual
+    if (!incluirActividad)
+    {
+        return;
+    }
+    JsonArray actividadArray = objetoZona["actividad"].to<JsonArray>();
+    const EstadisticasZona &estadisticas = estadisticasZona(i);
+    int primeraCubeta = diaSemanaActual() * 24;
+    for (int hora = 0; hora < 24; hora++)
+    {
+        actividadArray.add(estadisticas.movimientos[primeraCubeta + hora]);
+    }
+}
 
-    JsonDocument documento;
+// Estado completo del sistema; lo comparten el WebSocket, SSE y GET /api/state
+void construirEstadoJson(JsonDocument &documento, bool incluirActividad)
+{
+    documento["generacion"] = generacionEstado;
 
     // Hora actual
-    documento["hora"] = horaActual;
-    documento["minuto"] = minutoActual;
-    documento["segundo"] = segundoActual;
+    documento["hora"] = horaActual();
+    documento["minuto"] = minutoActual();
+    documento["segundo"] = segundoActual();
+    documento["dia"] = diaSemanaActual();
 
     // Modo de operación
     documento["modo"] = estaEnHorarioLaboral ? "Horario Laboral" : "Fuera de Horario";
@@ -43,66 +376,118 @@ void enviarEstadoPorSocketWeb()
 
     // Estado de zonas
     JsonArray arregloZonas = documento["zonas"].to<JsonArray>();
-    for (int i = 0; i < 2; i++)
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
     {
-        JsonObject objetoZona = arregloZonas.add<JsonObject>();
-        objetoZona["nombre"] = zonas[i].nombre;
-        objetoZona["activo"] = zonas[i].estaActivo;
+        construirZonaJson(arregloZonas.add<JsonObject>(), i, incluirActividad);
+    }
+}
 
-        // Calcular tiempo desde último movimiento de forma segura
-        unsigned long tiempoDesdeMovimiento = 0;
-        if (zonas[i].ultimoMovimiento > 0)
+// Frames parciales: cada fragmento de zona se serializa una sola vez y se
+// reutiliza para todos los clientes suscritos a esa zona.
+static void enviarFramesParciales(uint32_t clientesParciales, bool incluirActividad)
+{
+    String fragmentosZona[CANTIDAD_ZONAS];
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        if (suscriptoresZona[i] & clientesParciales)
         {
-            tiempoDesdeMovimiento = (millis() - zonas[i].ultimoMovimiento) / 1000;
+            JsonDocument documentoZona;
+            JsonObject objetoZona = documentoZona.to<JsonObject>();
+            objetoZona["indice"] = i;
+            construirZonaJson(objetoZona, i, incluirActividad);
+            serializeJson(documentoZona, fragmentosZona[i]);
         }
-        else
+    }
+
+    char reloj[48];
+    snprintf(reloj, sizeof(reloj), ",\"hora\":%d,\"minuto\":%d,\"segundo\":%d", horaActual(), minutoActual(), segundoActual());
+    const char *modo = estaEnHorarioLaboral ? ",\"modo\":\"Horario Laboral\",\"modoActivo\":true"
+                                            : ",\"modo\":\"Fuera de Horario\",\"modoActivo\":false";
+    char inicio[32];
+    snprintf(inicio, sizeof(inicio), "{\"generacion\":%lu", (unsigned long)generacionEstado);
+
+    for (uint8_t num = 0; num < WEBSOCKETS_SERVER_CLIENT_MAX; num++)
+    {
+        uint32_t bit = 1UL << num;
+        if (!(clientesParciales & bit))
         {
-            tiempoDesdeMovimiento = 999999; // Nunca hubo movimiento
+            continue;
         }
-        objetoZona["movimiento"] = tiempoDesdeMovimiento;
-
-        objetoZona["tiempoEncendido"] = zonas[i].tiempoEncendido > 0 ? (millis() - zonas[i].tiempoEncendido) / 1000 : 0; // Tiempo desde que se encendió
-        objetoZona["sensorActual"] = digitalRead(zonas[i].pinPir);                                                       // Estado actual del sensor PIR
-        // Calcular countdown si está activo
-        if (zonas[i].estaActivo && zonas[i].ultimoMovimiento > 0)
+        String frame;
+        frame.reserve(64);
+        frame += inicio;
+        if (suscriptoresReloj & bit)
         {
-            unsigned long tiempoRestante = 0;
-
-            if (estaEnHorarioLaboral)
-            {
-                // EN HORARIO LABORAL: SIN COUNTDOWN - Las luces permanecen encendidas para trabajar
-                tiempoRestante = 0; // No hay countdown en horario laboral
-            }
-            else
+            frame += reloj;
+        }
+        if (suscriptoresModo & bit)
+        {
+            frame += modo;
+        }
+        frame += ",\"zonas\":[";
+        bool primera = true;
+        for (int i = 0; i < CANTIDAD_ZONAS; i++)
+        {
+            if (suscriptoresZona[i] & bit)
             {
-                // FUERA DE HORARIO: Sistema de seguridad con countdown individual por zona
-                unsigned long tiempoSinMovimientoZona = millis() - zonas[i].ultimoMovimiento;
-                
-                if (tiempoSinMovimientoZona >= TIEMPO_MAXIMO_ENCENDIDO)
-                {
-                    tiempoRestante = 0; // Se apagará inmediatamente
-                }
-                else
+                if (!primera)
                 {
-                    // Calcular tiempo restante hasta apagado (5 minutos desde último movimiento)
-                    tiempoRestante = (TIEMPO_MAXIMO_ENCENDIDO - tiempoSinMovimientoZona) / 1000;
+                    frame += ',';
                 }
+                frame += fragmentosZona[i];
+                primera = false;
             }
-
-            objetoZona["countdown"] = tiempoRestante;
         }
-        else
+        frame += "]}";
+        socketWeb.sendTXT(num, frame);
+        incrementarContador(CONTADOR_FRAMES_WS);
+    }
+}
+
+void enviarEstadoPorSocketWeb()
+{
+    incrementarContador(CONTADOR_DIFUSIONES_ESTADO);
+
+    // La actividad por hora (24 valores por zona) solo viaja en la primera
+    // difusión de cada hora; al cargar, el panel la toma de /api/stats
+    static int cubetaActividadDifundida = -1;
+    bool incluirActividad = cubetaHoraSemana() != cubetaActividadDifundida;
+
+    uint32_t clientesParciales = suscriptoresReloj | suscriptoresModo;
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        clientesParciales |= suscriptoresZona[i];
+    }
+    clientesParciales &= ~clientesEstadoCompleto;
+    if (incluirActividad && (clientesEstadoCompleto || clientesParciales || haySuscriptoresSse()))
+    {
+        cubetaActividadDifundida = cubetaHoraSemana();
+    }
+
+    // El frame completo solo se construye si algún cliente lo necesita; se
+    // serializa una vez y se comparte entre WebSocket y SSE
+    if (clientesEstadoCompleto || haySuscriptoresSse())
+    {
+        JsonDocument documento;
+        construirEstadoJson(documento, incluirActividad);
+        String cadenaJson;
+        serializeJson(documento, cadenaJson);
+        for (uint8_t num = 0; num < WEBSOCKETS_SERVER_CLIENT_MAX; num++)
         {
-            objetoZona["countdown"] = 0;
+            if (clientesEstadoCompleto & (1UL << num))
+            {
+                socketWeb.sendTXT(num, cadenaJson);
+                incrementarContador(CONTADOR_FRAMES_WS);
+            }
         }
-
-        // Historial de actividad (opcional, para futuras expansiones)
-        JsonArray actividadArray = objetoZona["actividad"].to<JsonArray>();
+        difundirEventoSse(generacionEstado, cadenaJson);
     }
 
-    String cadenaJson;
-    serializeJson(documento, cadenaJson);
-    socketWeb.broadcastTXT(cadenaJson);
+    if (clientesParciales)
+    {
+        enviarFramesParciales(clientesParciales, incluirActividad);
+    }
+    marcarTrazasPublicadas();
 
     // Debug: mostrar datos enviados cada 10 segundos para no saturar
     static unsigned long ultimoDebug = 0;
@@ -111,7 +496,7 @@ void enviarEstadoPorSocketWeb()
         Serial.printf("WebSocket - Modo: %s (%s), Hora: %02d:%02d:%02d\n",
                       estaEnHorarioLaboral ? "Laboral" : "Fuera",
                       estaEnHorarioLaboral ? "true" : "false",
-                      horaActual, minutoActual, segundoActual);
+                      horaActual(), minutoActual(), segundoActual());
         for (int i = 0; i < 2; i++)
         {
             unsigned long tiempoDesdeMovimiento = 0;
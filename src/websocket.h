@@ -1,7 +1,12 @@
 #pragma once
 #include <WebSocketsServer.h>
+#include <ArduinoJson.h>
 
 extern WebSocketsServer socketWeb;
 
 void eventoSocketWeb(uint8_t num, WStype_t type, uint8_t *payload, size_t length);
-void enviarEstadoPorSocketWeb();
\ No newline at end of file
+void enviarEstadoPorSocketWeb();
+// Después de aplicarComandosPendientes(): confirma los cambios de zona ya escritos
+void responderComandosAplicados();
+// Sin incluirActividad se omite "actividad" (los movimientos por hora del día)
+void construirEstadoJson(JsonDocument &documento, bool incluirActividad = false);
@@ -1,13 +1,65 @@
 #include "zones.h"
 #include "config.h"
 #include "time_utils.h"
+#include "metricas.h"
+#include "trazas.h"
+#include "bitacora.h"
+#include "estadisticas.h"
+#include "energia.h"
+#include "persistencia.h"
+#include "calendario.h"
+#include "configuracion.h"
+#include "adaptacion.h"
 #include <Arduino.h>
+#ifdef ARDUINO
+#include <esp_attr.h>
+#include <esp_system.h>
+#endif
 
 Zona zonas[CANTIDAD_ZONAS] = {
     Zona(13, 32, 25, "Zona 1"),
     Zona(15, 26, 21, "Zona 2")};
 
-Zona::Zona(int pir, int relay1, int relay2, String nombre)
+uint32_t generacionEstado = 1;
+
+// Un bit por zona encendida; se guarda en NVS para restaurar los relays tras un corte
+static_assert(CANTIDAD_ZONAS <= 64, "El estado persistente de zonas usa 64 bits como máximo");
+static MascaraZonas zonasEncendidas = 0;
+
+// Copia del mismo bitmask en memoria RTC, escrita en cada cambio: sobrevive a
+// reinicios por watchdog, pánico o caída de tensión y, a diferencia de NVS,
+// nunca va atrasada. Se lee antes que nada en setup() para devolver los relays
+// a su estado sin esperar a NVS, LittleFS ni la red.
+struct EspejoZonas
+{
+    uint32_t magia;
+    MascaraZonas encendidas;
+    MascaraZonas complemento;
+};
+static const uint32_t MAGIA_ESPEJO_ZONAS = 0x5A4F4E41;
+
+#ifdef ARDUINO
+RTC_NOINIT_ATTR
+#endif
+static EspejoZonas espejoZonas;
+
+static bool arranqueDesdeEspejo = false;
+static MascaraZonas zonasArranqueRapido = 0;
+static const char *origenRestauracion = "ninguno";
+
+static void guardarEspejoZonas()
+{
+    espejoZonas.encendidas = zonasEncendidas;
+    espejoZonas.complemento = ~zonasEncendidas;
+    espejoZonas.magia = MAGIA_ESPEJO_ZONAS;
+}
+
+void marcarCambioEstado()
+{
+    generacionEstado++;
+}
+
+Zona::Zona(int pir, int relay1, int relay2, const char *nombre)
 {
     pinPir = pir;
     pinesRelay[0] = relay1;
@@ -15,12 +67,37 @@ Zona::Zona(int pir, int relay1, int relay2, String nombre)
     ultimoMovimiento = 0;
     tiempoEncendido = 0;
     estaActivo = false;
-    this->nombre = nombre;
+    estado = ESTADO_APAGADA;
+    this->nombre.asignar(nombre);
 }
 
-void configurarEstadoZona(int indiceZona, bool activar)
+// Se construyen después de las zonas reales, en orden, y repiten sus pines
+Zona::Zona() : Zona(0, 0, 0, "")
+{
+    static int siguiente = 2;
+    const Zona &real = zonas[siguiente % 2];
+    pinPir = real.pinPir;
+    pinesRelay[0] = real.pinesRelay[0];
+    pinesRelay[1] = real.pinesRelay[1];
+    char texto[24];
+    snprintf(texto, sizeof(texto), "Zona %d", ++siguiente);
+    nombre.asignar(texto);
+}
+
+// Actualiza el estado en memoria sin tocar los relays
+static void actualizarEstadoZona(int indiceZona, bool activar)
 {
+    cambioEstadoEstadisticas(indiceZona, activar);
+    cambioEstadoEnergia(indiceZona, activar);
+    if (zonas[indiceZona].estaActivo != activar)
+    {
+        conmutacionesRelay[indiceZona].fetch_add(1, std::memory_order_relaxed);
+        zonasEncendidas ^= (MascaraZonas)1 << indiceZona;
+        guardarEspejoZonas();
+        marcarClaveModificada(CLAVE_ZONAS);
+    }
     zonas[indiceZona].estaActivo = activar;
+    marcarCambioEstado();
     if (activar)
     {
         zonas[indiceZona].tiempoEncendido = millis();
@@ -31,38 +108,386 @@ void configurarEstadoZona(int indiceZona, bool activar)
         zonas[indiceZona].tiempoEncendido = 0;
         Serial.printf("Zona %d: APAGADA\n", indiceZona + 1);
     }
+}
 
+static void escribirRelaysZona(int indiceZona)
+{
     for (int i = 0; i < 2; i++)
     {
-        digitalWrite(zonas[indiceZona].pinesRelay[i], activar ? VALOR_RELAY_ENCENDIDO : VALOR_RELAY_APAGADO);
+        digitalWrite(zonas[indiceZona].pinesRelay[i], zonas[indiceZona].estaActivo ? VALOR_RELAY_ENCENDIDO : VALOR_RELAY_APAGADO);
     }
+    marcarTrazaAplicada();
 }
 
-void controlarApagadoAutomatico()
+// Vencimientos de aviso y timeout por recalcular (ver controlarApagadoAutomatico())
+static bool vencimientosDesactualizados = true;
+
+void configurarEstadoZona(int indiceZona, bool activar)
 {
-    unsigned long tiempoActual = millis();
+    actualizarEstadoZona(indiceZona, activar);
+    zonas[indiceZona].estado = estadoParaZona(activar, zonaEnHorarioLaboral(indiceZona));
+    vencimientosDesactualizados = true;
+    escribirRelaysZona(indiceZona);
+}
 
-    if (estaEnHorarioLaboral)
+bool restaurarRelaysArranqueRapido()
+{
+    arranqueDesdeEspejo = espejoZonas.magia == MAGIA_ESPEJO_ZONAS &&
+                          espejoZonas.complemento == ~espejoZonas.encendidas;
+#ifdef ARDUINO
+    // Tras un encendido la memoria RTC no es fiable aunque pase la comprobación
+    if (esp_reset_reason() == ESP_RST_POWERON)
     {
-        // EN HORARIO LABORAL: NO se apagan automáticamente las luces
-        // Las luces permanecen encendidas para permitir el trabajo sin interrupciones
-        return; // No hacer nada durante horario laboral
+        arranqueDesdeEspejo = false;
     }
-    
-    // FUERA DE HORARIO: Control independiente por zona
-    // Cada zona se controla de forma independiente según su propio movimiento
+#endif
+    zonasArranqueRapido = arranqueDesdeEspejo ? espejoZonas.encendidas : 0;
+
+    // El nivel se fija antes de configurar el pin como salida para que un relay
+    // que debe seguir encendido no pase por apagado
     for (int i = 0; i < CANTIDAD_ZONAS; i++)
     {
-        if (zonas[i].estaActivo)  // Solo verificar zonas que están encendidas
+        pinMode(zonas[i].pinPir, INPUT);
+        bool encendida = (zonasArranqueRapido >> i) & 1;
+        for (int j = 0; j < 2; j++)
         {
-            unsigned long tiempoSinMovimiento = tiempoActual - zonas[i].ultimoMovimiento;
-            
-            // Si esta zona específica excede 5 minutos sin movimiento, apagarla
-            if (tiempoSinMovimiento > TIEMPO_MAXIMO_ENCENDIDO)
+            digitalWrite(zonas[i].pinesRelay[j], encendida ? VALOR_RELAY_ENCENDIDO : VALOR_RELAY_APAGADO);
+            pinMode(zonas[i].pinesRelay[j], OUTPUT);
+        }
+    }
+
+    if (!arranqueDesdeEspejo)
+    {
+        guardarEspejoZonas();
+    }
+    return arranqueDesdeEspejo;
+}
+
+const char *origenRestauracionZonas()
+{
+    return origenRestauracion;
+}
+
+// Vuelve a encender las zonas que estaban encendidas antes del corte; el
+// temporizador de apagado arranca de nuevo desde ahora. El modo se calcula
+// antes con la hora restaurada: con el valor por defecto de
+// estaEnHorarioLaboral una zona repuesta fuera de horario quedaría en
+// ENCENDIDA_LABORAL, que no vence nunca.
+void restaurarEstadoZonas()
+{
+    actualizarModoZonas();
+    bool hayGuardado = restaurarClave(CLAVE_ZONAS, "zonas", &zonasEncendidas, sizeof(zonasEncendidas));
+    if (!hayGuardado && !arranqueDesdeEspejo)
+    {
+        return;
+    }
+    // La copia RTC es más reciente que la de NVS, que se escribe con retardo;
+    // si difieren, los cambios de abajo vuelven a marcar la clave
+    MascaraZonas guardadas = arranqueDesdeEspejo ? zonasArranqueRapido : zonasEncendidas;
+    origenRestauracion = arranqueDesdeEspejo ? "rtc" : "nvs";
+    if (guardadas != zonasEncendidas)
+    {
+        marcarClaveModificada(CLAVE_ZONAS);
+    }
+    zonasEncendidas = 0;
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        if ((guardadas >> i) & 1)
+        {
+            zonas[i].ultimoMovimiento = millis();
+            configurarEstadoZona(i, true);
+        }
+    }
+}
+
+// Sucesos pendientes de despachar, en orden de llegada
+struct SucesoPendiente
+{
+    uint8_t zona;
+    SucesoZona suceso;
+};
+static SucesoPendiente sucesosPendientes[MAX_SUCESOS_PENDIENTES];
+static int cantidadSucesosPendientes = 0;
+
+// Próximo aviso o timeout de cada zona; se recalculan cuando cambia alguna
+// zona o la configuración, así que controlarApagadoAutomatico() solo compara
+// con el más cercano
+static unsigned long vencimientos[CANTIDAD_ZONAS];
+static unsigned long proximoVencimiento = 0;
+static bool hayVencimientos = false;
+static uint32_t versionVencimientos = 0;
+
+static unsigned long avisoExpiracion(unsigned long tiempoMaximo)
+{
+    return min(AVISO_EXPIRACION_MS, tiempoMaximo / 2);
+}
+
+static void recalcularVencimientos(const Configuracion &configuracion)
+{
+    hayVencimientos = false;
+    unsigned long ahora = millis();
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        unsigned long tiempoMaximo = configuracion.tiempoMaximoEncendidoMs[i];
+        if (zonas[i].estado == ESTADO_ENCENDIDA_FUERA_HORARIO)
+        {
+            vencimientos[i] = zonas[i].ultimoMovimiento + tiempoMaximo - avisoExpiracion(tiempoMaximo);
+        }
+        else if (zonas[i].estado == ESTADO_POR_EXPIRAR)
+        {
+            // El apagado es con más de tiempoMaximo sin movimiento
+            vencimientos[i] = zonas[i].ultimoMovimiento + tiempoMaximo + 1;
+        }
+        else
+        {
+            continue;
+        }
+        if (!hayVencimientos || (long)(vencimientos[i] - proximoVencimiento) < 0)
+        {
+            proximoVencimiento = vencimientos[i];
+        }
+        hayVencimientos = true;
+    }
+    // Un vencimiento ya pasado se atiende en la próxima llamada
+    if (hayVencimientos && (long)(proximoVencimiento - ahora) < 0)
+    {
+        proximoVencimiento = ahora;
+    }
+    versionVencimientos = configuracion.version;
+    vencimientosDesactualizados = false;
+}
+
+static void ejecutarAcciones(int indiceZona, SucesoZona suceso, uint8_t acciones)
+{
+    Zona &zona = zonas[indiceZona];
+    if (acciones & ACCION_MOVIMIENTO)
+    {
+        registrarEvento(zona.estaActivo ? EVENTO_MOVIMIENTO_ENCENDIDA : EVENTO_MOVIMIENTO_APAGADA, indiceZona);
+        movimientoEstadisticas(indiceZona);
+        movimientoEnergia(indiceZona);
+        movimientoAdaptacion(indiceZona, zona.estaActivo, millis() - zona.ultimoMovimiento);
+        if (zona.estaActivo)
+        {
+            Serial.printf("Zona %d: Movimiento detectado (PIR pin %d) - EXTENDIENDO tiempo de zona encendida\n",
+                          indiceZona + 1, zona.pinPir);
+        }
+        else
+        {
+            // AHORRO ENERGÉTICO: fuera de horario el PIR NUNCA enciende una zona apagada
+            Serial.printf("Zona %d: Movimiento detectado (PIR pin %d) - pero zona APAGADA, NO se enciende (ahorro energético)\n",
+                          indiceZona + 1, zona.pinPir);
+        }
+    }
+    if (acciones & ACCION_MANUAL)
+    {
+        registrarEvento((acciones & ACCION_ENCENDER) ? EVENTO_ENCENDIDO_MANUAL : EVENTO_APAGADO_MANUAL, indiceZona);
+        if (acciones & ACCION_ENCENDER)
+        {
+            encendidoManualAdaptacion(indiceZona);
+        }
+    }
+    if (acciones & ACCION_TIMEOUT)
+    {
+        apagadoTimeoutEstadisticas(indiceZona);
+        apagadoTimeoutAdaptacion(indiceZona, zona.ultimoMovimiento);
+    }
+    if (acciones & (ACCION_ENCENDER | ACCION_APAGAR))
+    {
+        actualizarEstadoZona(indiceZona, (acciones & ACCION_ENCENDER) != 0);
+    }
+    if (acciones & ACCION_REINICIAR_TIMER)
+    {
+        zona.ultimoMovimiento = millis();
+    }
+    if (acciones & ACCION_TIMEOUT)
+    {
+        apagadoTimeoutEnergia(indiceZona);
+        incrementarContador(CONTADOR_APAGADOS_TIMEOUT);
+        registrarEvento(EVENTO_APAGADO_TIMEOUT, indiceZona);
+        Serial.printf("Zona %d apagada por timeout (%lu s sin movimiento) - fuera de horario\n", indiceZona + 1,
+                      (unsigned long)(configuracionActual().tiempoMaximoEncendidoMs[indiceZona] / 1000));
+    }
+
+    if (suceso == SUCESO_ENCENDER)
+    {
+        Serial.printf("Zona %d encendida manualmente (%s)\n", indiceZona + 1,
+                      zonaEnHorarioLaboral(indiceZona) ? "horario laboral" : "fuera de horario");
+    }
+    else if (suceso == SUCESO_APAGAR)
+    {
+        Serial.printf("Zona %d apagada manualmente\n", indiceZona + 1);
+    }
+    else if (suceso == SUCESO_SALE_HORARIO && (acciones & ACCION_REINICIAR_TIMER))
+    {
+        Serial.printf("Zona %d: Tiempo de movimiento actualizado por cambio de modo\n", indiceZona + 1);
+    }
+}
+
+// Aplica un suceso con la tabla; devuelve true si cambió el estado de los relays
+static bool aplicarSuceso(int indiceZona, SucesoZona suceso)
+{
+    Zona &zona = zonas[indiceZona];
+    TransicionZona transicion = transicionZona(zona.estado, suceso);
+    ejecutarAcciones(indiceZona, suceso, transicion.acciones);
+    if (zona.estado != transicion.siguiente)
+    {
+        zona.estado = transicion.siguiente;
+        marcarCambioEstado();
+    }
+    if (transicion.acciones)
+    {
+        vencimientosDesactualizados = true;
+    }
+    return (transicion.acciones & (ACCION_ENCENDER | ACCION_APAGAR)) != 0;
+}
+
+void encolarSucesoZona(int indiceZona, SucesoZona suceso)
+{
+    if (cantidadSucesosPendientes == MAX_SUCESOS_PENDIENTES)
+    {
+        despacharSucesosZonas();
+    }
+    sucesosPendientes[cantidadSucesosPendientes++] = {(uint8_t)indiceZona, suceso};
+}
+
+void despacharSucesosZonas()
+{
+    bool escribirRelays[CANTIDAD_ZONAS] = {};
+    for (int i = 0; i < cantidadSucesosPendientes; i++)
+    {
+        int indiceZona = sucesosPendientes[i].zona;
+        SucesoZona suceso = sucesosPendientes[i].suceso;
+        if (suceso != SUCESO_ENTRA_HORARIO && suceso != SUCESO_SALE_HORARIO)
+        {
+            // El modo de la zona lo manda su calendario, aunque el cambio aún no se haya encolado
+            bool laboral = zonaEnHorarioLaboral(indiceZona);
+            if (estadoLaboral(zonas[indiceZona].estado) != laboral)
             {
-                configurarEstadoZona(i, false);
-                Serial.printf("Zona %d apagada por timeout (5 min sin movimiento) - fuera de horario\n", i + 1);
+                aplicarSuceso(indiceZona, laboral ? SUCESO_ENTRA_HORARIO : SUCESO_SALE_HORARIO);
             }
         }
+        bool cambiaronRelays = aplicarSuceso(indiceZona, suceso);
+        // Una orden del usuario siempre escribe sus relays, aunque ya estuvieran así
+        if (cambiaronRelays || suceso == SUCESO_ENCENDER || suceso == SUCESO_APAGAR)
+        {
+            escribirRelays[indiceZona] = true;
+        }
+    }
+    cantidadSucesosPendientes = 0;
+
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        if (escribirRelays[i])
+        {
+            escribirRelaysZona(i);
+        }
     }
-}
\ No newline at end of file
+}
+
+// Control manual inmediato. Los handlers de red no lo llaman: encolan en
+// comandos.h y el loop aplica. Devuelve false si el índice de zona no es
+// válido; en caso contrario los relays ya quedaron escritos al retornar.
+bool controlarZonaManualmente(int indiceZona, bool encender)
+{
+    if (indiceZona < 0 || indiceZona >= CANTIDAD_ZONAS)
+    {
+        return false;
+    }
+    encolarSucesoZona(indiceZona, encender ? SUCESO_ENCENDER : SUCESO_APAGAR);
+    despacharSucesosZonas();
+    return true;
+}
+
+// Aplica un lote de cambios manuales de forma atómica: si alguna zona no es
+// válida no se aplica ninguno. Los relays se escriben una sola vez al final,
+// una vez por zona afectada aunque aparezca repetida en el lote.
+bool aplicarCambiosZonas(const CambioZona cambios[], int cantidad)
+{
+    for (int i = 0; i < cantidad; i++)
+    {
+        if (cambios[i].zona < 0 || cambios[i].zona >= CANTIDAD_ZONAS)
+        {
+            return false;
+        }
+    }
+    for (int i = 0; i < cantidad; i++)
+    {
+        encolarSucesoZona(cambios[i].zona, cambios[i].encender ? SUCESO_ENCENDER : SUCESO_APAGAR);
+    }
+    despacharSucesosZonas();
+    return true;
+}
+
+bool actualizarModoZonas()
+{
+    bool nuevoModoHorario = verificarSiEsHorarioLaboral();
+    if (estaEnHorarioLaboral != nuevoModoHorario)
+    {
+        estaEnHorarioLaboral = nuevoModoHorario;
+        marcarCambioEstado();
+        Serial.printf("*** CAMBIO DE MODO *** De %s a %s\n",
+                      !estaEnHorarioLaboral ? "Horario Laboral" : "Fuera de Horario",
+                      estaEnHorarioLaboral ? "Horario Laboral" : "Fuera de Horario");
+    }
+
+    // Cada zona sigue su calendario; las del calendario 0 cambian con el modo general
+    MascaraZonas zonasEntran, zonasSalen;
+    if (!actualizarModosCalendario(zonasEntran, zonasSalen))
+    {
+        return false;
+    }
+    cambioModoEnergia(true, zonasEntran);
+    cambioModoEnergia(false, zonasSalen);
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        if ((zonasEntran >> i) & 1)
+        {
+            encolarSucesoZona(i, SUCESO_ENTRA_HORARIO);
+        }
+        else if ((zonasSalen >> i) & 1)
+        {
+            encolarSucesoZona(i, SUCESO_SALE_HORARIO);
+        }
+    }
+    despacharSucesosZonas();
+    marcarCambioEstado();
+    return true;
+}
+
+bool proximoVencimientoZonas(unsigned long &instante)
+{
+    if (vencimientosDesactualizados || configuracionActual().version != versionVencimientos)
+    {
+        recalcularVencimientos(configuracionActual());
+    }
+    instante = proximoVencimiento;
+    return hayVencimientos;
+}
+
+void controlarApagadoAutomatico()
+{
+    const Configuracion &configuracion = configuracionActual();
+    if (vencimientosDesactualizados || configuracion.version != versionVencimientos)
+    {
+        recalcularVencimientos(configuracion);
+    }
+    unsigned long tiempoActual = millis();
+    if (!hayVencimientos || (long)(tiempoActual - proximoVencimiento) < 0)
+    {
+        return;
+    }
+
+    // FUERA DE HORARIO: cada zona vence según su propio movimiento
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        if ((zonas[i].estado == ESTADO_ENCENDIDA_FUERA_HORARIO || zonas[i].estado == ESTADO_POR_EXPIRAR) &&
+            (long)(tiempoActual - vencimientos[i]) >= 0)
+        {
+            unsigned long tiempoSinMovimiento = tiempoActual - zonas[i].ultimoMovimiento;
+            encolarSucesoZona(i, tiempoSinMovimiento > configuracion.tiempoMaximoEncendidoMs[i] ? SUCESO_TIMEOUT : SUCESO_AVISO);
+        }
+    }
+    despacharSucesosZonas();
+    // Si ninguna transición cambió nada (p. ej. la zona entró en horario), no volver a vencer ya
+    recalcularVencimientos(configuracion);
+}
@@ -1,6 +1,8 @@
 #pragma once
 #include <Arduino.h>
 #include "config.h"
+#include "cadena_fija.h"
+#include "maquina_zona.h"
 
 struct Zona
 {
@@ -8,13 +10,51 @@ struct Zona
     int pinesRelay[2];
     unsigned long ultimoMovimiento;
     unsigned long tiempoEncendido;
-    bool estaActivo;
-    String nombre;
+    bool estaActivo;          // Igual a estadoEncendido(estado); lo leen los demás módulos (para fijarlo, configurarEstadoZona)
+    EstadoZona estado;
+    CadenaFija<LARGO_MAXIMO_NOMBRE_ZONA> nombre;
 
-    Zona(int pir, int relay1, int relay2, String nombre);
+    Zona(int pir, int relay1, int relay2, const char *nombre);
+    // Zonas sin hardware propio de las compilaciones con ZONAS_COMPILACION > 2
+    Zona();
 };
 
 extern Zona zonas[];
 
+// Contador monotónico de cambios de estado (zonas, PIR, modo, horarios, hora).
+// Sirve como ETag de GET /api/state: si no cambió, el cliente ya tiene el estado.
+extern uint32_t generacionEstado;
+void marcarCambioEstado();
+
+// Cambio manual de una zona dentro de un lote (API REST, comando "set" del WebSocket)
+struct CambioZona
+{
+    int zona;
+    bool encender;
+};
+
+// Los sucesos se acumulan y se aplican juntos con la tabla de maquina_zona.h;
+// los relays de cada zona afectada se escriben una vez por despacho. Antes de
+// cada suceso la zona se pone al día con el modo de su calendario.
+void encolarSucesoZona(int indiceZona, SucesoZona suceso);
+void despacharSucesosZonas();
+
+// Fija el estado sin pasar por la tabla (restauración tras un corte, tests)
 void configurarEstadoZona(int indiceZona, bool activar);
-void controlarApagadoAutomatico();
\ No newline at end of file
+bool controlarZonaManualmente(int indiceZona, bool encender);
+bool aplicarCambiosZonas(const CambioZona cambios[], int cantidad);
+// Pone al día el modo general y el de cada zona según su calendario; devuelve
+// true si alguna zona entró o salió de su horario laboral
+bool actualizarModoZonas();
+// Emite los avisos y timeouts vencidos; sin vencimientos pendientes no recorre las zonas
+void controlarApagadoAutomatico();
+// Próximo aviso o timeout (millis()); false si ninguna zona tiene uno pendiente
+bool proximoVencimientoZonas(unsigned long &instante);
+
+// Arranque: restaurarRelaysArranqueRapido() configura los pines y devuelve los
+// relays al estado de la copia en RTC (true si era válida); después,
+// restaurarEstadoZonas() pone al día el modo con la hora restaurada y rehace
+// el estado en memoria con esa copia o con NVS.
+bool restaurarRelaysArranqueRapido();
+void restaurarEstadoZonas();
+const char *origenRestauracionZonas();
\ No newline at end of file
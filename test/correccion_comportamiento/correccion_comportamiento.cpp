@@ -12,9 +12,9 @@ void setUp() {
     // Configurar estado inicial para tests
     estaEnHorarioLaboral = false; // Fuera de horario para test
     
-    // Resetear zonas
+    // Resetear zonas (configurarEstadoZona mantiene estado y estaActivo a la par)
     for (int i = 0; i < CANTIDAD_ZONAS; i++) {
-        zonas[i].estaActivo = false;
+        configurarEstadoZona(i, false);
         zonas[i].ultimoMovimiento = 0;
         zonas[i].tiempoEncendido = 0;
     }
@@ -32,12 +32,12 @@ void test_apagado_independiente_por_zona() {
     unsigned long tiempoBase = millis();
     
     // Zona 1: encendida hace 4 minutos, último movimiento hace 6 minutos (debe apagarse)
-    zonas[0].estaActivo = true;
+    configurarEstadoZona(0, true);
     zonas[0].tiempoEncendido = tiempoBase - (4 * 60 * 1000); // 4 min ago
     zonas[0].ultimoMovimiento = tiempoBase - (6 * 60 * 1000); // 6 min ago
     
     // Zona 2: encendida hace 2 minutos, último movimiento hace 2 minutos (debe seguir encendida)
-    zonas[1].estaActivo = true;
+    configurarEstadoZona(1, true);
     zonas[1].tiempoEncendido = tiempoBase - (2 * 60 * 1000); // 2 min ago
     zonas[1].ultimoMovimiento = tiempoBase - (2 * 60 * 1000); // 2 min ago
     
@@ -69,11 +69,11 @@ void test_countdown_individual_por_zona() {
     unsigned long tiempoBase = millis();
     
     // Zona 1: último movimiento hace 3 minutos (countdown = 2 min)
-    zonas[0].estaActivo = true;
+    configurarEstadoZona(0, true);
     zonas[0].ultimoMovimiento = tiempoBase - (3 * 60 * 1000); // 3 min ago
     
     // Zona 2: último movimiento hace 1 minuto (countdown = 4 min)
-    zonas[1].estaActivo = true;
+    configurarEstadoZona(1, true);
     zonas[1].ultimoMovimiento = tiempoBase - (1 * 60 * 1000); // 1 min ago
     
     // Calcular countdown para cada zona (similar a websocket.cpp)
@@ -113,7 +113,7 @@ void test_extension_tiempo_por_movimiento() {
     unsigned long tiempoBase = millis();
     
     // Zona 1: encendida, cerca del límite de tiempo
-    zonas[0].estaActivo = true;
+    configurarEstadoZona(0, true);
     zonas[0].ultimoMovimiento = tiempoBase - (4 * 60 * 1000 + 30 * 1000); // 4.5 min ago
     
     Serial.printf("Antes del movimiento - Tiempo sin movimiento: %.1f min\n", 
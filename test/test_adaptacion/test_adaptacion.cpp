@@ -0,0 +1,173 @@
+#include <unity.h>
+#include <Arduino.h>
+#include "../../src/adaptacion.h"
+#include "../../src/configuracion.h"
+#include "../../src/metricas.h"
+#include "../../src/zones.h"
+#include "../../src/time_utils.h"
+
+static const uint64_t SEGUNDO_US = 1000000ULL;
+
+static uint32_t timeoutZonaS(int zona) {
+    return configuracionActual().tiempoMaximoEncendidoMs[zona] / 1000;
+}
+
+static void movimiento(int zona) {
+    encolarSucesoZona(zona, SUCESO_MOVIMIENTO);
+    despacharSucesosZonas();
+}
+
+// Deja vencer el timeout de una zona encendida fuera de horario
+static void esperarTimeout(int zona) {
+#ifndef ARDUINO
+    hostAvanzarMicros((timeoutZonaS(zona) + 1) * SEGUNDO_US);
+    controlarApagadoAutomatico();
+    controlarApagadoAutomatico();
+#endif
+}
+
+void setUp() {
+#ifndef ARDUINO
+    Serial.silenciado = true;
+#endif
+    estaEnHorarioLaboral = false;
+    configurarEstadoZona(0, false);
+    configurarEstadoZona(1, false);
+}
+
+void tearDown() {
+#ifndef ARDUINO
+    Serial.silenciado = false;
+#endif
+}
+
+void test_pausas_cortas_bajan_el_timeout() {
+#ifndef ARDUINO
+    TEST_ASSERT_TRUE(estadoAdaptacion(0).activa);
+    TEST_ASSERT_EQUAL_UINT32(TIEMPO_MAXIMO_ENCENDIDO / 1000, timeoutZonaS(0));
+    controlarZonaManualmente(0, true);
+
+    // Con menos de MUESTRAS_MINIMAS_ADAPTACION el timeout no se toca
+    for (uint32_t i = 0; i < MUESTRAS_MINIMAS_ADAPTACION - 1; i++) {
+        hostAvanzarMicros(20 * SEGUNDO_US);
+        movimiento(0);
+    }
+    TEST_ASSERT_FALSE(aplicarTimeoutsAdaptativos());
+    TEST_ASSERT_EQUAL_UINT32(0, estadoAdaptacion(0).timeoutObjetivoS);
+
+    // Pausas de 20 s: el cuantil por el margen queda bajo el mínimo
+    hostAvanzarMicros(20 * SEGUNDO_US);
+    movimiento(0);
+    EstadoAdaptacion estado = estadoAdaptacion(0);
+    TEST_ASSERT_EQUAL_UINT32(MUESTRAS_MINIMAS_ADAPTACION, estado.muestras);
+    TEST_ASSERT_UINT32_WITHIN(5000, 20000, estado.cuantilPausaMs);
+    TEST_ASSERT_EQUAL_UINT32(TIMEOUT_ADAPTATIVO_MINIMO_S, estado.timeoutObjetivoS);
+    TEST_ASSERT_TRUE(aplicarTimeoutsAdaptativos());
+    TEST_ASSERT_EQUAL_UINT32(TIMEOUT_ADAPTATIVO_MINIMO_S, timeoutZonaS(0));
+
+    // Sin muestras nuevas no hay nada que publicar
+    TEST_ASSERT_FALSE(aplicarTimeoutsAdaptativos());
+
+    // La zona se apaga con el timeout aprendido
+    esperarTimeout(0);
+    TEST_ASSERT_FALSE(zonas[0].estaActivo);
+    Serial.println("✅ Pausas cortas bajan el timeout: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("Usa el reloj virtual de la compilación de host (env:native)");
+#endif
+}
+
+void test_apagado_en_falso_sube_el_timeout() {
+#ifndef ARDUINO
+    uint32_t enFalsoAntes = contadores[CONTADOR_APAGADOS_EN_FALSO].load();
+
+    // Actividad pasada la ventana de reactivación: no cuenta
+    controlarZonaManualmente(1, true);
+    esperarTimeout(1);
+    TEST_ASSERT_FALSE(zonas[1].estaActivo);
+    hostAvanzarMicros((VENTANA_REACTIVACION_S + 5) * SEGUNDO_US);
+    controlarZonaManualmente(1, true);
+    TEST_ASSERT_EQUAL_UINT32(0, estadoAdaptacion(1).apagadosEnFalso);
+
+    // Alguien vuelve a encender poco después de cada timeout
+    const uint32_t reactivaciones = (MUESTRAS_MINIMAS_ADAPTACION + PESO_REACTIVACION - 1) / PESO_REACTIVACION;
+    for (uint32_t i = 0; i < reactivaciones; i++) {
+        esperarTimeout(1);
+        TEST_ASSERT_FALSE(zonas[1].estaActivo);
+        hostAvanzarMicros(20 * SEGUNDO_US);
+        controlarZonaManualmente(1, true);
+    }
+    EstadoAdaptacion estado = estadoAdaptacion(1);
+    TEST_ASSERT_EQUAL_UINT32(reactivaciones, estado.apagadosEnFalso);
+    TEST_ASSERT_EQUAL_UINT32(reactivaciones * PESO_REACTIVACION, estado.muestras);
+    TEST_ASSERT_EQUAL_UINT32(enFalsoAntes + reactivaciones, contadores[CONTADOR_APAGADOS_EN_FALSO].load());
+
+    // La pausa sin cubrir fue el timeout más 20 s: el nuevo la cubre con margen
+    TEST_ASSERT_TRUE(estado.cuantilPausaMs >= TIEMPO_MAXIMO_ENCENDIDO + 20000);
+    TEST_ASSERT_TRUE(aplicarTimeoutsAdaptativos());
+    TEST_ASSERT_EQUAL_UINT32(estado.timeoutObjetivoS, timeoutZonaS(1));
+    TEST_ASSERT_TRUE(timeoutZonaS(1) > TIEMPO_MAXIMO_ENCENDIDO / 1000 + 20);
+    TEST_ASSERT_TRUE(timeoutZonaS(1) <= TIMEOUT_ADAPTATIVO_MAXIMO_S);
+    Serial.println("✅ Apagado en falso sube el timeout: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("Usa el reloj virtual de la compilación de host (env:native)");
+#endif
+}
+
+void test_timeout_fijo_detiene_la_adaptacion() {
+#ifndef ARDUINO
+    TEST_ASSERT_TRUE(fijarAdaptacionZona(0, false));
+    TEST_ASSERT_TRUE(establecerTimeoutZona(0, 200));
+    TEST_ASSERT_FALSE(fijarAdaptacionZona(CANTIDAD_ZONAS, false));
+
+    // Se sigue aprendiendo, pero no se publica
+    controlarZonaManualmente(0, true);
+    uint32_t muestras = estadoAdaptacion(0).muestras;
+    for (int i = 0; i < 10; i++) {
+        hostAvanzarMicros(20 * SEGUNDO_US);
+        movimiento(0);
+    }
+    EstadoAdaptacion estado = estadoAdaptacion(0);
+    TEST_ASSERT_FALSE(estado.activa);
+    TEST_ASSERT_EQUAL_UINT32(muestras + 10, estado.muestras);
+    TEST_ASSERT_FALSE(aplicarTimeoutsAdaptativos());
+    TEST_ASSERT_EQUAL_UINT32(200, timeoutZonaS(0));
+
+    // Al reactivarla vuelve al aprendido
+    TEST_ASSERT_TRUE(fijarAdaptacionZona(0, true));
+    TEST_ASSERT_TRUE(aplicarTimeoutsAdaptativos());
+    TEST_ASSERT_EQUAL_UINT32(TIMEOUT_ADAPTATIVO_MINIMO_S, timeoutZonaS(0));
+    Serial.println("✅ Timeout fijo detiene la adaptación: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("Usa el reloj virtual de la compilación de host (env:native)");
+#endif
+}
+
+void process() {
+    UNITY_BEGIN();
+
+    iniciarAdaptacion();
+    RUN_TEST(test_pausas_cortas_bajan_el_timeout);
+    RUN_TEST(test_apagado_en_falso_sube_el_timeout);
+    RUN_TEST(test_timeout_fijo_detiene_la_adaptacion);
+
+    UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000);
+    Serial.begin(115200);
+    Serial.println("Iniciando tests de timeouts adaptativos...");
+    process();
+}
+
+void loop() {
+    // Tests terminados
+}
+#else
+int main() {
+    process();
+    return 0;
+}
+#endif
@@ -0,0 +1,288 @@
+#include <unity.h>
+#include <Arduino.h>
+#include "../../src/config.h"
+#include "../../src/zones.h"
+#include "../../src/interrupts.h"
+#include "../../src/time_utils.h"
+#ifdef ARDUINO
+#include <esp_timer.h>
+#include "../../src/websocket.h"
+#include "../../src/mi_webserver.h"
+#else
+#include <chrono>
+#include <new>
+#endif
+
+// Microbenchmarks de las funciones calientes del loop. Se compila con
+// ZONAS_COMPILACION = 2, 16 y 64 (env:bench_* en platformio.ini) y cada
+// medición sale como una línea "BENCH {json}" que compara
+// tools/comparar_benchmarks.py. Asignaciones y bytes son por operación. En el host se
+// cuentan operator new y las llamadas a Serial (aunque esté silenciado); en la
+// placa, malloc/calloc/realloc con --wrap del enlazador.
+
+static const uint64_t TIEMPO_RONDA_NS = 50000000ULL;
+static const int REPETICIONES = 5;
+static const uint32_t ITERACIONES_MAXIMAS = 1UL << 24;
+
+static uint32_t asignaciones = 0;
+static uint64_t bytesAsignados = 0;
+static volatile uint32_t sumidero = 0;
+
+#ifdef ARDUINO
+static const char *PLATAFORMA = "esp32";
+
+static uint64_t relojNs() {
+    return (uint64_t)esp_timer_get_time() * 1000;
+}
+
+#ifdef CONTAR_ASIGNACIONES
+extern "C" {
+void *__real_malloc(size_t bytes);
+void *__real_calloc(size_t cantidad, size_t bytes);
+void *__real_realloc(void *puntero, size_t bytes);
+
+void *__wrap_malloc(size_t bytes) {
+    asignaciones++;
+    bytesAsignados += bytes;
+    return __real_malloc(bytes);
+}
+
+void *__wrap_calloc(size_t cantidad, size_t bytes) {
+    asignaciones++;
+    bytesAsignados += cantidad * bytes;
+    return __real_calloc(cantidad, bytes);
+}
+
+void *__wrap_realloc(void *puntero, size_t bytes) {
+    asignaciones++;
+    bytesAsignados += bytes;
+    return __real_realloc(puntero, bytes);
+}
+}
+#endif
+#else
+static const char *PLATAFORMA = "host";
+
+static uint64_t relojNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void *operator new(size_t bytes) {
+    asignaciones++;
+    bytesAsignados += bytes;
+    void *puntero = malloc(bytes ? bytes : 1);
+    if (!puntero) {
+        throw std::bad_alloc();
+    }
+    return puntero;
+}
+
+void operator delete(void *puntero) noexcept {
+    free(puntero);
+}
+
+void operator delete(void *puntero, size_t) noexcept {
+    free(puntero);
+}
+#endif
+
+// En el host el control no debe reservar memoria; en la placa Serial.printf
+// reserva con mensajes largos y solo se informa
+static void verificarSinAsignaciones(uint32_t asignacionesMedidas) {
+#ifndef ARDUINO
+    TEST_ASSERT_EQUAL_UINT32(0, asignacionesMedidas);
+#else
+    (void)asignacionesMedidas;
+#endif
+}
+
+static uint32_t llamadasSerial() {
+#ifndef ARDUINO
+    return Serial.llamadas;
+#else
+    return 0;
+#endif
+}
+
+struct Ronda {
+    uint64_t ns;
+    uint32_t asignaciones;
+    uint64_t bytes;
+    uint32_t llamadasSerial;
+};
+
+static Ronda correr(void (*operacion)(), uint32_t iteraciones) {
+    asignaciones = 0;
+    bytesAsignados = 0;
+    uint32_t llamadasAntes = llamadasSerial();
+    uint64_t inicio = relojNs();
+    for (uint32_t i = 0; i < iteraciones; i++) {
+        operacion();
+    }
+    Ronda ronda;
+    ronda.ns = relojNs() - inicio;
+    ronda.asignaciones = asignaciones;
+    ronda.bytes = bytesAsignados;
+    ronda.llamadasSerial = llamadasSerial() - llamadasAntes;
+    return ronda;
+}
+
+// Duplica las iteraciones hasta que una ronda cubra TIEMPO_RONDA_NS y se queda
+// con la más rápida de REPETICIONES: el ruido de la máquina solo suma tiempo.
+// Devuelve las asignaciones de la última ronda.
+static uint32_t medir(const char *funcion, void (*operacion)()) {
+    uint32_t iteraciones = 1;
+    Ronda ronda = correr(operacion, iteraciones);
+    while (ronda.ns < TIEMPO_RONDA_NS && iteraciones < ITERACIONES_MAXIMAS) {
+        iteraciones *= 2;
+        ronda = correr(operacion, iteraciones);
+    }
+    uint64_t mejorNs = ronda.ns;
+    for (int i = 1; i < REPETICIONES; i++) {
+        ronda = correr(operacion, iteraciones);
+        mejorNs = min(mejorNs, ronda.ns);
+    }
+
+#ifndef ARDUINO
+    bool silenciado = Serial.silenciado;
+    Serial.silenciado = false;
+#endif
+    Serial.printf("BENCH {\"funcion\":\"%s\",\"zonas\":%d,\"plataforma\":\"%s\",\"iteraciones\":%lu,"
+                  "\"ns_op\":%.1f,\"asignaciones_op\":%.3f,\"bytes_op\":%.1f,\"serial_op\":%.3f}\n",
+                  funcion, CANTIDAD_ZONAS, PLATAFORMA, (unsigned long)iteraciones,
+                  (double)mejorNs / iteraciones, (double)ronda.asignaciones / iteraciones,
+                  (double)ronda.bytes / iteraciones, (double)ronda.llamadasSerial / iteraciones);
+#ifndef ARDUINO
+    Serial.silenciado = silenciado;
+#endif
+    return ronda.asignaciones;
+}
+
+// Todas las zonas encendidas fuera del horario laboral, con el PIR procesándose
+static void prepararZonas() {
+    establecerHoraActual(22, 0);
+    actualizarRelojInterno();
+    estaEnHorarioLaboral = verificarSiEsHorarioLaboral();
+    actualizarModoZonas();
+    for (int i = 0; i < CANTIDAD_ZONAS; i++) {
+        zonas[i].ultimoMovimiento = millis();
+        configurarEstadoZona(i, true);
+    }
+    controlarApagadoAutomatico();
+}
+
+static void operacionHorarioLaboral() {
+    sumidero += verificarSiEsHorarioLaboral();
+}
+
+// Una vuelta del loop: 10 ms de reloj en el host
+static void operacionReloj() {
+#ifndef ARDUINO
+    hostAvanzarMicros(10000);
+#endif
+    actualizarRelojInterno();
+}
+
+// Lectura de todos los PIR; en el host, flanco de subida en cada zona una vez de cada dos
+static void operacionPir() {
+#ifndef ARDUINO
+    static int nivel = LOW;
+    nivel = !nivel;
+    for (int i = 0; i < 2; i++) {
+        hostFijarPin(zonas[i].pinPir, nivel);
+    }
+#endif
+    ultimaLecturaPIR = millis() - 100;
+    procesarInterrupcionesPIR();
+}
+
+static void operacionApagado() {
+    controlarApagadoAutomatico();
+}
+
+// Un movimiento obliga a recalcular los vencimientos
+static void operacionApagadoTrasMovimiento() {
+    static int zona = 0;
+    encolarSucesoZona(zona, SUCESO_MOVIMIENTO);
+    despacharSucesosZonas();
+    zona = (zona + 1) % CANTIDAD_ZONAS;
+    controlarApagadoAutomatico();
+}
+
+#ifdef ARDUINO
+// Lo que enviarEstadoPorSocketWeb() hace una vez por difusión con clientes conectados
+static void operacionSerializarEstado() {
+    JsonDocument documento;
+    construirEstadoJson(documento);
+    String cadenaJson;
+    serializeJson(documento, cadenaJson);
+    sumidero += cadenaJson.length();
+}
+
+// Sin cliente conectado: generación de la página sin el envío por la red
+static void operacionPaginaPrincipal() {
+    manejarPaginaPrincipal();
+}
+#endif
+
+void setUp() {
+#ifndef ARDUINO
+    Serial.silenciado = true;
+#endif
+    prepararZonas();
+}
+
+void tearDown() {
+#ifndef ARDUINO
+    Serial.silenciado = false;
+#endif
+}
+
+void test_funciones_de_control() {
+    verificarSinAsignaciones(medir("verificarSiEsHorarioLaboral", operacionHorarioLaboral));
+    verificarSinAsignaciones(medir("actualizarRelojInterno", operacionReloj));
+    prepararZonas();
+    verificarSinAsignaciones(medir("procesarInterrupcionesPIR", operacionPir));
+    prepararZonas();
+    verificarSinAsignaciones(medir("controlarApagadoAutomatico", operacionApagado));
+    verificarSinAsignaciones(medir("controlarApagadoAutomatico+movimiento", operacionApagadoTrasMovimiento));
+    Serial.println("✅ Funciones de control medidas: EXITOSO");
+}
+
+void test_red() {
+#ifdef ARDUINO
+    medir("enviarEstadoPorSocketWeb.serializacion", operacionSerializarEstado);
+    medir("manejarPaginaPrincipal", operacionPaginaPrincipal);
+    Serial.println("✅ Serialización y página medidas: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("WebSocket y WebServer solo existen en la placa (env:bench_esp32_*)");
+#endif
+}
+
+void process() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_funciones_de_control);
+    RUN_TEST(test_red);
+
+    UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000);
+    Serial.begin(115200);
+    Serial.println("Iniciando benchmarks de las funciones calientes...");
+    process();
+}
+
+void loop() {
+    // Benchmarks terminados
+}
+#else
+int main() {
+    process();
+    return 0;
+}
+#endif
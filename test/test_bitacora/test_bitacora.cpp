@@ -0,0 +1,130 @@
+#include <unity.h>
+#include <Arduino.h>
+#include "../../src/bitacora.h"
+
+// Los segmentos en RAM se comparten entre tests: cada test trabaja sobre el
+// último segmento devuelto y mira solo los registros que agregó
+static SegmentoBitacora segmentoMasNuevo() {
+    SegmentoBitacora segmentos[2] = {};
+    int cantidad = segmentosRamEnRango(0, 0, UINT32_MAX, segmentos, 2);
+    TEST_ASSERT_TRUE(cantidad > 0);
+    return segmentos[cantidad - 1];
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_registros_de_cuatro_bytes_con_delta() {
+#ifndef ARDUINO
+    hostFijarMicros(1000000ULL); // 10 décimas
+#endif
+    iniciarBitacora(3);
+    registrarEvento(EVENTO_ENCENDIDO_MANUAL, 1);
+#ifndef ARDUINO
+    hostAvanzarMicros(2500000ULL);
+#endif
+    registrarEvento(EVENTO_MOVIMIENTO_ENCENDIDA, 1);
+
+    SegmentoBitacora segmento = segmentoMasNuevo();
+    TEST_ASSERT_EQUAL_UINT32(3, segmento.cabecera->arranque);
+    TEST_ASSERT_EQUAL(2, segmento.cabecera->cantidad);
+    TEST_ASSERT_EQUAL(EVENTO_ENCENDIDO_MANUAL, segmento.registros[0].tipo);
+    TEST_ASSERT_EQUAL(1, segmento.registros[0].zona);
+    TEST_ASSERT_EQUAL(0, segmento.registros[0].deltaDecimas);
+#ifndef ARDUINO
+    TEST_ASSERT_EQUAL_UINT32(10, segmento.cabecera->inicioDecimas);
+    TEST_ASSERT_EQUAL(25, segmento.registros[1].deltaDecimas);
+#endif
+    TEST_ASSERT_TRUE(segmentoValido(*segmento.cabecera, segmento.registros));
+
+    Serial.println("✅ Registros de 4 bytes con delta de tiempo: EXITOSO");
+}
+
+void test_pausa_larga_usa_salto() {
+    int antes = segmentoMasNuevo().cabecera->cantidad;
+#ifndef ARDUINO
+    hostAvanzarMicros(70000ULL * 100000ULL); // 7000 s: un salto de 6553,5 s más el resto
+#endif
+    registrarEvento(EVENTO_APAGADO_TIMEOUT, 0);
+
+    SegmentoBitacora segmento = segmentoMasNuevo();
+#ifndef ARDUINO
+    TEST_ASSERT_EQUAL(antes + 2, segmento.cabecera->cantidad);
+    TEST_ASSERT_EQUAL(EVENTO_SALTO, segmento.registros[antes].tipo);
+    TEST_ASSERT_EQUAL(DELTA_MAXIMO_BITACORA, segmento.registros[antes].deltaDecimas);
+    TEST_ASSERT_EQUAL(70000 - DELTA_MAXIMO_BITACORA, segmento.registros[antes + 1].deltaDecimas);
+#else
+    (void)antes;
+#endif
+    TEST_ASSERT_EQUAL(EVENTO_APAGADO_TIMEOUT, segmento.registros[segmento.cabecera->cantidad - 1].tipo);
+
+    Serial.println("✅ Pausa larga codificada con registro de salto: EXITOSO");
+}
+
+void test_segmento_lleno_abre_otro() {
+    uint32_t secuencia = segmentoMasNuevo().cabecera->secuencia;
+    for (int i = 0; i < REGISTROS_POR_SEGMENTO; i++) {
+        registrarEvento(EVENTO_MOVIMIENTO_APAGADA, i % 2);
+    }
+
+    SegmentoBitacora segmentos[2];
+    TEST_ASSERT_EQUAL(2, segmentosRamEnRango(0, 0, UINT32_MAX, segmentos, 2));
+    TEST_ASSERT_EQUAL_UINT32(secuencia, segmentos[0].cabecera->secuencia);
+    TEST_ASSERT_EQUAL(REGISTROS_POR_SEGMENTO, segmentos[0].cabecera->cantidad);
+    TEST_ASSERT_EQUAL_UINT32(secuencia + 1, segmentos[1].cabecera->secuencia);
+    TEST_ASSERT_TRUE(segmentoValido(*segmentos[0].cabecera, segmentos[0].registros));
+
+    // Un bit cambiado invalida el segmento
+    RegistroEvento copia[REGISTROS_POR_SEGMENTO];
+    memcpy(copia, segmentos[0].registros, sizeof(copia));
+    copia[5].zona ^= 1;
+    TEST_ASSERT_FALSE(segmentoValido(*segmentos[0].cabecera, copia));
+
+    Serial.println("✅ Segmento lleno y CRC: EXITOSO");
+}
+
+void test_consulta_por_rango() {
+    SegmentoBitacora segmentos[2];
+    TEST_ASSERT_EQUAL(0, segmentosRamEnRango(99, 0, UINT32_MAX, segmentos, 2));
+#ifndef ARDUINO
+    // El primer segmento va de 1 s a 7003,5 s; el segundo empieza en 7003,5 s
+    TEST_ASSERT_EQUAL(1, segmentosRamEnRango(3, 0, 20, segmentos, 2));
+    TEST_ASSERT_EQUAL(2, segmentosRamEnRango(3, 70035, 70035, segmentos, 2));
+    TEST_ASSERT_EQUAL(0, segmentosRamEnRango(3, 80000, UINT32_MAX, segmentos, 2));
+#endif
+    TEST_ASSERT_TRUE(eventosRegistrados() >= (uint32_t)REGISTROS_POR_SEGMENTO + 3);
+
+    Serial.println("✅ Consulta de segmentos por rango de tiempo: EXITOSO");
+}
+
+void process() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_registros_de_cuatro_bytes_con_delta);
+    RUN_TEST(test_pausa_larga_usa_salto);
+    RUN_TEST(test_segmento_lleno_abre_otro);
+    RUN_TEST(test_consulta_por_rango);
+
+    UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000);
+    Serial.begin(115200);
+    Serial.println("Iniciando tests de la bitácora de eventos...");
+    process();
+}
+
+void loop() {
+    // Tests terminados
+}
+#else
+int main() {
+    process();
+    return 0;
+}
+#endif
@@ -0,0 +1,127 @@
+#include <unity.h>
+#include <Arduino.h>
+#include <new>
+#include "../../src/cadena_fija.h"
+#include "../../src/zones.h"
+#include "../../src/time_utils.h"
+
+#ifndef ARDUINO
+// En el host se cuentan todas las reservas de memoria para verificar que
+// actualizar el estado de larga vida no toca el heap
+static unsigned long reservasHeap = 0;
+
+void *operator new(size_t tamano) {
+    reservasHeap++;
+    void *memoria = malloc(tamano ? tamano : 1);
+    if (!memoria) {
+        throw std::bad_alloc();
+    }
+    return memoria;
+}
+
+void operator delete(void *memoria) noexcept {
+    free(memoria);
+}
+
+void operator delete(void *memoria, size_t) noexcept {
+    free(memoria);
+}
+#endif
+
+void setUp() {
+    horariosLaborales[0] = {8 * 60, 12 * 60};
+    horariosLaborales[1] = {14 * 60, 18 * 60 + 10};
+}
+
+void tearDown() {
+}
+
+void test_cadena_fija_asigna_y_trunca() {
+    CadenaFija<8> cadena;
+    TEST_ASSERT_EQUAL_STRING("", cadena.c_str());
+
+    TEST_ASSERT_TRUE(cadena.asignar("Zona 1"));
+    TEST_ASSERT_EQUAL_STRING("Zona 1", cadena.c_str());
+    TEST_ASSERT_EQUAL(6, cadena.length());
+    TEST_ASSERT_TRUE(cadena == "Zona 1");
+
+    // Más largo que la capacidad: se trunca y lo informa
+    TEST_ASSERT_FALSE(cadena.asignar("Sala de reuniones"));
+    TEST_ASSERT_EQUAL_STRING("Sala de ", cadena.c_str());
+    TEST_ASSERT_EQUAL(8, cadena.length());
+
+    Serial.println("✅ CadenaFija asigna y trunca: EXITOSO");
+}
+
+void test_nombre_zona_en_linea() {
+    TEST_ASSERT_EQUAL_STRING("Zona 1", zonas[0].nombre.c_str());
+    TEST_ASSERT_EQUAL_STRING("Zona 2", zonas[1].nombre.c_str());
+    TEST_ASSERT_TRUE(sizeof(Zona) > LARGO_MAXIMO_NOMBRE_ZONA);
+
+    Serial.println("✅ Nombre de zona en memoria estática: EXITOSO");
+}
+
+void test_parseo_horarios_en_borde() {
+    uint16_t minutos = 0;
+    TEST_ASSERT_TRUE(parsearHora("08:30", minutos));
+    TEST_ASSERT_EQUAL(8 * 60 + 30, minutos);
+    TEST_ASSERT_FALSE(parsearHora("24:00", minutos));
+    TEST_ASSERT_FALSE(parsearHora("12:60", minutos));
+    TEST_ASSERT_FALSE(parsearHora("abc", minutos));
+
+    char cadena[6];
+    formatearHora(18 * 60 + 10, cadena);
+    TEST_ASSERT_EQUAL_STRING("18:10", cadena);
+
+    Serial.println("✅ Parseo de horarios: EXITOSO");
+}
+
+void test_actualizaciones_sin_reservas_heap() {
+#ifndef ARDUINO
+    Serial.silenciado = true;
+    unsigned long reservasAntes = reservasHeap;
+
+    // Simula semanas de actualizaciones de horario y lecturas del lazo de control
+    for (int i = 0; i < 10000; i++) {
+        establecerHorario(i % CANTIDAD_HORARIOS, (uint16_t)(i % 600), (uint16_t)(600 + i % 600));
+        establecerHoraActual((i / 60) % 24, i % 60);
+        verificarSiEsHorarioLaboral();
+        zonas[i % CANTIDAD_ZONAS].nombre = (i % 2) ? "Pasillo" : "Oficina";
+    }
+
+    Serial.silenciado = false;
+    TEST_ASSERT_EQUAL_MESSAGE(reservasAntes, reservasHeap, "El estado persistente no debe reservar heap");
+    Serial.println("✅ Sin reservas de heap en 10000 actualizaciones: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("La medición de reservas se hace en la compilación de host (env:native)");
+#endif
+}
+
+void process() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_cadena_fija_asigna_y_trunca);
+    RUN_TEST(test_nombre_zona_en_linea);
+    RUN_TEST(test_parseo_horarios_en_borde);
+    RUN_TEST(test_actualizaciones_sin_reservas_heap);
+
+    UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000);
+    Serial.begin(115200);
+    Serial.println("Iniciando tests de cadenas fijas y horarios...");
+    process();
+}
+
+void loop() {
+    // Tests terminados
+}
+#else
+int main() {
+    process();
+    return 0;
+}
+#endif
@@ -0,0 +1,183 @@
+#include <unity.h>
+#include <Arduino.h>
+#include "../../src/persistencia.h"
+#include "../../src/time_utils.h"
+#include "../../src/calendario.h"
+
+static const uint64_t MINUTO_US = 60000000ULL;
+static const uint64_t DIA_US = 24 * 60 * MINUTO_US;
+
+// Pone el reloj local en una fecha y hora ("AAAA-MM-DD")
+static void fijarMomento(const char *fecha, int hora, int minuto) {
+    uint16_t dia = 0;
+    TEST_ASSERT_TRUE(parsearFecha(fecha, dia));
+    sincronizarRelojPreciso(dia * DIA_US + (uint64_t)(hora * 60 + minuto) * MINUTO_US);
+}
+
+static Horario franja(int desde, int hasta) {
+    Horario resultado = {(uint16_t)(desde * 60), (uint16_t)(hasta * 60)};
+    return resultado;
+}
+
+void setUp() {
+#ifndef ARDUINO
+    Serial.silenciado = true;
+#endif
+    iniciarPersistencia();
+    restaurarConfiguracionHoraria();
+
+    // Cada test parte de la definición inicial, sin excepciones ni zonas reasignadas
+    DefinicionCalendarios limpia = definicionCalendarios();
+    limpia.cantidadExcepciones = 0;
+    for (int c = 1; c < CANTIDAD_CALENDARIOS; c++) {
+        for (int d = 0; d < 7; d++) {
+            limpia.semana[c][d].cantidad = 0;
+        }
+    }
+    for (int z = 0; z < CANTIDAD_ZONAS; z++) {
+        limpia.calendarioZona[z] = 0;
+    }
+    publicarCalendarios(limpia);
+}
+
+void tearDown() {
+#ifndef ARDUINO
+    Serial.silenciado = false;
+#endif
+}
+
+void test_fechas_e_intervalos() {
+    uint16_t dia = 0;
+    TEST_ASSERT_TRUE(parsearFecha("1970-01-01", dia));
+    TEST_ASSERT_EQUAL_UINT16(0, dia);
+    TEST_ASSERT_TRUE(parsearFecha("2028-02-29", dia));
+    char texto[11];
+    formatearFecha(dia, texto);
+    TEST_ASSERT_EQUAL_STRING("2028-02-29", texto);
+
+    TEST_ASSERT_FALSE(parsearFecha("2026-02-29", dia));
+    TEST_ASSERT_FALSE(parsearFecha("2026-04-31", dia));
+    TEST_ASSERT_FALSE(parsearFecha("mañana", dia));
+
+    Horario intervalo;
+    TEST_ASSERT_TRUE(parsearIntervalo("18:00-24:00", intervalo));
+    TEST_ASSERT_EQUAL_UINT16(24 * 60, intervalo.fin);
+    TEST_ASSERT_FALSE(parsearIntervalo("12:00-08:00", intervalo));
+    TEST_ASSERT_FALSE(parsearIntervalo("24:00-24:30", intervalo));
+
+    Serial.println("✅ Fechas e intervalos del calendario: EXITOSO");
+}
+
+void test_semana_y_feriado() {
+#ifndef ARDUINO
+    // Lunes 19/10/2026: franjas por defecto 8-12 y 14-18:10
+    fijarMomento("2026-10-19", 10, 0);
+    TEST_ASSERT_TRUE(esMinutoLaboral(0));
+    fijarMomento("2026-10-19", 12, 30);
+    TEST_ASSERT_FALSE(esMinutoLaboral(0));
+    fijarMomento("2026-10-19", 18, 9);
+    TEST_ASSERT_TRUE(esMinutoLaboral(0));
+
+    // Sábado sin horario laboral
+    fijarMomento("2026-10-24", 10, 0);
+    TEST_ASSERT_FALSE(esMinutoLaboral(0));
+
+    // Feriado un viernes y jornada corta un martes, cargados fuera de orden
+    DefinicionCalendarios nueva = definicionCalendarios();
+    ExcepcionCalendario navidad = {};
+    TEST_ASSERT_TRUE(parsearFecha("2026-12-25", navidad.dia));
+    navidad.calendarios = 0x01;
+    ExcepcionCalendario jornadaCorta = {};
+    TEST_ASSERT_TRUE(parsearFecha("2026-12-08", jornadaCorta.dia));
+    jornadaCorta.calendarios = 0x01;
+    jornadaCorta.cantidad = 1;
+    jornadaCorta.intervalos[0] = franja(9, 11);
+    TEST_ASSERT_TRUE(agregarExcepcion(nueva, navidad));
+    TEST_ASSERT_TRUE(agregarExcepcion(nueva, jornadaCorta));
+    TEST_ASSERT_TRUE(publicarCalendarios(nueva));
+
+    fijarMomento("2026-12-25", 10, 0);
+    TEST_ASSERT_FALSE(esMinutoLaboral(0));
+    fijarMomento("2026-12-08", 10, 0);
+    TEST_ASSERT_TRUE(esMinutoLaboral(0));
+    fijarMomento("2026-12-08", 15, 0);
+    TEST_ASSERT_FALSE(esMinutoLaboral(0));
+    fijarMomento("2026-12-09", 15, 0);
+    TEST_ASSERT_TRUE(esMinutoLaboral(0));
+
+    // Borrar la excepción devuelve el viernes a su horario
+    nueva = definicionCalendarios();
+    TEST_ASSERT_EQUAL(1, borrarExcepciones(nueva, navidad.dia));
+    TEST_ASSERT_TRUE(publicarCalendarios(nueva));
+    fijarMomento("2026-12-25", 10, 0);
+    TEST_ASSERT_TRUE(esMinutoLaboral(0));
+
+    Serial.println("✅ Semana laboral y excepciones por fecha: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("Usa el reloj virtual de la compilación de host (env:native)");
+#endif
+}
+
+void test_zona_con_otro_calendario() {
+#ifndef ARDUINO
+    // La zona 1 abre los sábados de 9 a 13 con el calendario 2
+    DefinicionCalendarios nueva = definicionCalendarios();
+    nueva.semana[2][5].cantidad = 1;
+    nueva.semana[2][5].intervalos[0] = franja(9, 13);
+    nueva.calendarioZona[1] = 2;
+    TEST_ASSERT_TRUE(publicarCalendarios(nueva));
+
+    uint32_t entran = 0, salen = 0;
+    fijarMomento("2026-10-24", 8, 59);
+    estaEnHorarioLaboral = esMinutoLaboral(0);
+    actualizarModosCalendario(entran, salen);
+    TEST_ASSERT_FALSE(zonaEnHorarioLaboral(1));
+
+    fijarMomento("2026-10-24", 9, 0);
+    estaEnHorarioLaboral = esMinutoLaboral(0);
+    TEST_ASSERT_TRUE(actualizarModosCalendario(entran, salen));
+    TEST_ASSERT_EQUAL_UINT32(1UL << 1, entran);
+    TEST_ASSERT_EQUAL_UINT32(0, salen);
+    TEST_ASSERT_TRUE(zonaEnHorarioLaboral(1));
+    TEST_ASSERT_FALSE(zonaEnHorarioLaboral(0));
+
+    fijarMomento("2026-10-24", 13, 0);
+    estaEnHorarioLaboral = esMinutoLaboral(0);
+    TEST_ASSERT_TRUE(actualizarModosCalendario(entran, salen));
+    TEST_ASSERT_EQUAL_UINT32(0, entran);
+    TEST_ASSERT_EQUAL_UINT32(1UL << 1, salen);
+    TEST_ASSERT_FALSE(zonaEnHorarioLaboral(1));
+
+    Serial.println("✅ Zona con calendario propio: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("Usa el reloj virtual de la compilación de host (env:native)");
+#endif
+}
+
+void process() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_fechas_e_intervalos);
+    RUN_TEST(test_semana_y_feriado);
+    RUN_TEST(test_zona_con_otro_calendario);
+
+    UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000);
+    Serial.begin(115200);
+    Serial.println("Iniciando tests de calendarios...");
+    process();
+}
+
+void loop() {
+    // Tests terminados
+}
+#else
+int main() {
+    process();
+    return 0;
+}
+#endif
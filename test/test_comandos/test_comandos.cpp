@@ -0,0 +1,140 @@
+#include <unity.h>
+#include <Arduino.h>
+#include "../../src/comandos.h"
+#include "../../src/zones.h"
+#include "../../src/metricas.h"
+#include "../../src/trazas.h"
+
+static uint32_t contador(Contador cual) {
+    return contadores[cual].load();
+}
+
+void setUp() {
+#ifndef ARDUINO
+    Serial.silenciado = true;
+#endif
+    aplicarComandosPendientes();
+    configurarEstadoZona(0, false);
+    configurarEstadoZona(1, false);
+}
+
+void tearDown() {
+#ifndef ARDUINO
+    Serial.silenciado = false;
+#endif
+}
+
+void test_ordenes_coalescidas_y_una_escritura_por_zona() {
+    CambioZona encender = {0, true};
+    CambioZona apagar = {0, false};
+    CambioZona lote[] = {{1, true}, {1, false}};
+    uint32_t coalescidos = contador(CONTADOR_COMANDOS_COALESCIDOS);
+
+    // Encender, apagar, encender la zona 0 desde distintos handlers
+    TEST_ASSERT_TRUE(encolarCambiosZonas(&encender, 1, 0));
+    TEST_ASSERT_TRUE(encolarCambiosZonas(&apagar, 1, 0));
+    TEST_ASSERT_TRUE(encolarCambiosZonas(lote, 2, 0));
+    TEST_ASSERT_TRUE(encolarCambiosZonas(&encender, 1, 0));
+    TEST_ASSERT_EQUAL(5, profundidadColaComandos());
+
+    // Encolar no toca los relays
+    TEST_ASSERT_FALSE(zonas[0].estaActivo);
+#ifndef ARDUINO
+    uint32_t escrituras0 = hostEscriturasPin(zonas[0].pinesRelay[0]);
+    uint32_t escrituras1 = hostEscriturasPin(zonas[1].pinesRelay[0]);
+#endif
+
+    TEST_ASSERT_EQUAL(5, aplicarComandosPendientes());
+    TEST_ASSERT_EQUAL(0, profundidadColaComandos());
+    TEST_ASSERT_TRUE(zonas[0].estaActivo);
+    TEST_ASSERT_FALSE(zonas[1].estaActivo);
+    TEST_ASSERT_EQUAL_UINT32(coalescidos + 3, contador(CONTADOR_COMANDOS_COALESCIDOS));
+#ifndef ARDUINO
+    TEST_ASSERT_EQUAL_UINT32(escrituras0 + 1, hostEscriturasPin(zonas[0].pinesRelay[0]));
+    TEST_ASSERT_EQUAL_UINT32(escrituras1 + 1, hostEscriturasPin(zonas[1].pinesRelay[0]));
+#endif
+
+    // Sin órdenes pendientes no se despacha nada
+    TEST_ASSERT_EQUAL(0, aplicarComandosPendientes());
+    Serial.println("✅ Órdenes coalescidas con una escritura por zona: EXITOSO");
+}
+
+void test_cola_llena_rechaza_el_lote_entero() {
+    CambioZona cambio = {1, true};
+    CambioZona invalido = {CANTIDAD_ZONAS, true};
+    TEST_ASSERT_FALSE(encolarCambiosZonas(&invalido, 1, 0));
+
+    for (int i = 0; i < CAPACIDAD_COLA_COMANDOS - 1; i++) {
+        TEST_ASSERT_TRUE(encolarCambiosZonas(&cambio, 1, 0));
+    }
+
+    // Un lote de dos no entra en la única ranura libre y no deja nada a medias
+    uint32_t descartados = contador(CONTADOR_COMANDOS_DESCARTADOS);
+    CambioZona lote[] = {{0, true}, {0, false}};
+    TEST_ASSERT_FALSE(encolarCambiosZonas(lote, 2, 0));
+    TEST_ASSERT_EQUAL_UINT32(descartados + 1, contador(CONTADOR_COMANDOS_DESCARTADOS));
+    TEST_ASSERT_EQUAL(CAPACIDAD_COLA_COMANDOS - 1, profundidadColaComandos());
+    TEST_ASSERT_TRUE(encolarCambiosZonas(&cambio, 1, 0));
+    TEST_ASSERT_TRUE(medidores[MEDIDOR_COLA_COMANDOS_MAXIMA].load() >= CAPACIDAD_COLA_COMANDOS);
+
+    TEST_ASSERT_EQUAL(CAPACIDAD_COLA_COMANDOS, aplicarComandosPendientes());
+    TEST_ASSERT_TRUE(zonas[1].estaActivo);
+    TEST_ASSERT_FALSE(zonas[0].estaActivo);
+
+    // Después de dar la vuelta al anillo el lote entra
+    TEST_ASSERT_TRUE(encolarCambiosZonas(lote, 2, 0));
+    TEST_ASSERT_EQUAL(2, aplicarComandosPendientes());
+    TEST_ASSERT_FALSE(zonas[0].estaActivo);
+    Serial.println("✅ Cola llena rechaza el lote entero: EXITOSO");
+}
+
+void test_traza_se_sella_al_aplicar() {
+    CambioZona cambio = {0, true};
+    uint32_t id = iniciarTraza(ORIGEN_WEBSOCKET, 0);
+    TEST_ASSERT_TRUE(encolarCambiosZonas(&cambio, 1, id));
+    terminarRecepcionTraza();
+
+    Traza traza = {};
+    obtenerTrazasRecientes(&traza, 1);
+    TEST_ASSERT_EQUAL_UINT32(id, traza.id);
+    TEST_ASSERT_EQUAL_UINT32(0, traza.aplicado);
+
+#ifndef ARDUINO
+    hostAvanzarMicros(3000);
+#endif
+    aplicarComandosPendientes();
+    obtenerTrazasRecientes(&traza, 1);
+    TEST_ASSERT_NOT_EQUAL(0, traza.aplicado);
+#ifndef ARDUINO
+    TEST_ASSERT_UINT32_WITHIN(1, 3000, traza.aplicado - traza.recibido);
+#endif
+    Serial.println("✅ Traza sellada al aplicar la cola: EXITOSO");
+}
+
+void process() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_ordenes_coalescidas_y_una_escritura_por_zona);
+    RUN_TEST(test_cola_llena_rechaza_el_lote_entero);
+    RUN_TEST(test_traza_se_sella_al_aplicar);
+
+    UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000);
+    Serial.begin(115200);
+    Serial.println("Iniciando tests de la cola de comandos...");
+    process();
+}
+
+void loop() {
+    // Tests terminados
+}
+#else
+int main() {
+    process();
+    return 0;
+}
+#endif
@@ -0,0 +1,111 @@
+#include <unity.h>
+#include <Arduino.h>
+#include "../../src/configuracion.h"
+#include "../../src/persistencia.h"
+#include "../../src/zones.h"
+#include "../../src/time_utils.h"
+
+static int lector = -1;
+
+void setUp() {
+#ifndef ARDUINO
+    Serial.silenciado = true;
+#endif
+    iniciarPersistencia();
+    restaurarConfiguracionHoraria();
+    restaurarPoliticasZonas();
+    marcarLectorQuiescente(lector);
+    atenderConfiguracion();
+}
+
+void tearDown() {
+#ifndef ARDUINO
+    Serial.silenciado = false;
+#endif
+}
+
+void test_lector_conserva_su_instantanea() {
+    lector = registrarLectorConfiguracion();
+    TEST_ASSERT_TRUE(lector >= 0);
+
+    const Configuracion &vista = configuracionActual();
+    uint32_t version = vista.version;
+    uint16_t inicio = vista.horarios[0].inicio;
+
+    // Cada publicación activa un búfer libre; el que se lee queda retenido
+    TEST_ASSERT_TRUE(establecerTimeoutZona(0, 120));
+    establecerHorario(0, inicio + 30, vista.horarios[0].fin);
+    TEST_ASSERT_EQUAL_UINT32(version, vista.version);
+    TEST_ASSERT_EQUAL(inicio, vista.horarios[0].inicio);
+    TEST_ASSERT_EQUAL(inicio + 30, configuracionActual().horarios[0].inicio);
+    TEST_ASSERT_EQUAL_UINT32(120000UL, configuracionActual().tiempoMaximoEncendidoMs[0]);
+
+    // Sin búferes libres la publicación espera al período de gracia
+    uint32_t diferidas = estadisticasConfiguracion().diferidas;
+    uint32_t publicada = configuracionActual().version;
+    establecerHorario(0, inicio, vista.horarios[0].fin);
+    TEST_ASSERT_TRUE(estadisticasConfiguracion().pendiente);
+    TEST_ASSERT_EQUAL_UINT32(diferidas + 1, estadisticasConfiguracion().diferidas);
+    TEST_ASSERT_EQUAL_UINT32(publicada, configuracionActual().version);
+
+    marcarLectorQuiescente(lector);
+    atenderConfiguracion();
+    TEST_ASSERT_FALSE(estadisticasConfiguracion().pendiente);
+    TEST_ASSERT_EQUAL(inicio, configuracionActual().horarios[0].inicio);
+
+    TEST_ASSERT_TRUE(establecerTimeoutZona(0, TIEMPO_MAXIMO_ENCENDIDO / 1000));
+    Serial.println("✅ Instantánea estable hasta el punto de quiescencia: EXITOSO");
+}
+
+void test_timeout_por_zona() {
+#ifndef ARDUINO
+    TEST_ASSERT_FALSE(establecerTimeoutZona(1, TIMEOUT_MINIMO_S - 1));
+    TEST_ASSERT_TRUE(establecerTimeoutZona(1, 60));
+    forzarEscrituraPersistencia();
+    restaurarPoliticasZonas();
+    TEST_ASSERT_EQUAL_UINT32(60000UL, configuracionActual().tiempoMaximoEncendidoMs[1]);
+
+    // Fuera de horario la zona 1 se apaga al minuto y la 0 sigue con el valor por defecto
+    estaEnHorarioLaboral = false;
+    controlarZonaManualmente(0, true);
+    controlarZonaManualmente(1, true);
+    hostAvanzarMicros(61000000ULL);
+    marcarLectorQuiescente(lector);
+    controlarApagadoAutomatico();
+    TEST_ASSERT_TRUE(zonas[0].estaActivo);
+    TEST_ASSERT_FALSE(zonas[1].estaActivo);
+
+    controlarZonaManualmente(0, false);
+    TEST_ASSERT_TRUE(establecerTimeoutZona(1, TIEMPO_MAXIMO_ENCENDIDO / 1000));
+    Serial.println("✅ Timeout de apagado por zona: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("Usa el reloj virtual de la compilación de host (env:native)");
+#endif
+}
+
+void process() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_lector_conserva_su_instantanea);
+    RUN_TEST(test_timeout_por_zona);
+
+    UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000);
+    Serial.begin(115200);
+    Serial.println("Iniciando tests de configuración...");
+    process();
+}
+
+void loop() {
+    // Tests terminados
+}
+#else
+int main() {
+    process();
+    return 0;
+}
+#endif
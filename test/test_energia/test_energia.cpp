@@ -0,0 +1,147 @@
+#include <unity.h>
+#include <Arduino.h>
+#include "../../src/energia.h"
+#include "../../src/zones.h"
+#include "../../src/time_utils.h"
+#include "../../src/persistencia.h"
+
+static const unsigned long MINUTO_US = 60UL * 1000000UL;
+static const uint64_t MJ_POR_WH = 3600000ULL;
+
+void setUp() {
+#ifndef ARDUINO
+    Serial.silenciado = true;
+#endif
+    iniciarEnergia();
+    estaEnHorarioLaboral = false;
+}
+
+void tearDown() {
+#ifndef ARDUINO
+    Serial.silenciado = false;
+#endif
+}
+
+void test_consumo_en_milijulios() {
+#ifndef ARDUINO
+    TEST_ASSERT_TRUE(establecerPotenciaZona(0, 60));
+    uint64_t consumoAntes = energiaZona(0).consumoMj;
+    uint64_t tiempoAntes = energiaZona(0).milisegundosEncendida;
+
+    controlarZonaManualmente(0, true);
+    hostAvanzarMicros(10 * MINUTO_US);
+    controlarZonaManualmente(0, false);
+    hostAvanzarMicros(10 * MINUTO_US);
+
+    // 60 W durante 10 minutos = 10 Wh exactos
+    TEST_ASSERT_TRUE(energiaZona(0).consumoMj - consumoAntes == 10 * MJ_POR_WH);
+    TEST_ASSERT_TRUE(energiaZona(0).milisegundosEncendida - tiempoAntes == 10 * 60000ULL);
+
+    // Cambiar la potencia no reescribe lo ya acumulado
+    controlarZonaManualmente(0, true);
+    hostAvanzarMicros(6 * MINUTO_US);
+    establecerPotenciaZona(0, 120);
+    hostAvanzarMicros(6 * MINUTO_US);
+    controlarZonaManualmente(0, false);
+    TEST_ASSERT_TRUE(energiaZona(0).consumoMj - consumoAntes == (10 + 6 + 12) * MJ_POR_WH);
+    TEST_ASSERT_FALSE(establecerPotenciaZona(0, 0));
+
+    Serial.println("✅ Consumo acumulado en milijulios: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("Usa el reloj virtual de la compilación de host (env:native)");
+#endif
+}
+
+void test_ahorro_por_timeout_hasta_horario_laboral() {
+#ifndef ARDUINO
+    establecerPotenciaZona(1, 100);
+    controlarZonaManualmente(1, true);
+    hostAvanzarMicros(TIEMPO_MAXIMO_ENCENDIDO * 1000UL + 1000000UL);
+    controlarApagadoAutomatico();
+    TEST_ASSERT_FALSE(zonas[1].estaActivo);
+
+    uint64_t ahorroAntes = energiaZona(1).ahorroTimeoutMj;
+    hostAvanzarMicros(36 * MINUTO_US);
+    TEST_ASSERT_TRUE(energiaZona(1).ahorroTimeoutMj - ahorroAntes == 60 * MJ_POR_WH);
+
+    // En horario laboral la zona habría quedado en manos del personal
+    cambioModoEnergia(true);
+    uint64_t ahorroAlCambiarModo = energiaZona(1).ahorroTimeoutMj;
+    hostAvanzarMicros(60 * MINUTO_US);
+    TEST_ASSERT_TRUE(energiaZona(1).ahorroTimeoutMj == ahorroAlCambiarModo);
+    cambioModoEnergia(false);
+
+    Serial.println("✅ Ahorro atribuido al apagado por timeout: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("Usa el reloj virtual de la compilación de host (env:native)");
+#endif
+}
+
+void test_ahorro_por_pir_que_no_enciende() {
+#ifndef ARDUINO
+    establecerPotenciaZona(0, 60);
+    TEST_ASSERT_FALSE(zonas[0].estaActivo);
+    uint64_t ahorroAntes = energiaZona(0).ahorroPirMj;
+
+    // Un movimiento con la zona apagada equivale a TIEMPO_MAXIMO_ENCENDIDO a 60 W
+    movimientoEnergia(0);
+    hostAvanzarMicros(20 * MINUTO_US);
+    uint64_t esperado = 60ULL * TIEMPO_MAXIMO_ENCENDIDO;
+    TEST_ASSERT_TRUE(energiaZona(0).ahorroPirMj - ahorroAntes == esperado);
+
+    // Un segundo movimiento a mitad del encendido virtual lo extiende, sin contar doble
+    movimientoEnergia(0);
+    hostAvanzarMicros(TIEMPO_MAXIMO_ENCENDIDO * 500UL);
+    movimientoEnergia(0);
+    hostAvanzarMicros(20 * MINUTO_US);
+    esperado += 60ULL * (TIEMPO_MAXIMO_ENCENDIDO / 2 + TIEMPO_MAXIMO_ENCENDIDO);
+    TEST_ASSERT_TRUE(energiaZona(0).ahorroPirMj - ahorroAntes == esperado);
+
+    Serial.println("✅ Ahorro atribuido a que el PIR no enciende: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("Usa el reloj virtual de la compilación de host (env:native)");
+#endif
+}
+
+void test_bloque_guardado_se_restaura() {
+    TEST_ASSERT_TRUE(establecerPotenciaZona(1, 75));
+    uint64_t consumoGuardado = energiaZona(1).consumoMj;
+    forzarEscrituraPersistencia();
+
+    // Lo que cambia después de la escritura no llega a NVS
+    TEST_ASSERT_TRUE(establecerPotenciaZona(1, 90));
+    iniciarEnergia();
+    TEST_ASSERT_EQUAL_UINT16(75, energiaZona(1).potenciaW);
+    TEST_ASSERT_TRUE(energiaZona(1).consumoMj == consumoGuardado);
+
+    Serial.println("✅ Cuentas restauradas del bloque versionado: EXITOSO");
+}
+
+void process() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_consumo_en_milijulios);
+    RUN_TEST(test_ahorro_por_timeout_hasta_horario_laboral);
+    RUN_TEST(test_ahorro_por_pir_que_no_enciende);
+    RUN_TEST(test_bloque_guardado_se_restaura);
+
+    UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000);
+    Serial.begin(115200);
+    Serial.println("Iniciando tests de contabilidad de energía...");
+    process();
+}
+
+void loop() {
+    // Tests terminados
+}
+#else
+int main() {
+    process();
+    return 0;
+}
+#endif
@@ -0,0 +1,126 @@
+#include <unity.h>
+#include <Arduino.h>
+#include "../../src/estadisticas.h"
+#include "../../src/zones.h"
+#include "../../src/time_utils.h"
+
+static const unsigned long MINUTO_US = 60UL * 1000000UL;
+
+void setUp() {
+#ifndef ARDUINO
+    Serial.silenciado = true;
+#endif
+}
+
+void tearDown() {
+#ifndef ARDUINO
+    Serial.silenciado = false;
+#endif
+}
+
+void test_tiempo_encendida_por_hora_de_semana() {
+#ifndef ARDUINO
+    establecerDiaSemana(2); // miércoles
+    establecerHoraActual(10, 0);
+    actualizarEstadisticas();
+    int cubeta = cubetaHoraSemana();
+    uint32_t antes = estadisticasZona(0).milisegundosEncendida[cubeta];
+    uint32_t encendidos = estadisticasZona(0).encendidos;
+
+    controlarZonaManualmente(0, true);
+    hostAvanzarMicros(30 * MINUTO_US);
+    establecerHoraActual(11, 0);
+    actualizarEstadisticas();
+    hostAvanzarMicros(15 * MINUTO_US);
+
+    // Consultar no acumula: el tiempo de la hora en curso lo suma el tick
+    TEST_ASSERT_EQUAL_UINT32(0, estadisticasZona(0).milisegundosEncendida[cubeta + 1]);
+    actualizarEstadisticas();
+    const EstadisticasZona &estadisticas = estadisticasZona(0);
+    TEST_ASSERT_EQUAL_UINT32(antes + 30 * 60000UL, estadisticas.milisegundosEncendida[cubeta]);
+    TEST_ASSERT_EQUAL_UINT32(15 * 60000UL, estadisticas.milisegundosEncendida[cubeta + 1]);
+    TEST_ASSERT_EQUAL_UINT32(encendidos + 1, estadisticas.encendidos);
+
+    // Apagada ya no suma
+    controlarZonaManualmente(0, false);
+    hostAvanzarMicros(10 * MINUTO_US);
+    actualizarEstadisticas();
+    TEST_ASSERT_EQUAL_UINT32(15 * 60000UL, estadisticasZona(0).milisegundosEncendida[cubeta + 1]);
+
+    Serial.println("✅ Tiempo encendida por hora de la semana: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("Usa el reloj virtual de la compilación de host (env:native)");
+#endif
+}
+
+void test_movimientos_y_media_hasta_timeout() {
+#ifndef ARDUINO
+    establecerDiaSemana(5);
+    establecerHoraActual(22, 0);
+    estaEnHorarioLaboral = false;
+    actualizarEstadisticas();
+    int cubeta = cubetaHoraSemana();
+
+    controlarZonaManualmente(1, true);
+    movimientoEstadisticas(1);
+    movimientoEstadisticas(1);
+    TEST_ASSERT_EQUAL_UINT32(2, estadisticasZona(1).movimientos[cubeta]);
+
+    uint32_t apagados = estadisticasZona(1).apagadosTimeout;
+    hostAvanzarMicros(TIEMPO_MAXIMO_ENCENDIDO * 1000UL + 1000000UL);
+    controlarApagadoAutomatico();
+    TEST_ASSERT_FALSE(zonas[1].estaActivo);
+
+    const EstadisticasZona &estadisticas = estadisticasZona(1);
+    TEST_ASSERT_EQUAL_UINT32(apagados + 1, estadisticas.apagadosTimeout);
+    TEST_ASSERT_EQUAL_UINT32(TIEMPO_MAXIMO_ENCENDIDO / 1000 + 1, estadisticas.segundosHastaTimeout / estadisticas.apagadosTimeout);
+
+    Serial.println("✅ Movimientos y tiempo medio hasta timeout: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("Usa el reloj virtual de la compilación de host (env:native)");
+#endif
+}
+
+void test_reloj_avanza_dia_de_semana() {
+#ifndef ARDUINO
+    establecerDiaSemana(6); // domingo
+    establecerHoraActual(23, 59, 59);
+    hostAvanzarMicros(2000000UL);
+    TEST_ASSERT_EQUAL(0, diaSemanaActual());
+    TEST_ASSERT_EQUAL(0, horaActual());
+    TEST_ASSERT_EQUAL(0, cubetaHoraSemana());
+#endif
+    TEST_ASSERT_FALSE(establecerDiaSemana(7));
+    TEST_ASSERT_TRUE(establecerDiaSemana(3));
+    TEST_ASSERT_EQUAL(3, diaSemanaActual());
+
+    Serial.println("✅ Día de la semana en el reloj interno: EXITOSO");
+}
+
+void process() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_tiempo_encendida_por_hora_de_semana);
+    RUN_TEST(test_movimientos_y_media_hasta_timeout);
+    RUN_TEST(test_reloj_avanza_dia_de_semana);
+
+    UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000);
+    Serial.begin(115200);
+    Serial.println("Iniciando tests de estadísticas por zona...");
+    process();
+}
+
+void loop() {
+    // Tests terminados
+}
+#else
+int main() {
+    process();
+    return 0;
+}
+#endif
@@ -0,0 +1,145 @@
+#include <unity.h>
+#include <Arduino.h>
+#include "../../src/maquina_zona.h"
+#include "../../src/zones.h"
+#include "../../src/interrupts.h"
+#include "../../src/time_utils.h"
+
+static const uint64_t SEGUNDO_US = 1000000ULL;
+
+void setUp() {
+#ifndef ARDUINO
+    Serial.silenciado = true;
+    hostFijarPin(zonas[0].pinPir, LOW);
+#endif
+    estaEnHorarioLaboral = false;
+    configurarEstadoZona(0, false);
+    configurarEstadoZona(1, false);
+}
+
+void tearDown() {
+#ifndef ARDUINO
+    Serial.silenciado = false;
+#endif
+}
+
+void test_tabla_de_transiciones() {
+    // El PIR nunca enciende una zona apagada
+    TransicionZona transicion = transicionZona(ESTADO_APAGADA, SUCESO_MOVIMIENTO);
+    TEST_ASSERT_EQUAL(ESTADO_APAGADA, transicion.siguiente);
+    TEST_ASSERT_EQUAL(ACCION_MOVIMIENTO, transicion.acciones);
+
+    // Un movimiento en el último tramo vuelve a empezar el timeout
+    transicion = transicionZona(ESTADO_POR_EXPIRAR, SUCESO_MOVIMIENTO);
+    TEST_ASSERT_EQUAL(ESTADO_ENCENDIDA_FUERA_HORARIO, transicion.siguiente);
+    TEST_ASSERT_TRUE(transicion.acciones & ACCION_REINICIAR_TIMER);
+
+    // En horario laboral el timeout no apaga
+    transicion = transicionZona(ESTADO_ENCENDIDA_LABORAL, SUCESO_TIMEOUT);
+    TEST_ASSERT_EQUAL(ESTADO_ENCENDIDA_LABORAL, transicion.siguiente);
+    TEST_ASSERT_EQUAL(0, transicion.acciones);
+
+    // Al salir del horario laboral el timeout cuenta desde el cambio
+    transicion = transicionZona(ESTADO_ENCENDIDA_LABORAL, SUCESO_SALE_HORARIO);
+    TEST_ASSERT_EQUAL(ESTADO_ENCENDIDA_FUERA_HORARIO, transicion.siguiente);
+    TEST_ASSERT_EQUAL(ACCION_REINICIAR_TIMER, transicion.acciones);
+
+    TEST_ASSERT_EQUAL_STRING("por_expirar", nombreEstadoZona(ESTADO_POR_EXPIRAR));
+    Serial.println("✅ Tabla de transiciones de zona: EXITOSO");
+}
+
+void test_aviso_movimiento_y_timeout() {
+#ifndef ARDUINO
+    TEST_ASSERT_TRUE(controlarZonaManualmente(0, true));
+    TEST_ASSERT_EQUAL(ESTADO_ENCENDIDA_FUERA_HORARIO, zonas[0].estado);
+
+    // Antes del último tramo no hay nada que despachar
+    hostAvanzarMicros((TIEMPO_MAXIMO_ENCENDIDO - AVISO_EXPIRACION_MS - 1000) * 1000ULL);
+    controlarApagadoAutomatico();
+    TEST_ASSERT_EQUAL(ESTADO_ENCENDIDA_FUERA_HORARIO, zonas[0].estado);
+
+    hostAvanzarMicros(2 * SEGUNDO_US);
+    controlarApagadoAutomatico();
+    TEST_ASSERT_EQUAL(ESTADO_POR_EXPIRAR, zonas[0].estado);
+    TEST_ASSERT_TRUE(zonas[0].estaActivo);
+
+    // Un flanco del PIR la devuelve al estado normal con el timeout desde cero
+    hostAvanzarMicros(200000ULL);
+    hostFijarPin(zonas[0].pinPir, HIGH);
+    procesarInterrupcionesPIR();
+    hostFijarPin(zonas[0].pinPir, LOW);
+    TEST_ASSERT_EQUAL(ESTADO_ENCENDIDA_FUERA_HORARIO, zonas[0].estado);
+    TEST_ASSERT_EQUAL_UINT32(millis(), zonas[0].ultimoMovimiento);
+
+    hostAvanzarMicros((TIEMPO_MAXIMO_ENCENDIDO + 1000) * 1000ULL);
+    controlarApagadoAutomatico();
+    TEST_ASSERT_EQUAL(ESTADO_APAGADA, zonas[0].estado);
+    TEST_ASSERT_FALSE(zonas[0].estaActivo);
+    TEST_ASSERT_EQUAL(VALOR_RELAY_APAGADO, hostLeerPin(zonas[0].pinesRelay[0]));
+
+    Serial.println("✅ Aviso, movimiento y timeout por sucesos: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("Usa el reloj virtual de la compilación de host (env:native)");
+#endif
+}
+
+void test_la_zona_sigue_el_modo_de_su_calendario() {
+#ifndef ARDUINO
+    controlarZonaManualmente(1, true);
+
+    // El modo cambia sin que se haya encolado el suceso: la zona se pone al
+    // día antes del timeout y no se apaga
+    estaEnHorarioLaboral = true;
+    hostAvanzarMicros((TIEMPO_MAXIMO_ENCENDIDO + 1000) * 1000ULL);
+    controlarApagadoAutomatico();
+    TEST_ASSERT_EQUAL(ESTADO_ENCENDIDA_LABORAL, zonas[1].estado);
+    TEST_ASSERT_TRUE(zonas[1].estaActivo);
+
+    // Sin vencimientos pendientes los relays no se vuelven a escribir
+    uint32_t escrituras = hostEscriturasPin(zonas[1].pinesRelay[0]);
+    hostAvanzarMicros(10 * SEGUNDO_US);
+    controlarApagadoAutomatico();
+    TEST_ASSERT_EQUAL_UINT32(escrituras, hostEscriturasPin(zonas[1].pinesRelay[0]));
+
+    // Al salir del horario el timeout empieza desde el cambio de modo
+    estaEnHorarioLaboral = false;
+    encolarSucesoZona(1, SUCESO_SALE_HORARIO);
+    despacharSucesosZonas();
+    TEST_ASSERT_EQUAL(ESTADO_ENCENDIDA_FUERA_HORARIO, zonas[1].estado);
+    TEST_ASSERT_EQUAL_UINT32(millis(), zonas[1].ultimoMovimiento);
+
+    controlarZonaManualmente(1, false);
+    TEST_ASSERT_EQUAL(ESTADO_APAGADA, zonas[1].estado);
+    Serial.println("✅ Zona al día con el modo de su calendario: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("Usa el reloj virtual de la compilación de host (env:native)");
+#endif
+}
+
+void process() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_tabla_de_transiciones);
+    RUN_TEST(test_aviso_movimiento_y_timeout);
+    RUN_TEST(test_la_zona_sigue_el_modo_de_su_calendario);
+
+    UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000);
+    Serial.begin(115200);
+    Serial.println("Iniciando tests de la máquina de estados de zona...");
+    process();
+}
+
+void loop() {
+    // Tests terminados
+}
+#else
+int main() {
+    process();
+    return 0;
+}
+#endif
@@ -0,0 +1,224 @@
+#include <unity.h>
+#include <Arduino.h>
+#include "../../src/persistencia.h"
+#include "../../src/time_utils.h"
+#include "../../src/zones.h"
+
+void setUp() {
+#ifndef ARDUINO
+    Serial.silenciado = true;
+#endif
+    iniciarPersistencia();
+    restaurarConfiguracionHoraria();
+    restaurarEstadoZonas();
+    forzarEscrituraPersistencia();
+}
+
+void tearDown() {
+#ifndef ARDUINO
+    Serial.silenciado = false;
+#endif
+}
+
+void test_rafaga_se_agrupa_en_una_escritura() {
+#ifndef ARDUINO
+    uint32_t escriturasAntes = estadisticasPersistencia().escrituras;
+
+    // Diez cambios seguidos del mismo horario, como al arrastrar un control
+    for (int i = 0; i < 10; i++) {
+        establecerHorario(0, (uint16_t)(7 * 60 + i), 12 * 60);
+        hostAvanzarMicros(200000);
+        atenderPersistencia();
+    }
+    TEST_ASSERT_EQUAL_UINT32(escriturasAntes, estadisticasPersistencia().escrituras);
+
+    hostAvanzarMicros(ESPERA_SILENCIO_PERSISTENCIA_MS * 1000UL);
+    atenderPersistencia();
+    TEST_ASSERT_EQUAL_UINT32(escriturasAntes + 1, estadisticasPersistencia().escrituras);
+
+    Serial.println("✅ Ráfaga de cambios en una sola escritura: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("Usa el reloj virtual de la compilación de host (env:native)");
+#endif
+}
+
+void test_valor_igual_no_se_escribe() {
+    uint32_t escriturasAntes = estadisticasPersistencia().escrituras;
+    uint32_t omitidasAntes = estadisticasPersistencia().omitidas;
+
+    // Volver a poner el mismo horario marca la clave pero no gasta flash
+    establecerHorario(0, horariosLaborales[0].inicio, horariosLaborales[0].fin);
+    forzarEscrituraPersistencia();
+    TEST_ASSERT_EQUAL_UINT32(escriturasAntes, estadisticasPersistencia().escrituras);
+    TEST_ASSERT_EQUAL_UINT32(omitidasAntes + 1, estadisticasPersistencia().omitidas);
+
+    Serial.println("✅ Valor sin cambios no se reescribe: EXITOSO");
+}
+
+void test_cambios_continuos_respetan_espera_maxima() {
+#ifndef ARDUINO
+    uint32_t escriturasAntes = estadisticasPersistencia().escrituras;
+    unsigned long transcurrido = 0;
+    int i = 0;
+    while (estadisticasPersistencia().escrituras == escriturasAntes) {
+        establecerHorario(1, (uint16_t)(13 * 60 + (i++ % 30)), 18 * 60);
+        hostAvanzarMicros(500000);
+        transcurrido += 500;
+        atenderPersistencia();
+        TEST_ASSERT_TRUE(transcurrido <= ESPERA_MAXIMA_PERSISTENCIA_MS + 500);
+    }
+    TEST_ASSERT_TRUE(transcurrido >= ESPERA_MAXIMA_PERSISTENCIA_MS);
+
+    Serial.println("✅ Cambios continuos con espera máxima: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("Usa el reloj virtual de la compilación de host (env:native)");
+#endif
+}
+
+void test_restaura_horarios_y_zonas() {
+    establecerHorario(0, 9 * 60, 13 * 60);
+    establecerHoraActual(7, 40);
+    controlarZonaManualmente(1, true);
+    forzarEscrituraPersistencia();
+
+    // Simula el arranque siguiente: RAM con los valores de fábrica
+    horariosLaborales[0] = {8 * 60, 12 * 60};
+    establecerHoraActual(19, 0);
+    configurarEstadoZona(1, false);
+
+    restaurarConfiguracionHoraria();
+    restaurarEstadoZonas();
+    TEST_ASSERT_EQUAL(9 * 60, horariosLaborales[0].inicio);
+    TEST_ASSERT_EQUAL(13 * 60, horariosLaborales[0].fin);
+    TEST_ASSERT_EQUAL(7, horaActual());
+    TEST_ASSERT_EQUAL(40, minutoActual());
+    TEST_ASSERT_TRUE(zonas[1].estaActivo);
+
+    controlarZonaManualmente(1, false);
+    Serial.println("✅ Restauración de horarios, hora y zonas: EXITOSO");
+}
+
+void test_zona_restaurada_fuera_de_horario_vence() {
+#ifndef ARDUINO
+    establecerHoraActual(19, 0);
+    controlarZonaManualmente(0, true);
+    forzarEscrituraPersistencia();
+
+    // Arranque siguiente: zona apagada en RAM y el modo con su valor por defecto
+    configurarEstadoZona(0, false);
+    estaEnHorarioLaboral = true;
+
+    restaurarEstadoZonas();
+    TEST_ASSERT_FALSE(estaEnHorarioLaboral);
+    TEST_ASSERT_TRUE(zonas[0].estaActivo);
+    TEST_ASSERT_EQUAL(ESTADO_ENCENDIDA_FUERA_HORARIO, zonas[0].estado);
+
+    // Sin movimiento, el timeout la apaga como a cualquier zona fuera de horario
+    hostAvanzarMicros(60UL * 60 * 1000000UL);
+    controlarApagadoAutomatico();
+    TEST_ASSERT_FALSE(zonas[0].estaActivo);
+    TEST_ASSERT_EQUAL(ESTADO_APAGADA, zonas[0].estado);
+
+    Serial.println("✅ Zona restaurada fuera de horario con timeout: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("Usa el reloj virtual de la compilación de host (env:native)");
+#endif
+}
+
+void test_arranque_rapido_usa_copia_rtc() {
+#ifndef ARDUINO
+    // NVS con la zona apagada; se enciende y el equipo se reinicia antes de
+    // que la caché llegue a escribir
+    controlarZonaManualmente(0, false);
+    controlarZonaManualmente(1, false);
+    forzarEscrituraPersistencia();
+    controlarZonaManualmente(0, true);
+
+    zonas[0].estaActivo = false;
+    hostFijarPin(zonas[0].pinesRelay[0], VALOR_RELAY_APAGADO);
+    hostFijarPin(zonas[0].pinesRelay[1], VALOR_RELAY_APAGADO);
+
+    // Los relays vuelven antes de leer NVS
+    TEST_ASSERT_TRUE(restaurarRelaysArranqueRapido());
+    TEST_ASSERT_EQUAL(VALOR_RELAY_ENCENDIDO, hostLeerPin(zonas[0].pinesRelay[0]));
+    TEST_ASSERT_EQUAL(VALOR_RELAY_ENCENDIDO, hostLeerPin(zonas[0].pinesRelay[1]));
+    TEST_ASSERT_EQUAL(VALOR_RELAY_APAGADO, hostLeerPin(zonas[1].pinesRelay[0]));
+
+    // La copia RTC gana a la de NVS, que queda marcada para ponerse al día
+    uint32_t escriturasAntes = estadisticasPersistencia().escrituras;
+    restaurarEstadoZonas();
+    TEST_ASSERT_TRUE(zonas[0].estaActivo);
+    TEST_ASSERT_EQUAL_STRING("rtc", origenRestauracionZonas());
+    forzarEscrituraPersistencia();
+    TEST_ASSERT_EQUAL_UINT32(escriturasAntes + 1, estadisticasPersistencia().escrituras);
+
+    controlarZonaManualmente(0, false);
+    Serial.println("✅ Arranque rápido desde la copia RTC: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("Usa los pines simulados de la compilación de host (env:native)");
+#endif
+}
+
+void test_escritura_fallida_se_reintenta() {
+#ifndef ARDUINO
+    // El almacén de host rechaza bloques de más de 1 KB, como NVS sin espacio
+    static uint8_t bloqueGrande[2048];
+    restaurarClave(CLAVE_ADAPTACION, "grande", bloqueGrande, sizeof(bloqueGrande));
+    uint32_t escriturasAntes = estadisticasPersistencia().escrituras;
+    uint32_t fallidasAntes = estadisticasPersistencia().fallidas;
+
+    bloqueGrande[0]++;
+    marcarClaveModificada(CLAVE_ADAPTACION);
+    forzarEscrituraPersistencia();
+    TEST_ASSERT_EQUAL_UINT32(fallidasAntes + 1, estadisticasPersistencia().fallidas);
+
+    // La clave sigue pendiente: el próximo volcado vuelve a intentarla
+    hostAvanzarMicros(ESPERA_SILENCIO_PERSISTENCIA_MS * 1000UL);
+    while (atenderPersistencia()) {
+    }
+    TEST_ASSERT_EQUAL_UINT32(fallidasAntes + 2, estadisticasPersistencia().fallidas);
+    TEST_ASSERT_EQUAL_UINT32(escriturasAntes, estadisticasPersistencia().escrituras);
+
+    // Con un bloque que entra, el reintento llega a escribirse
+    restaurarClave(CLAVE_ADAPTACION, "grande", bloqueGrande, 16);
+    marcarClaveModificada(CLAVE_ADAPTACION);
+    forzarEscrituraPersistencia();
+    TEST_ASSERT_EQUAL_UINT32(escriturasAntes + 1, estadisticasPersistencia().escrituras);
+
+    Serial.println("✅ Escritura fallida queda pendiente: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("Usa el almacén en RAM de la compilación de host (env:native)");
+#endif
+}
+
+void process() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_rafaga_se_agrupa_en_una_escritura);
+    RUN_TEST(test_valor_igual_no_se_escribe);
+    RUN_TEST(test_cambios_continuos_respetan_espera_maxima);
+    RUN_TEST(test_restaura_horarios_y_zonas);
+    RUN_TEST(test_zona_restaurada_fuera_de_horario_vence);
+    RUN_TEST(test_arranque_rapido_usa_copia_rtc);
+    RUN_TEST(test_escritura_fallida_se_reintenta);
+
+    UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000);
+    Serial.begin(115200);
+    Serial.println("Iniciando tests de persistencia...");
+    process();
+}
+
+void loop() {
+    // Tests terminados
+}
+#else
+int main() {
+    process();
+    return 0;
+}
+#endif
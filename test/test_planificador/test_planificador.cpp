@@ -0,0 +1,178 @@
+#include <unity.h>
+#include <Arduino.h>
+#include "../../src/planificador.h"
+
+// Carga sintética: cada paso de red o de fondo consume tiempo virtual, y la
+// tarea de control anota la mayor separación entre dos de sus pasos
+static const uint32_t PASO_HTTP_US = 15000;       // Página principal servida de una vez
+static const uint32_t PASO_WEBSOCKET_US = 4000;   // Un frame por paso, ráfaga de 6
+static const uint32_t PASO_NVS_US = 8000;         // Una clave de flash por paso, 4 claves
+static const int FRAMES_POR_RAFAGA = 6;
+static const int CLAVES_POR_VOLCADO = 4;
+
+static bool cargaActiva = false;
+static bool hayPrimerControl = false;
+static uint32_t ultimoControl = 0;
+static uint32_t peorSeparacionControl = 0;
+
+static int pasosContador = 0;
+static int vueltasContador = 0;
+static bool contadorActivo = false;
+
+static ResultadoTarea tareaControl(ContextoTarea &) {
+    uint32_t ahora = micros();
+    if (hayPrimerControl && ahora - ultimoControl > peorSeparacionControl) {
+        peorSeparacionControl = ahora - ultimoControl;
+    }
+    ultimoControl = ahora;
+    hayPrimerControl = true;
+    return TAREA_TERMINADA;
+}
+
+static ResultadoTarea tareaHttp(ContextoTarea &) {
+    if (cargaActiva) {
+        hostAvanzarMicros(PASO_HTTP_US);
+    }
+    return TAREA_TERMINADA;
+}
+
+static int frameActual = 0;
+static ResultadoTarea tareaWebSocket(ContextoTarea &contexto) {
+    TAREA_INICIO(contexto);
+    for (frameActual = 0; cargaActiva && frameActual < FRAMES_POR_RAFAGA; frameActual++) {
+        hostAvanzarMicros(PASO_WEBSOCKET_US);
+        TAREA_CEDER(contexto);
+    }
+    TAREA_FIN(contexto);
+}
+
+static int claveActual = 0;
+static ResultadoTarea tareaNvs(ContextoTarea &contexto) {
+    TAREA_INICIO(contexto);
+    for (claveActual = 0; cargaActiva && claveActual < CLAVES_POR_VOLCADO; claveActual++) {
+        hostAvanzarMicros(PASO_NVS_US);
+        TAREA_CEDER(contexto);
+    }
+    TAREA_FIN(contexto);
+}
+
+// Cede tres veces sin consumir tiempo: termina dentro de la misma vuelta
+static ResultadoTarea tareaContador(ContextoTarea &contexto) {
+    TAREA_INICIO(contexto);
+    vueltasContador++;
+    for (pasosContador = 0; contadorActivo && pasosContador < 3;) {
+        pasosContador++;
+        TAREA_CEDER(contexto);
+    }
+    TAREA_FIN(contexto);
+}
+
+static void registrarTareas() {
+    static bool registradas = false;
+    if (!registradas) {
+        registrarTareaLoop("control", 0, PRIORIDAD_CONTROL, tareaControl);
+        registrarTareaLoop("http", 0, PRIORIDAD_RED, tareaHttp);
+        registrarTareaLoop("websocket", 0, PRIORIDAD_RED, tareaWebSocket);
+        registrarTareaLoop("nvs", 0, PRIORIDAD_FONDO, tareaNvs);
+        registrarTareaLoop("contador", 0, PRIORIDAD_FONDO, tareaContador);
+        registradas = true;
+    }
+}
+
+void setUp() {
+#ifndef ARDUINO
+    Serial.silenciado = true;
+#endif
+    registrarTareas();
+    cargaActiva = false;
+    contadorActivo = false;
+}
+
+void tearDown() {
+#ifndef ARDUINO
+    Serial.silenciado = false;
+#endif
+}
+
+void test_tarea_retoma_donde_cedio() {
+    contadorActivo = true;
+    int vueltas = vueltasContador;
+    TEST_ASSERT_FALSE(ejecutarVueltaPlanificador());
+    // Un solo comienzo y tres retomas en la misma vuelta: había porción de sobra
+    TEST_ASSERT_EQUAL(vueltas + 1, vueltasContador);
+    TEST_ASSERT_EQUAL(3, pasosContador);
+
+    contadorActivo = false;
+    TEST_ASSERT_FALSE(ejecutarVueltaPlanificador());
+    TEST_ASSERT_EQUAL(vueltas + 2, vueltasContador);
+    Serial.println("✅ Tarea retomada donde cedió: EXITOSO");
+}
+
+// Benchmark: peor latencia de control con la carga de red sintética, contra
+// correr cada etapa hasta el final seguida de delay(10) como antes
+void test_latencia_de_control_bajo_carga() {
+#ifndef ARDUINO
+    const int VUELTAS = 200;
+    cargaActiva = true;
+    hayPrimerControl = false;
+    peorSeparacionControl = 0;
+    uint32_t pendientesAntes = estadisticasPlanificador().vueltasConPendientes;
+    uint64_t inicio = hostMicros();
+    for (int i = 0; i < VUELTAS; i++) {
+        esperarVueltaPlanificador(ejecutarVueltaPlanificador());
+    }
+    uint64_t duracionPlanificador = hostMicros() - inicio;
+    uint32_t conPlanificador = peorSeparacionControl;
+
+    // Mismo trabajo por vuelta con las etapas a término
+    uint32_t aTermino = PASO_HTTP_US + FRAMES_POR_RAFAGA * PASO_WEBSOCKET_US +
+                        CLAVES_POR_VOLCADO * PASO_NVS_US + ESPERA_OCIOSA_MS * 1000;
+
+    Serial.silenciado = false;
+    Serial.printf("latencia_control_peor_us,planificador=%lu,a_termino=%lu,vueltas=%d,ms_simulados=%lu\n",
+                  (unsigned long)conPlanificador, (unsigned long)aTermino, VUELTAS,
+                  (unsigned long)(duracionPlanificador / 1000));
+    Serial.silenciado = true;
+
+    // El control nunca espera más que el intervalo más el paso más largo
+    TEST_ASSERT_TRUE(conPlanificador <= INTERVALO_CONTROL_US + PASO_HTTP_US);
+    TEST_ASSERT_TRUE(conPlanificador < aTermino);
+    TEST_ASSERT_TRUE(estadisticasPlanificador().vueltasConPendientes > pendientesAntes);
+    TEST_ASSERT_TRUE(estadisticasPlanificador().latenciaControlMaximaUs >= conPlanificador);
+
+    // Sin carga el loop vuelve a dormir entre vueltas
+    cargaActiva = false;
+    esperarVueltaPlanificador(ejecutarVueltaPlanificador());
+    TEST_ASSERT_FALSE(ejecutarVueltaPlanificador());
+    Serial.println("✅ Latencia de control acotada bajo carga de red: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("Usa el reloj virtual de la compilación de host (env:native)");
+#endif
+}
+
+void process() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_tarea_retoma_donde_cedio);
+    RUN_TEST(test_latencia_de_control_bajo_carga);
+
+    UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000);
+    Serial.begin(115200);
+    Serial.println("Iniciando tests del planificador del loop...");
+    process();
+}
+
+void loop() {
+    // Tests terminados
+}
+#else
+int main() {
+    process();
+    return 0;
+}
+#endif
@@ -0,0 +1,120 @@
+#include <unity.h>
+#include <Arduino.h>
+#include "../../src/time_utils.h"
+
+static const uint64_t SEGUNDO_US = 1000000ULL;
+static const uint64_t HORA_US = 3600 * SEGUNDO_US;
+
+void setUp() {
+#ifndef ARDUINO
+    Serial.silenciado = true;
+#endif
+}
+
+void tearDown() {
+#ifndef ARDUINO
+    Serial.silenciado = false;
+#endif
+}
+
+void test_no_pierde_fracciones_de_segundo() {
+#ifndef ARDUINO
+    establecerHoraActual(10, 0);
+    uint64_t inicio = microsLocales();
+
+    // Mil lecturas separadas 1,5 s: el reloj anterior descartaba el medio segundo
+    for (int i = 0; i < 1000; i++) {
+        hostAvanzarMicros(1500000ULL);
+        actualizarRelojInterno();
+        segundoActual();
+    }
+    TEST_ASSERT_TRUE(microsLocales() - inicio == 1500 * SEGUNDO_US);
+    TEST_ASSERT_EQUAL(10, horaActual());
+    TEST_ASSERT_EQUAL(25, minutoActual());
+    TEST_ASSERT_EQUAL(0, segundoActual());
+
+    Serial.println("✅ Reloj sin pérdida de fracciones de segundo: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("Usa el reloj virtual de la compilación de host (env:native)");
+#endif
+}
+
+void test_sigue_despues_del_desborde_de_millis() {
+#ifndef ARDUINO
+    establecerDiaSemana(0);
+    establecerHoraActual(0, 0);
+
+    // 50 días: millis() de 32 bits ya dio la vuelta
+    hostAvanzarMicros(50 * 24 * HORA_US + HORA_US);
+    TEST_ASSERT_EQUAL(1, horaActual());
+    TEST_ASSERT_EQUAL(50 % 7, diaSemanaActual());
+
+    Serial.println("✅ Reloj tras 50 días sin actualizar: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("Usa el reloj virtual de la compilación de host (env:native)");
+#endif
+}
+
+void test_aprende_deriva_entre_sincronizaciones() {
+#ifndef ARDUINO
+    // Cristal 100 ppm lento: cada 2 h la referencia va 720 ms adelante
+    uint64_t referencia = 20000 * 24 * HORA_US;
+    sincronizarRelojPreciso(referencia);
+    int32_t derivaInicial = derivaRelojPpb();
+
+    hostAvanzarMicros(2 * HORA_US);
+    referencia += 2 * HORA_US + 720000;
+    sincronizarRelojPreciso(referencia);
+    int32_t primera = derivaRelojPpb() - derivaInicial;
+    TEST_ASSERT_INT32_WITHIN(1000, 50000, primera);
+
+    // La siguiente sincronización mide solo el error que queda
+    hostAvanzarMicros(2 * HORA_US);
+    referencia += 2 * HORA_US + 720000;
+    int64_t errorSinCorregir = 720000;
+    int64_t error = (int64_t)(referencia - microsLocales());
+    TEST_ASSERT_TRUE(error > 0 && error < errorSinCorregir);
+    sincronizarRelojPreciso(referencia);
+    TEST_ASSERT_INT32_WITHIN(1000, 75000, derivaRelojPpb() - derivaInicial);
+
+    // Un ajuste manual en medio no se toma como deriva
+    int32_t antes = derivaRelojPpb();
+    hostAvanzarMicros(2 * HORA_US);
+    establecerHoraActual(3, 0);
+    hostAvanzarMicros(2 * HORA_US);
+    sincronizarRelojPreciso(referencia + 4 * HORA_US);
+    TEST_ASSERT_EQUAL_INT32(antes, derivaRelojPpb());
+
+    Serial.println("✅ Corrección de deriva entre sincronizaciones: EXITOSO");
+#else
+    TEST_IGNORE_MESSAGE("Usa el reloj virtual de la compilación de host (env:native)");
+#endif
+}
+
+void process() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_no_pierde_fracciones_de_segundo);
+    RUN_TEST(test_sigue_despues_del_desborde_de_millis);
+    RUN_TEST(test_aprende_deriva_entre_sincronizaciones);
+
+    UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000);
+    Serial.begin(115200);
+    Serial.println("Iniciando tests del reloj...");
+    process();
+}
+
+void loop() {
+    // Tests terminados
+}
+#else
+int main() {
+    process();
+    return 0;
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include <unity.h>
+#include <Arduino.h>
+#include "../../src/trazas.h"
+#include "../../src/zones.h"
+
+static Traza ultimaTraza() {
+    Traza traza = {};
+    obtenerTrazasRecientes(&traza, 1);
+    return traza;
+}
+
+void setUp() {
+#ifndef ARDUINO
+    Serial.silenciado = true;
+    hostFijarMicros(1000000);
+#endif
+    configurarEstadoZona(0, false);
+    configurarEstadoZona(1, false);
+}
+
+void tearDown() {
+#ifndef ARDUINO
+    Serial.silenciado = false;
+#endif
+}
+
+void test_traza_sella_recibido_aplicado_publicado() {
+    uint32_t id = iniciarTraza(ORIGEN_WEBSOCKET, 0);
+    TEST_ASSERT_TRUE(controlarZonaManualmente(0, true));
+    terminarRecepcionTraza();
+
+    Traza traza = ultimaTraza();
+    TEST_ASSERT_EQUAL_UINT32(id, traza.id);
+    TEST_ASSERT_EQUAL(ORIGEN_WEBSOCKET, traza.origen);
+    TEST_ASSERT_NOT_EQUAL(0, traza.aplicado);
+    TEST_ASSERT_EQUAL_UINT32(0, traza.publicado);
+
+#ifndef ARDUINO
+    hostAvanzarMicros(5000);
+#endif
+    marcarTrazasPublicadas();
+    traza = ultimaTraza();
+    TEST_ASSERT_NOT_EQUAL(0, traza.publicado);
+#ifndef ARDUINO
+    TEST_ASSERT_UINT32_WITHIN(1, 5000, traza.publicado - traza.aplicado);
+#endif
+
+    Serial.println("✅ Traza con recibido, aplicado y publicado: EXITOSO");
+}
+
+void test_escrituras_fuera_de_comando_no_se_atribuyen() {
+    // Zona inválida: no hay escritura de relays, la traza queda sin aplicar
+    iniciarTraza(ORIGEN_HTTP, 7);
+    TEST_ASSERT_FALSE(controlarZonaManualmente(7, true));
+    terminarRecepcionTraza();
+
+    // Un apagado posterior (p. ej. por timeout) no pertenece a ningún comando
+    configurarEstadoZona(1, true);
+    marcarTrazasPublicadas();
+
+    Traza traza = ultimaTraza();
+    TEST_ASSERT_EQUAL_UINT32(0, traza.aplicado);
+    TEST_ASSERT_EQUAL_UINT32(0, traza.publicado);
+
+    Serial.println("✅ Escrituras ajenas al comando no se atribuyen: EXITOSO");
+}
+
+void test_histograma_log2() {
+    TEST_ASSERT_EQUAL_UINT32(64, limiteCubetaLatencia(0));
+    TEST_ASSERT_EQUAL_UINT32(8192, limiteCubetaLatencia(7));
+
+    uint32_t cubetaAntes = histogramaLatencia(ETAPA_PUBLICAR).cubetas[7];
+    uint32_t cantidadAntes = histogramaLatencia(ETAPA_TOTAL).cantidad;
+
+    iniciarTraza(ORIGEN_API, -1);
+    CambioZona cambios[] = {{0, true}, {1, true}};
+    TEST_ASSERT_TRUE(aplicarCambiosZonas(cambios, 2));
+    terminarRecepcionTraza();
+#ifndef ARDUINO
+    hostAvanzarMicros(6000);
+#endif
+    marcarTrazasPublicadas();
+
+    // Un solo comando aunque escriba los relays de dos zonas
+    TEST_ASSERT_EQUAL_UINT32(cantidadAntes + 1, histogramaLatencia(ETAPA_TOTAL).cantidad);
+#ifndef ARDUINO
+    TEST_ASSERT_EQUAL_UINT32(cubetaAntes + 1, histogramaLatencia(ETAPA_PUBLICAR).cubetas[7]);
+#else
+    (void)cubetaAntes;
+#endif
+
+    Serial.println("✅ Histograma log2 de latencias: EXITOSO");
+}
+
+void process() {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_traza_sella_recibido_aplicado_publicado);
+    RUN_TEST(test_escrituras_fuera_de_comando_no_se_atribuyen);
+    RUN_TEST(test_histograma_log2);
+
+    UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+    delay(2000);
+    Serial.begin(115200);
+    Serial.println("Iniciando tests de trazas de latencia...");
+    process();
+}
+
+void loop() {
+    // Tests terminados
+}
+#else
+int main() {
+    process();
+    return 0;
+}
+#endif
@@ -0,0 +1,384 @@
+// Barrido de políticas de apagado sobre una traza con el simulador
+// (tools/simulador.h): cada combinación de timeout, retención del PIR y
+// variante de horario se simula completa y se informa, por zona, la frontera
+// de Pareto entre energía y apagados con gente.
+//
+// Compilar (los mismos módulos que tools/simular.cpp):
+//   g++ -std=gnu++17 -O2 -I src -I lib/arduino_host/src -I tools tools/barrer_politicas.cpp tools/simulador.cpp
+//       src/{zones,time_utils,interrupts,metricas,trazas,bitacora,estadisticas,energia,persistencia,calendario,configuracion,comandos,adaptacion}.cpp
+//       lib/arduino_host/src/Arduino.cpp -o barrer_politicas
+// Uso:       ./barrer_politicas --sintetico 30 --timeouts 30:1800:30 --retenciones 2.5,5,10
+//            ./decodificar_bitacora log.bin | ./barrer_politicas --horarios "08:00-12:00,14:00-18:10;08:00-18:00" -
+//
+// Opciones:  --timeouts LISTA    segundos, "a,b,c" o "desde:hasta:paso" (30:1800:30)
+//            --retenciones L     segundos de retención del PIR, "a,b,c" (2.5)
+//            --adaptativo        además, los timeouts aprendidos (src/adaptacion.h) como
+//                                una política más; timeout_s = "adaptativo"
+//            --horarios V;V      variantes de horario laboral, cada una como --horario de simular
+//                                (la de la configuración por defecto)
+//            --procesos N        simulaciones en paralelo (uno por núcleo)
+//            --todos ARCHIVO     además, el resultado de cada combinación y zona en CSV
+//            --sintetico, --semilla, --inicio, --ventana: como en tools/simular.cpp
+//
+// Las zonas no se afectan entre sí, así que un mismo timeout para todas
+// equivale a barrer cada zona por separado.
+//
+// Salida CSV (frontera, por zona de menor a mayor energía):
+//   zona,timeout_s,retencion_s,horario,wh,apagados_con_gente,apagados_timeout,conmutaciones,horas_encendida
+
+#include "simulador.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+struct Politica
+{
+    uint32_t timeoutS;      // 0 = adaptativo
+    uint32_t retencionMs;
+    int horario;    // Índice en las variantes; -1 = el de la configuración por defecto
+};
+
+// Los módulos del firmware guardan su estado en variables globales, así que
+// dos simulaciones no pueden compartir un proceso. Cada trabajador es un
+// proceso que toma la próxima política libre de un contador atómico en
+// memoria compartida (los rápidos se llevan más, como al robar trabajo) y la
+// corre en un proceso hijo que parte siempre del mismo estado inicial.
+struct Compartido
+{
+    std::atomic<uint32_t> siguiente;
+    std::atomic<uint32_t> fallidas;
+};
+
+struct Ranura
+{
+    ResultadoSimulacion resultado;
+    uint8_t completa;
+};
+
+static bool parsearLista(const char *cadena, double escala, std::vector<uint32_t> &valores)
+{
+    valores.clear();
+    double desde, hasta, paso;
+    if (std::sscanf(cadena, "%lf:%lf:%lf", &desde, &hasta, &paso) == 3)
+    {
+        if (paso <= 0 || hasta < desde)
+        {
+            return false;
+        }
+        for (double valor = desde; valor <= hasta + 1e-9; valor += paso)
+        {
+            valores.push_back((uint32_t)(valor * escala + 0.5));
+        }
+        return true;
+    }
+    std::string copia = cadena;
+    for (char *valor = std::strtok(&copia[0], ","); valor; valor = std::strtok(nullptr, ","))
+    {
+        valores.push_back((uint32_t)(std::atof(valor) * escala + 0.5));
+    }
+    return !valores.empty();
+}
+
+static bool parsearVariantes(const char *cadena, std::vector<EscenarioSimulado> &variantes,
+                             std::vector<std::string> &nombres)
+{
+    std::string copia = cadena;
+    char *resto = &copia[0];
+    for (char *variante = strsep(&resto, ";"); variante; variante = strsep(&resto, ";"))
+    {
+        EscenarioSimulado escenario;
+        escenarioPorDefecto(escenario);
+        if (!parsearHorariosSimulacion(variante, escenario))
+        {
+            return false;
+        }
+        std::string nombre = variante;
+        std::replace(nombre.begin(), nombre.end(), ',', ' ');
+        variantes.push_back(escenario);
+        nombres.push_back(nombre);
+    }
+    return !variantes.empty();
+}
+
+static void trabajador(const TrazaOcupacion &traza, const EscenarioSimulado &base,
+                       const std::vector<EscenarioSimulado> &variantes, const std::vector<Politica> &politicas,
+                       Compartido *compartido, Ranura *ranuras)
+{
+    for (uint32_t i = compartido->siguiente.fetch_add(1); i < politicas.size();
+         i = compartido->siguiente.fetch_add(1))
+    {
+        pid_t hijo = fork();
+        if (hijo == 0)
+        {
+            const Politica &politica = politicas[i];
+            EscenarioSimulado escenario = base;
+            if (politica.horario >= 0)
+            {
+                const EscenarioSimulado &variante = variantes[politica.horario];
+                std::copy(variante.horarios, variante.horarios + CANTIDAD_HORARIOS, escenario.horarios);
+                escenario.horariosPropios = true;
+            }
+            std::fill(escenario.timeoutS, escenario.timeoutS + CANTIDAD_ZONAS, politica.timeoutS);
+            escenario.retencionPirMs = politica.retencionMs;
+            simular(traza, escenario, ranuras[i].resultado);
+            ranuras[i].completa = 1;
+            _exit(0);
+        }
+        int estado = 0;
+        if (hijo < 0 || waitpid(hijo, &estado, 0) < 0 || !ranuras[i].completa)
+        {
+            compartido->fallidas.fetch_add(1);
+        }
+    }
+}
+
+static double wh(const ResultadoSimulacion &resultado, int zona)
+{
+    return resultado.zonas[zona].msEncendida / 3600000.0 * resultado.potenciaW[zona];
+}
+
+static int uso(const char *programa)
+{
+    std::fprintf(stderr,
+                 "Uso: %s [--timeouts LISTA] [--adaptativo] [--retenciones LISTA] [--horarios V;V] [--procesos N]\n"
+                 "       [--todos ARCHIVO] [--sintetico DIAS] [--semilla N] [--inicio FECHA] [--ventana S]\n"
+                 "       [traza.csv | -]\n",
+                 programa);
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    Serial.silenciado = true;
+    EscenarioSimulado base;
+    escenarioPorDefecto(base);
+    std::vector<uint32_t> timeouts, retenciones;
+    parsearLista("30:1800:30", 1, timeouts);
+    parsearLista("2.5", 1000, retenciones);
+    std::vector<EscenarioSimulado> variantes;
+    std::vector<std::string> nombresVariantes;
+    int procesos = std::max(1u, std::thread::hardware_concurrency());
+    int diasSinteticos = 0;
+    bool adaptativo = false;
+    uint32_t semilla = 1;
+    const char *archivo = nullptr;
+    const char *archivoTodos = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *opcion = argv[i];
+        const char *valor = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool valido = true;
+        if (std::strcmp(opcion, "--timeouts") == 0 && valor)
+        {
+            valido = parsearLista(valor, 1, timeouts) &&
+                     *std::min_element(timeouts.begin(), timeouts.end()) >= TIMEOUT_MINIMO_S &&
+                     *std::max_element(timeouts.begin(), timeouts.end()) <= TIMEOUT_MAXIMO_S;
+        }
+        else if (std::strcmp(opcion, "--adaptativo") == 0)
+        {
+            adaptativo = true;
+            continue;
+        }
+        else if (std::strcmp(opcion, "--retenciones") == 0 && valor)
+        {
+            valido = parsearLista(valor, 1000, retenciones) &&
+                     *std::min_element(retenciones.begin(), retenciones.end()) >= 100;
+        }
+        else if (std::strcmp(opcion, "--horarios") == 0 && valor)
+        {
+            valido = parsearVariantes(valor, variantes, nombresVariantes);
+        }
+        else if (std::strcmp(opcion, "--procesos") == 0 && valor)
+        {
+            procesos = std::atoi(valor);
+            valido = procesos > 0;
+        }
+        else if (std::strcmp(opcion, "--todos") == 0 && valor)
+        {
+            archivoTodos = valor;
+        }
+        else if (std::strcmp(opcion, "--sintetico") == 0 && valor)
+        {
+            diasSinteticos = std::atoi(valor);
+            valido = diasSinteticos > 0;
+        }
+        else if (std::strcmp(opcion, "--semilla") == 0 && valor)
+        {
+            semilla = std::strtoul(valor, nullptr, 10);
+        }
+        else if (std::strcmp(opcion, "--inicio") == 0 && valor)
+        {
+            valido = parsearInicioSimulacion(valor, base.microsLocalesInicio);
+        }
+        else if (std::strcmp(opcion, "--ventana") == 0 && valor)
+        {
+            base.ventanaS = std::strtoul(valor, nullptr, 10);
+        }
+        else if (opcion[0] != '-' || std::strcmp(opcion, "-") == 0)
+        {
+            archivo = opcion;
+            continue;
+        }
+        else
+        {
+            return uso(argv[0]);
+        }
+        if (!valido)
+        {
+            std::fprintf(stderr, "%s: valor no válido '%s'\n", opcion, valor);
+            return 1;
+        }
+        i++;
+    }
+    if ((diasSinteticos > 0) == (archivo != nullptr))
+    {
+        return uso(argv[0]);
+    }
+
+    TrazaOcupacion traza;
+    if (!prepararTraza(archivo, diasSinteticos, semilla, base.microsLocalesInicio, traza))
+    {
+        return 1;
+    }
+
+    if (adaptativo)
+    {
+        timeouts.push_back(0);
+    }
+    std::vector<Politica> politicas;
+    int cantidadHorarios = variantes.empty() ? 1 : (int)variantes.size();
+    for (int h = 0; h < cantidadHorarios; h++)
+    {
+        for (uint32_t retencion : retenciones)
+        {
+            for (uint32_t timeout : timeouts)
+            {
+                politicas.push_back({timeout, retencion, variantes.empty() ? -1 : h});
+            }
+        }
+    }
+
+    // Resultados en memoria compartida: los escriben los procesos hijos
+    size_t bytes = sizeof(Compartido) + politicas.size() * sizeof(Ranura);
+    void *memoria = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memoria == MAP_FAILED)
+    {
+        std::perror("mmap");
+        return 1;
+    }
+    Compartido *compartido = new (memoria) Compartido();
+    Ranura *ranuras = reinterpret_cast<Ranura *>(static_cast<char *>(memoria) + sizeof(Compartido));
+
+    auto inicio = std::chrono::steady_clock::now();
+    std::fflush(nullptr);
+    std::vector<pid_t> trabajadores;
+    for (int i = 0; i < std::min<int>(procesos, politicas.size()); i++)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            trabajador(traza, base, variantes, politicas, compartido, ranuras);
+            _exit(0);
+        }
+        if (pid > 0)
+        {
+            trabajadores.push_back(pid);
+        }
+    }
+    if (trabajadores.empty())
+    {
+        std::perror("fork");
+        return 1;
+    }
+    for (pid_t pid : trabajadores)
+    {
+        waitpid(pid, nullptr, 0);
+    }
+    double segundosReales = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+
+    auto nombreTimeout = [](const Politica &politica) {
+        return politica.timeoutS ? std::to_string(politica.timeoutS) : std::string("adaptativo");
+    };
+    auto nombreHorario = [&](const Politica &politica) {
+        return politica.horario < 0 ? std::string("por_defecto") : nombresVariantes[politica.horario];
+    };
+
+    FILE *todos = archivoTodos ? std::fopen(archivoTodos, "w") : nullptr;
+    if (archivoTodos && !todos)
+    {
+        std::perror(archivoTodos);
+    }
+    if (todos)
+    {
+        std::fprintf(todos, "zona,timeout_s,retencion_s,horario,wh,apagados_con_gente,apagados_timeout,"
+                            "conmutaciones,horas_encendida\n");
+    }
+
+    std::printf("zona,timeout_s,retencion_s,horario,wh,apagados_con_gente,apagados_timeout,conmutaciones,"
+                "horas_encendida\n");
+    for (int zona = 0; zona < CANTIDAD_ZONAS; zona++)
+    {
+        std::vector<uint32_t> completas;
+        for (uint32_t i = 0; i < politicas.size(); i++)
+        {
+            if (ranuras[i].completa)
+            {
+                completas.push_back(i);
+            }
+        }
+        // Frontera: de menor a mayor energía, solo las que bajan los apagados con gente
+        std::sort(completas.begin(), completas.end(), [&](uint32_t a, uint32_t b) {
+            double whA = wh(ranuras[a].resultado, zona), whB = wh(ranuras[b].resultado, zona);
+            uint32_t genteA = ranuras[a].resultado.zonas[zona].apagadosConGente;
+            uint32_t genteB = ranuras[b].resultado.zonas[zona].apagadosConGente;
+            return whA != whB ? whA < whB : genteA < genteB;
+        });
+        bool primera = true;
+        uint32_t menorGente = 0;
+        for (uint32_t i : completas)
+        {
+            const Politica &politica = politicas[i];
+            const ResultadoZonaSimulada &resultado = ranuras[i].resultado.zonas[zona];
+            char linea[256];
+            std::snprintf(linea, sizeof(linea), "%d,%s,%.1f,%s,%.1f,%u,%u,%u,%.2f\n", zona + 1, nombreTimeout(politica).c_str(),
+                          politica.retencionMs / 1000.0, nombreHorario(politica).c_str(),
+                          wh(ranuras[i].resultado, zona), resultado.apagadosConGente, resultado.apagadosTimeout,
+                          resultado.conmutaciones, resultado.msEncendida / 3600000.0);
+            if (todos)
+            {
+                std::fputs(linea, todos);
+            }
+            if (primera || resultado.apagadosConGente < menorGente)
+            {
+                std::fputs(linea, stdout);
+                menorGente = resultado.apagadosConGente;
+                primera = false;
+            }
+        }
+    }
+    if (todos)
+    {
+        std::fclose(todos);
+    }
+
+    uint32_t fallidas = compartido->fallidas.load();
+    std::fprintf(stderr, "%zu políticas × %.1f días en %.2f s con %zu procesos (%.1f ms por simulación)%s\n",
+                 politicas.size(), traza.duracionUs / 86400e6, segundosReales, trabajadores.size(),
+                 segundosReales * 1000 * trabajadores.size() / politicas.size(), fallidas ? ", con fallas" : "");
+    if (fallidas)
+    {
+        std::fprintf(stderr, "%u simulaciones no terminaron\n", fallidas);
+    }
+    munmap(memoria, bytes);
+    return fallidas ? 2 : 0;
+}
@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+"""Compara operaciones/segundo entre los endpoints de formulario y la API por lotes.
+
+Uso:  python3 tools/bench_api.py [host] [operaciones] [tamaño_lote]
+      python3 tools/bench_api.py 192.168.4.1 200 16
+
+- /on y /off: una conexión TCP y una redirección 303 por cada cambio de zona.
+- PATCH /api/zones: `tamaño_lote` cambios por request, encolados en un solo paso.
+"""
+import http.client
+import json
+import sys
+import time
+
+CANTIDAD_ZONAS = 2
+
+
+def medir_formularios(host, operaciones):
+    inicio = time.perf_counter()
+    for i in range(operaciones):
+        ruta = ("/on" if i % 2 == 0 else "/off") + "?zona=%d" % (i % CANTIDAD_ZONAS)
+        conexion = http.client.HTTPConnection(host, 80, timeout=5)
+        conexion.request("GET", ruta)
+        respuesta = conexion.getresponse()
+        respuesta.read()
+        conexion.close()
+        if respuesta.status != 303:
+            raise RuntimeError("%s respondió %d" % (ruta, respuesta.status))
+    return operaciones / (time.perf_counter() - inicio)
+
+
+def medir_lotes(host, operaciones, tamano_lote):
+    enviadas = 0
+    inicio = time.perf_counter()
+    while enviadas < operaciones:
+        cantidad = min(tamano_lote, operaciones - enviadas)
+        lote = [{"zona": (enviadas + i) % CANTIDAD_ZONAS, "on": (enviadas + i) % 2 == 0}
+                for i in range(cantidad)]
+        conexion = http.client.HTTPConnection(host, 80, timeout=5)
+        conexion.request("PATCH", "/api/zones", json.dumps(lote),
+                         {"Content-Type": "application/json"})
+        respuesta = conexion.getresponse()
+        cuerpo = json.loads(respuesta.read())
+        conexion.close()
+        if respuesta.status != 200 or not cuerpo.get("ok"):
+            raise RuntimeError("PATCH /api/zones respondió %d %s" % (respuesta.status, cuerpo))
+        enviadas += cantidad
+    return operaciones / (time.perf_counter() - inicio)
+
+
+def main():
+    host = sys.argv[1] if len(sys.argv) > 1 else "192.168.4.1"
+    operaciones = int(sys.argv[2]) if len(sys.argv) > 2 else 200
+    tamano_lote = int(sys.argv[3]) if len(sys.argv) > 3 else 16
+
+    formularios = medir_formularios(host, operaciones)
+    lotes = medir_lotes(host, operaciones, tamano_lote)
+    print("endpoint,ops_por_segundo")
+    print("/on|/off,%.1f" % formularios)
+    print("PATCH /api/zones (lote=%d),%.1f" % (tamano_lote, lotes))
+    print("# mejora: x%.1f" % (lotes / formularios))
+
+
+if __name__ == "__main__":
+    main()
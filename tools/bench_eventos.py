@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+"""Compara el flujo de estado por Server-Sent Events (puerto 82) contra el WebSocket (puerto 81).
+
+Uso:  python3 tools/bench_eventos.py [host] [clientes] [segundos]
+      python3 tools/bench_eventos.py 192.168.4.1 4 30
+
+Abre `clientes` conexiones de cada tipo en paralelo y reporta eventos/segundo
+y bytes/segundo por transporte. La memoria por suscriptor se obtiene del
+monitor serie: cada alta y baja imprime "heap libre" (WebSocket y SSE), así
+que la diferencia entre líneas consecutivas es el costo de una conexión.
+"""
+import base64
+import os
+import socket
+import sys
+import threading
+import time
+
+
+def leer_sse(host, duracion, resultado):
+    conexion = socket.create_connection((host, 82), timeout=5)
+    conexion.sendall(b"GET /events HTTP/1.1\r\nHost: %s\r\nAccept: text/event-stream\r\n\r\n" % host.encode())
+    buffer = b""
+    eventos = 0
+    total = 0
+    limite = time.monotonic() + duracion
+    while time.monotonic() < limite:
+        datos = conexion.recv(4096)
+        if not datos:
+            break
+        total += len(datos)
+        buffer += datos
+        while b"\n\n" in buffer:
+            bloque, buffer = buffer.split(b"\n\n", 1)
+            if b"data: " in bloque:
+                eventos += 1
+    conexion.close()
+    resultado.append((eventos, total))
+
+
+def leer_websocket(host, duracion, resultado):
+    conexion = socket.create_connection((host, 81), timeout=5)
+    clave = base64.b64encode(os.urandom(16))
+    conexion.sendall(b"GET / HTTP/1.1\r\nHost: %s:81\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                     b"Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n" % (host.encode(), clave))
+    buffer = b""
+    while b"\r\n\r\n" not in buffer:
+        datos = conexion.recv(1024)
+        if not datos:
+            conexion.close()
+            resultado.append((0, 0))
+            return
+        buffer += datos
+    buffer = buffer.split(b"\r\n\r\n", 1)[1]
+    eventos = 0
+    total = 0
+    limite = time.monotonic() + duracion
+
+    # Completa el buffer hasta `largo` bytes; False si el servidor cerró
+    def completar(largo):
+        nonlocal buffer
+        while len(buffer) < largo:
+            datos = conexion.recv(4096)
+            if not datos:
+                return False
+            buffer += datos
+        return True
+
+    while time.monotonic() < limite:
+        # Frames del servidor: sin máscara, opcode en el primer byte
+        if not completar(2):
+            break
+        largo = buffer[1] & 0x7F
+        cabecera = 2
+        if largo == 126:
+            cabecera = 4
+        elif largo == 127:
+            cabecera = 10
+        if not completar(cabecera):
+            break
+        if cabecera > 2:
+            largo = int.from_bytes(buffer[2:cabecera], "big")
+        if not completar(cabecera + largo):
+            break
+        total += cabecera + largo
+        eventos += 1
+        buffer = buffer[cabecera + largo:]
+    conexion.close()
+    resultado.append((eventos, total))
+
+
+def medir(funcion, host, clientes, duracion):
+    resultado = []
+    hilos = [threading.Thread(target=funcion, args=(host, duracion, resultado)) for _ in range(clientes)]
+    for hilo in hilos:
+        hilo.start()
+    for hilo in hilos:
+        hilo.join()
+    eventos = sum(r[0] for r in resultado)
+    total = sum(r[1] for r in resultado)
+    return eventos / duracion, total / duracion
+
+
+def main():
+    host = sys.argv[1] if len(sys.argv) > 1 else "192.168.4.1"
+    clientes = int(sys.argv[2]) if len(sys.argv) > 2 else 4
+    duracion = float(sys.argv[3]) if len(sys.argv) > 3 else 30
+
+    print("transporte,clientes,eventos_por_segundo,bytes_por_segundo")
+    for nombre, funcion in (("websocket:81", leer_websocket), ("sse:82", leer_sse)):
+        eventos, total = medir(funcion, host, clientes, duracion)
+        print("%s,%d,%.1f,%.0f" % (nombre, clientes, eventos, total))
+
+
+if __name__ == "__main__":
+    main()
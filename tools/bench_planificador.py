@@ -0,0 +1,104 @@
+#!/usr/bin/env python3
+"""Peor latencia del control del loop bajo carga de red sintética.
+
+Uso:  python3 tools/bench_planificador.py [host] [clientes] [segundos]
+      python3 tools/bench_planificador.py 192.168.4.1 4 30
+
+Lee el histograma `sdi_latencia_control_us` de /metrics (separación entre dos
+pasadas de las tareas de control), genera carga durante `segundos` con
+`clientes` hilos que piden la página principal y otros tantos que mandan
+PATCH /api/zones, y vuelve a leerlo. La diferencia es la distribución medida
+solo durante la carga; se reporta p50, p99 y la cubeta del peor caso, junto
+con la misma medición sin carga como referencia.
+"""
+import http.client
+import json
+import re
+import sys
+import threading
+import time
+
+CANTIDAD_ZONAS = 2
+PATRON_CUBETA = re.compile(r'^sdi_latencia_control_us_bucket\{le="([^"]+)"\} (\d+)$')
+
+
+def leer_histograma(host):
+    conexion = http.client.HTTPConnection(host, 80, timeout=10)
+    conexion.request("GET", "/metrics")
+    cuerpo = conexion.getresponse().read().decode()
+    conexion.close()
+    cubetas = []
+    for linea in cuerpo.splitlines():
+        coincidencia = PATRON_CUBETA.match(linea)
+        if coincidencia:
+            limite = coincidencia.group(1)
+            cubetas.append((float("inf") if limite == "+Inf" else int(limite), int(coincidencia.group(2))))
+    return cubetas
+
+
+def resumir(antes, despues):
+    # Cubetas acumuladas de Prometheus: la diferencia sigue siendo acumulada
+    acumuladas = [(limite, d - a) for (limite, a), (_, d) in zip(antes, despues)]
+    total = acumuladas[-1][1] if acumuladas else 0
+    if total == 0:
+        return 0, None, None, None
+
+    def percentil(fraccion):
+        for limite, cantidad in acumuladas:
+            if cantidad >= fraccion * total:
+                return limite
+        return acumuladas[-1][0]
+
+    peor = next(limite for limite, cantidad in acumuladas if cantidad == total)
+    return total, percentil(0.5), percentil(0.99), peor
+
+
+def pedir_pagina(host, limite):
+    while time.monotonic() < limite:
+        conexion = http.client.HTTPConnection(host, 80, timeout=10)
+        conexion.request("GET", "/")
+        conexion.getresponse().read()
+        conexion.close()
+
+
+def enviar_lotes(host, limite):
+    i = 0
+    while time.monotonic() < limite:
+        lote = [{"zona": z, "on": (i + z) % 2 == 0} for z in range(CANTIDAD_ZONAS)]
+        conexion = http.client.HTTPConnection(host, 80, timeout=10)
+        conexion.request("PATCH", "/api/zones", json.dumps(lote), {"Content-Type": "application/json"})
+        conexion.getresponse().read()
+        conexion.close()
+        i += 1
+
+
+def medir(host, clientes, duracion):
+    antes = leer_histograma(host)
+    limite = time.monotonic() + duracion
+    hilos = []
+    for _ in range(clientes):
+        hilos.append(threading.Thread(target=pedir_pagina, args=(host, limite)))
+        hilos.append(threading.Thread(target=enviar_lotes, args=(host, limite)))
+    for hilo in hilos:
+        hilo.start()
+    if not hilos:
+        time.sleep(duracion)
+    for hilo in hilos:
+        hilo.join()
+    return resumir(antes, leer_histograma(host))
+
+
+def main():
+    host = sys.argv[1] if len(sys.argv) > 1 else "192.168.4.1"
+    clientes = int(sys.argv[2]) if len(sys.argv) > 2 else 4
+    duracion = float(sys.argv[3]) if len(sys.argv) > 3 else 30
+
+    print("carga,clientes,pasadas,p50_us,p99_us,peor_us")
+    for nombre, cantidad in (("sin_carga", 0), ("pagina+api", clientes)):
+        pasadas, p50, p99, peor = medir(host, cantidad, duracion)
+        print("%s,%d,%d,%s,%s,%s" % (nombre, cantidad, pasadas, p50, p99, peor))
+    print("# cada valor es el límite superior de su cubeta log2 (64 us ... 2 s)")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+"""Compara dos corridas de test/test_benchmark y marca las regresiones.
+
+Uso:  python3 tools/comparar_benchmarks.py base.txt nuevo.txt [tolerancia_%]
+      pio test -e bench_native_16 -v > nuevo.txt
+      python3 tools/comparar_benchmarks.py base.txt nuevo.txt 15
+
+Lee las líneas "BENCH {json}" de cada archivo (la salida de `pio test -v`, o
+solo esas líneas) y las empareja por función, zonas y plataforma. Es regresión
+que ns/op suba más que la tolerancia (10 % por defecto) o que aparezcan
+asignaciones o llamadas a Serial que la base no tenía: eso no depende del
+ruido de la máquina. Sale con código 1 si hay alguna.
+"""
+import json
+import sys
+
+PREFIJO = "BENCH "
+
+
+def leer(archivo):
+    mediciones = {}
+    with open(archivo, encoding="utf-8", errors="replace") as entrada:
+        for linea in entrada:
+            posicion = linea.find(PREFIJO)
+            if posicion < 0:
+                continue
+            medicion = json.loads(linea[posicion + len(PREFIJO):])
+            clave = (medicion["funcion"], medicion["zonas"], medicion["plataforma"])
+            mediciones[clave] = medicion
+    return mediciones
+
+
+def main():
+    if len(sys.argv) < 3:
+        print(__doc__)
+        return 2
+    base = leer(sys.argv[1])
+    nuevo = leer(sys.argv[2])
+    tolerancia = float(sys.argv[3]) if len(sys.argv) > 3 else 10.0
+
+    regresiones = 0
+    print("%-40s %5s %-6s %12s %12s %8s  %s" % ("funcion", "zonas", "plat", "base ns/op", "nuevo ns/op", "cambio", ""))
+    for clave in sorted(set(base) | set(nuevo)):
+        funcion, zonas, plataforma = clave
+        if clave not in base or clave not in nuevo:
+            print("%-40s %5d %-6s %s" % (funcion, zonas, plataforma, "solo en " + ("nuevo" if clave in nuevo else "base")))
+            continue
+        antes, despues = base[clave], nuevo[clave]
+        cambio = (despues["ns_op"] / antes["ns_op"] - 1) * 100 if antes["ns_op"] else 0.0
+        motivos = []
+        if cambio > tolerancia:
+            motivos.append("más lento")
+        for campo in ("asignaciones_op", "serial_op"):
+            if despues[campo] > antes[campo] + 1e-9:
+                motivos.append("%s %.3f -> %.3f" % (campo, antes[campo], despues[campo]))
+        if motivos:
+            regresiones += 1
+        print("%-40s %5d %-6s %12.1f %12.1f %+7.1f%%  %s" % (funcion, zonas, plataforma, antes["ns_op"],
+                                                             despues["ns_op"], cambio, ", ".join(motivos)))
+
+    print("\n%d regresiones (tolerancia %.0f %%)" % (regresiones, tolerancia))
+    return 1 if regresiones else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
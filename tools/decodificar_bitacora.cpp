@@ -0,0 +1,91 @@
+// Decodificador de la bitácora binaria de eventos (GET /log.bin o una copia de /bitacora.bin).
+//
+// Compilar:  g++ -std=c++17 -O2 -I src tools/decodificar_bitacora.cpp -o decodificar_bitacora
+// Uso:       curl -s http://micasita.local/log.bin | ./decodificar_bitacora
+//            ./decodificar_bitacora log.bin > eventos.csv
+//
+// Salida CSV: secuencia,arranque,segundos,zona,evento (zona desde 1, segundos desde el arranque)
+
+#include "formato_bitacora.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+struct Segmento
+{
+    CabeceraSegmento cabecera;
+    RegistroEvento registros[REGISTROS_POR_SEGMENTO];
+};
+
+int main(int argc, char **argv)
+{
+    FILE *entrada = stdin;
+    if (argc > 1 && std::strcmp(argv[1], "-") != 0)
+    {
+        entrada = std::fopen(argv[1], "rb");
+        if (!entrada)
+        {
+            std::perror(argv[1]);
+            return 1;
+        }
+    }
+
+    std::vector<Segmento> segmentos;
+    unsigned long invalidos = 0;
+    uint8_t buffer[BYTES_SEGMENTO_BITACORA];
+    while (std::fread(buffer, 1, sizeof(buffer), entrada) == sizeof(buffer))
+    {
+        Segmento segmento;
+        std::memcpy(&segmento.cabecera, buffer, sizeof(CabeceraSegmento));
+        std::memcpy(segmento.registros, buffer + sizeof(CabeceraSegmento), sizeof(segmento.registros));
+        if (segmento.cabecera.magia == 0)
+        {
+            continue; // Ranura nunca escrita
+        }
+        if (!segmentoValido(segmento.cabecera, segmento.registros))
+        {
+            invalidos++;
+            continue;
+        }
+        segmentos.push_back(segmento);
+    }
+
+    // El archivo es circular: ordenar por secuencia. Un segmento puede aparecer dos
+    // veces si se copió el archivo mientras se volcaba; se queda la copia más larga.
+    std::sort(segmentos.begin(), segmentos.end(), [](const Segmento &a, const Segmento &b) {
+        return a.cabecera.secuencia != b.cabecera.secuencia ? a.cabecera.secuencia < b.cabecera.secuencia
+                                                            : a.cabecera.cantidad > b.cabecera.cantidad;
+    });
+
+    std::printf("secuencia,arranque,segundos,zona,evento\n");
+    unsigned long eventos = 0;
+    uint32_t ultimaSecuencia = 0;
+    for (const Segmento &segmento : segmentos)
+    {
+        if (segmento.cabecera.secuencia == ultimaSecuencia)
+        {
+            continue;
+        }
+        ultimaSecuencia = segmento.cabecera.secuencia;
+
+        uint32_t decimas = segmento.cabecera.inicioDecimas;
+        for (int i = 0; i < segmento.cabecera.cantidad; i++)
+        {
+            const RegistroEvento &registro = segmento.registros[i];
+            decimas += registro.deltaDecimas;
+            if (registro.tipo == EVENTO_SALTO)
+            {
+                continue;
+            }
+            std::printf("%u,%u,%u.%u,%u,%s\n", segmento.cabecera.secuencia, segmento.cabecera.arranque,
+                        decimas / 10, decimas % 10, registro.zona + 1, nombreTipoEvento(registro.tipo));
+            eventos++;
+        }
+    }
+
+    std::fprintf(stderr, "%zu segmentos, %lu eventos, %lu segmentos descartados por CRC\n",
+                 segmentos.size(), eventos, invalidos);
+    return invalidos ? 2 : 0;
+}
@@ -0,0 +1,652 @@
+#include "simulador.h"
+#include "zones.h"
+#include "interrupts.h"
+#include "comandos.h"
+#include "configuracion.h"
+#include "calendario.h"
+#include "estadisticas.h"
+#include "energia.h"
+#include "metricas.h"
+#include "persistencia.h"
+#include "adaptacion.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <queue>
+#include <random>
+
+static const uint64_t SEGUNDO_US = 1000000ULL;
+static const uint64_t MINUTO_US = 60 * SEGUNDO_US;
+static const uint64_t HORA_US = 60 * MINUTO_US;
+static const uint64_t DIA_US = 24 * HORA_US;
+
+static const uint64_t REACCION_US = 5 * SEGUNDO_US; // Del ocupante que se queda a oscuras
+static const uint64_t LECTURA_PIR_US = 100000;      // Igual que procesarInterrupcionesPIR()
+static const uint64_t COLA_TRAZA_US = HORA_US;      // Se sigue simulando después del último evento
+
+// ---------------------------------------------------------------------------
+// Carga de trazas
+
+static bool tipoDesdeNombre(const char *nombre, int &tipo)
+{
+    static const struct
+    {
+        const char *nombre;
+        int tipo;
+    } nombres[] = {
+        {"movimiento", TRAZA_MOVIMIENTO},
+        {"movimiento_encendida", TRAZA_MOVIMIENTO},
+        {"movimiento_apagada", TRAZA_MOVIMIENTO},
+        {"pir_alto", TRAZA_PIR_ALTO},
+        {"pir_bajo", TRAZA_PIR_BAJO},
+        {"encender", TRAZA_ENCENDER},
+        {"encendido_manual", TRAZA_ENCENDER},
+        {"apagar", TRAZA_APAGAR},
+        {"apagado_manual", TRAZA_APAGAR},
+        {"apagado_timeout", -1},
+        {"salto", -1},
+    };
+    for (const auto &entrada : nombres)
+    {
+        if (std::strcmp(nombre, entrada.nombre) == 0)
+        {
+            tipo = entrada.tipo;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool cargarTraza(FILE *entrada, TrazaOcupacion &traza, std::string &error)
+{
+    traza.eventos.clear();
+    traza.sintetica = false;
+    char linea[256];
+    unsigned long numero = 0;
+    unsigned long arranque = 0;
+    uint64_t base = 0;
+    uint64_t ultimo = 0;
+    while (std::fgets(linea, sizeof(linea), entrada))
+    {
+        numero++;
+        linea[std::strcspn(linea, "\r\n")] = '\0';
+        if (linea[0] == '\0' || linea[0] == '#' || std::strncmp(linea, "secuencia,", 10) == 0 ||
+            std::strncmp(linea, "segundos,", 9) == 0)
+        {
+            continue;
+        }
+
+        char *campos[5];
+        int cantidad = 0;
+        for (char *campo = std::strtok(linea, ","); campo && cantidad < 5; campo = std::strtok(nullptr, ","))
+        {
+            campos[cantidad++] = campo;
+        }
+        if (cantidad != 3 && cantidad != 5)
+        {
+            error = "línea " + std::to_string(numero) + ": se esperaban 3 o 5 campos";
+            return false;
+        }
+
+        // Formato del decodificador: secuencia,arranque,segundos,zona,evento
+        char **resto = campos;
+        if (cantidad == 5)
+        {
+            unsigned long arranqueLinea = std::strtoul(campos[1], nullptr, 10);
+            if (arranqueLinea != arranque)
+            {
+                // Segundos desde el arranque: cada arranque sigue donde terminó el anterior
+                arranque = arranqueLinea;
+                base = ultimo;
+            }
+            resto = campos + 2;
+        }
+
+        double segundos = std::strtod(resto[0], nullptr);
+        int zona = std::atoi(resto[1]);
+        int tipo;
+        if (segundos < 0 || zona < 1 || zona > CANTIDAD_ZONAS)
+        {
+            error = "línea " + std::to_string(numero) + ": segundos o zona fuera de rango";
+            return false;
+        }
+        if (!tipoDesdeNombre(resto[2], tipo))
+        {
+            error = "línea " + std::to_string(numero) + ": evento desconocido '" + resto[2] + "'";
+            return false;
+        }
+        uint64_t us = base + (uint64_t)std::llround(segundos * SEGUNDO_US);
+        ultimo = std::max(ultimo, us);
+        if (tipo >= 0)
+        {
+            traza.eventos.push_back({us, (uint8_t)(zona - 1), (uint8_t)tipo, 0});
+        }
+    }
+
+    std::stable_sort(traza.eventos.begin(), traza.eventos.end(),
+                     [](const EventoTraza &a, const EventoTraza &b) { return a.us < b.us; });
+    traza.duracionUs = ultimo + COLA_TRAZA_US;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Trazas sintéticas
+
+struct PerfilOcupacion
+{
+    float llegadasPorHora[2][24];   // Día hábil, fin de semana
+    float estadiaMediaS;
+    float pausaMediaS;              // Entre dos movimientos de alguien presente
+    float probabilidadQuieto;       // Pausa larga (leyendo, en la computadora)
+    float quietoMedioS;
+    float probabilidadApagarAlSalir;
+};
+
+static void llenarFranja(float horas[24], int desde, int hasta, float tasa)
+{
+    for (int h = desde; h < hasta; h++)
+    {
+        horas[h] = tasa;
+    }
+}
+
+static PerfilOcupacion perfilOficina()
+{
+    PerfilOcupacion perfil = {};
+    llenarFranja(perfil.llegadasPorHora[0], 0, 24, 0.02f);
+    llenarFranja(perfil.llegadasPorHora[0], 8, 18, 0.5f);
+    llenarFranja(perfil.llegadasPorHora[0], 18, 22, 0.4f);
+    llenarFranja(perfil.llegadasPorHora[1], 0, 24, 0.02f);
+    llenarFranja(perfil.llegadasPorHora[1], 10, 20, 0.15f);
+    perfil.estadiaMediaS = 50 * 60;
+    perfil.pausaMediaS = 40;
+    perfil.probabilidadQuieto = 0.15f;
+    perfil.quietoMedioS = 6 * 60;
+    perfil.probabilidadApagarAlSalir = 0.6f;
+    return perfil;
+}
+
+static PerfilOcupacion perfilPasillo()
+{
+    PerfilOcupacion perfil = {};
+    llenarFranja(perfil.llegadasPorHora[0], 0, 24, 0.2f);
+    llenarFranja(perfil.llegadasPorHora[0], 7, 19, 4.0f);
+    llenarFranja(perfil.llegadasPorHora[0], 19, 23, 1.5f);
+    llenarFranja(perfil.llegadasPorHora[1], 0, 24, 0.2f);
+    llenarFranja(perfil.llegadasPorHora[1], 9, 22, 1.0f);
+    perfil.estadiaMediaS = 90;
+    perfil.pausaMediaS = 8;
+    perfil.probabilidadQuieto = 0.0f;
+    perfil.quietoMedioS = 0;
+    perfil.probabilidadApagarAlSalir = 0.2f;
+    return perfil;
+}
+
+void generarTrazaSintetica(int dias, uint32_t semilla, uint64_t microsLocalesInicio, TrazaOcupacion &traza)
+{
+    traza.eventos.clear();
+    traza.sintetica = true;
+    traza.duracionUs = (uint64_t)dias * DIA_US;
+    std::mt19937_64 generador(semilla);
+    std::uniform_real_distribution<double> uniforme(0.0, 1.0);
+    auto exponencial = [&](double media) { return -media * std::log(1.0 - uniforme(generador)); };
+
+    for (int zona = 0; zona < CANTIDAD_ZONAS; zona++)
+    {
+        PerfilOcupacion perfil = zona % 2 == 0 ? perfilOficina() : perfilPasillo();
+
+        // Llegadas de Poisson hora por hora; las estadías que se solapan se unen
+        std::vector<std::pair<uint64_t, uint64_t>> estadias;
+        for (uint64_t hora = 0; hora * HORA_US < traza.duracionUs; hora++)
+        {
+            uint64_t local = microsLocalesInicio + hora * HORA_US;
+            int diaSemana = (int)((local / DIA_US + 3) % 7);   // 1/1/1970 fue jueves
+            int horaDia = (int)(local / HORA_US % 24);
+            float tasa = perfil.llegadasPorHora[diaSemana >= 5 ? 1 : 0][horaDia];
+            int llegadas = std::poisson_distribution<int>(tasa)(generador);
+            for (int i = 0; i < llegadas; i++)
+            {
+                uint64_t llegada = hora * HORA_US + (uint64_t)(uniforme(generador) * HORA_US);
+                uint64_t salida = llegada + SEGUNDO_US + (uint64_t)(exponencial(perfil.estadiaMediaS) * SEGUNDO_US);
+                estadias.push_back({llegada, std::min(salida, traza.duracionUs - SEGUNDO_US)});
+            }
+        }
+        std::sort(estadias.begin(), estadias.end());
+        std::vector<std::pair<uint64_t, uint64_t>> unidas;
+        for (const auto &estadia : estadias)
+        {
+            if (estadia.first >= estadia.second)
+            {
+                continue;
+            }
+            if (!unidas.empty() && estadia.first <= unidas.back().second)
+            {
+                unidas.back().second = std::max(unidas.back().second, estadia.second);
+            }
+            else
+            {
+                unidas.push_back(estadia);
+            }
+        }
+
+        for (const auto &estadia : unidas)
+        {
+            uint8_t z = (uint8_t)zona;
+            traza.eventos.push_back({estadia.first, z, TRAZA_LLEGADA, 0});
+            for (uint64_t t = estadia.first + SEGUNDO_US / 2; t < estadia.second;)
+            {
+                traza.eventos.push_back({t, z, TRAZA_MOVIMIENTO, 0});
+                double pausa = uniforme(generador) < perfil.probabilidadQuieto ? exponencial(perfil.quietoMedioS)
+                                                                               : exponencial(perfil.pausaMediaS);
+                t += SEGUNDO_US + (uint64_t)(pausa * SEGUNDO_US);
+            }
+            traza.eventos.push_back({estadia.second, z, TRAZA_SALIDA,
+                                     (uint8_t)(uniforme(generador) < perfil.probabilidadApagarAlSalir)});
+        }
+    }
+
+    std::stable_sort(traza.eventos.begin(), traza.eventos.end(),
+                     [](const EventoTraza &a, const EventoTraza &b) { return a.us < b.us; });
+}
+
+bool prepararTraza(const char *archivo, int dias, uint32_t semilla, uint64_t microsLocalesInicio,
+                   TrazaOcupacion &traza)
+{
+    if (dias > 0)
+    {
+        generarTrazaSintetica(dias, semilla, microsLocalesInicio, traza);
+        return true;
+    }
+    FILE *entrada = std::strcmp(archivo, "-") == 0 ? stdin : std::fopen(archivo, "r");
+    if (!entrada)
+    {
+        std::perror(archivo);
+        return false;
+    }
+    std::string error;
+    bool cargada = cargarTraza(entrada, traza, error);
+    if (entrada != stdin)
+    {
+        std::fclose(entrada);
+    }
+    if (!cargada)
+    {
+        std::fprintf(stderr, "%s: %s\n", archivo, error.c_str());
+    }
+    return cargada;
+}
+
+// ---------------------------------------------------------------------------
+// Simulación
+
+void escenarioPorDefecto(EscenarioSimulado &escenario)
+{
+    escenario = {};
+    uint16_t dia = 0;
+    parsearFecha("2026-01-05", dia);   // Un lunes
+    escenario.microsLocalesInicio = dia * DIA_US;
+    for (int i = 0; i < CANTIDAD_HORARIOS; i++)
+    {
+        escenario.horarios[i] = horariosLaborales[i];
+    }
+    escenario.retencionPirMs = 2500;   // El mínimo de un HC-SR501
+    escenario.ventanaS = 60;
+}
+
+bool parsearInicioSimulacion(const char *cadena, uint64_t &microsLocales)
+{
+    char fecha[11] = {};
+    std::strncpy(fecha, cadena, 10);
+    uint16_t dia, minutos = 0;
+    if (!parsearFecha(fecha, dia) || (cadena[10] != '\0' && !((cadena[10] == 'T' || cadena[10] == ' ') &&
+                                                              parsearHora(cadena + 11, minutos))))
+    {
+        return false;
+    }
+    microsLocales = dia * DIA_US + minutos * MINUTO_US;
+    return true;
+}
+
+bool parsearHorariosSimulacion(const char *cadena, EscenarioSimulado &escenario)
+{
+    char copia[64] = {};
+    std::strncpy(copia, cadena, sizeof(copia) - 1);
+    int cantidad = 0;
+    for (char *intervalo = std::strtok(copia, ","); intervalo; intervalo = std::strtok(nullptr, ","))
+    {
+        if (cantidad == CANTIDAD_HORARIOS || !parsearIntervalo(intervalo, escenario.horarios[cantidad]))
+        {
+            return false;
+        }
+        cantidad++;
+    }
+    // Los horarios que no se dan quedan vacíos
+    for (int i = cantidad; i < CANTIDAD_HORARIOS; i++)
+    {
+        escenario.horarios[i] = {0, 0};
+    }
+    escenario.horariosPropios = cantidad > 0;
+    return cantidad > 0;
+}
+
+// Eventos que agenda la propia simulación: la bajada de un pulso del PIR y
+// la reacción de un ocupante
+struct EventoAgendado
+{
+    uint64_t us;
+    uint64_t orden;
+    EventoTraza evento;
+    uint32_t version;
+
+    bool operator>(const EventoAgendado &otro) const
+    {
+        return us != otro.us ? us > otro.us : orden > otro.orden;
+    }
+};
+
+class Simulacion
+{
+public:
+    Simulacion(const TrazaOcupacion &traza, const EscenarioSimulado &escenario, ResultadoSimulacion &resultado)
+        : traza(traza), escenario(escenario), resultado(resultado)
+    {
+    }
+
+    void correr();
+
+private:
+    const TrazaOcupacion &traza;
+    const EscenarioSimulado &escenario;
+    ResultadoSimulacion &resultado;
+
+    uint64_t origen = 0;
+    std::priority_queue<EventoAgendado, std::vector<EventoAgendado>, std::greater<EventoAgendado>> agenda;
+    uint64_t ordenAgenda = 0;
+
+    uint32_t versionPulso[CANTIDAD_ZONAS] = {};
+    bool presente[CANTIDAD_ZONAS] = {};
+    bool reaccionPendiente[CANTIDAD_ZONAS] = {};
+    bool encendida[CANTIDAD_ZONAS] = {};
+    uint64_t desdeEncendida[CANTIDAD_ZONAS] = {};
+    uint64_t ultimoTimeout[CANTIDAD_ZONAS] = {};
+    bool timeoutSinActividad[CANTIDAD_ZONAS] = {};
+    uint32_t timeoutsAntes[CANTIDAD_ZONAS] = {};
+    uint32_t movimientosAntes[CANTIDAD_ZONAS] = {};
+    uint32_t conmutacionesAntes[CANTIDAD_ZONAS] = {};
+
+    void agendar(uint64_t us, const EventoTraza &evento, uint32_t version = 0)
+    {
+        agenda.push({us, ordenAgenda++, evento, version});
+    }
+    void ordenar(int zona, bool encender)
+    {
+        CambioZona cambio = {zona, encender};
+        encolarCambiosZonas(&cambio, 1, 0);
+    }
+    void actividad(int zona);
+    void aplicar(const EventoTraza &evento, uint32_t version);
+    void pasoControl();
+    uint64_t proximoDespertar(uint64_t siguienteEvento);
+};
+
+static uint32_t sumaMovimientos(int zona)
+{
+    uint32_t suma = 0;
+    for (int h = 0; h < HORAS_SEMANA; h++)
+    {
+        suma += estadisticasZona(zona).movimientos[h];
+    }
+    return suma;
+}
+
+// Sin estadías conocidas, un timeout seguido de actividad dentro de la ventana
+// se toma como apagado con gente
+void Simulacion::actividad(int zona)
+{
+    if (!traza.sintetica && timeoutSinActividad[zona] &&
+        hostMicros() - ultimoTimeout[zona] <= escenario.ventanaS * SEGUNDO_US)
+    {
+        resultado.zonas[zona].apagadosConGente++;
+    }
+    timeoutSinActividad[zona] = false;
+}
+
+void Simulacion::aplicar(const EventoTraza &evento, uint32_t version)
+{
+    int zona = evento.zona;
+    int pin = zonas[zona].pinPir;
+    uint64_t ahora = hostMicros();
+    switch (evento.tipo)
+    {
+    case TRAZA_MOVIMIENTO:
+        if (!hostLeerPin(pin))
+        {
+            actividad(zona);
+        }
+        hostFijarPin(pin, HIGH);
+        versionPulso[zona]++;
+        agendar(ahora + escenario.retencionPirMs * 1000ULL, {0, evento.zona, TRAZA_PIR_BAJO, 0}, versionPulso[zona]);
+        // Quien está a oscuras vuelve a encender la luz
+        if (presente[zona] && !zonas[zona].estaActivo && !reaccionPendiente[zona])
+        {
+            reaccionPendiente[zona] = true;
+            agendar(ahora + REACCION_US, {0, evento.zona, TRAZA_ENCENDER, 1});
+        }
+        break;
+    case TRAZA_PIR_ALTO:
+        if (!hostLeerPin(pin))
+        {
+            actividad(zona);
+        }
+        versionPulso[zona]++;
+        hostFijarPin(pin, HIGH);
+        break;
+    case TRAZA_PIR_BAJO:
+        // Un pulso redisparado deja sin efecto la bajada agendada antes
+        if (version == 0 || version == versionPulso[zona])
+        {
+            hostFijarPin(pin, LOW);
+        }
+        break;
+    case TRAZA_ENCENDER:
+        if (evento.dato)
+        {
+            reaccionPendiente[zona] = false;
+            if (!presente[zona] || zonas[zona].estaActivo)
+            {
+                break;
+            }
+        }
+        actividad(zona);
+        ordenar(zona, true);
+        break;
+    case TRAZA_APAGAR:
+        ordenar(zona, false);
+        break;
+    case TRAZA_LLEGADA:
+        presente[zona] = true;
+        if (!zonas[zona].estaActivo && !reaccionPendiente[zona])
+        {
+            reaccionPendiente[zona] = true;
+            agendar(ahora + REACCION_US, {0, evento.zona, TRAZA_ENCENDER, 1});
+        }
+        break;
+    case TRAZA_SALIDA:
+        presente[zona] = false;
+        if (evento.dato && zonas[zona].estaActivo)
+        {
+            ordenar(zona, false);
+        }
+        break;
+    }
+    resultado.eventos++;
+}
+
+// Las tareas de control del loop, en el mismo orden
+void Simulacion::pasoControl()
+{
+    actualizarRelojInterno();
+    actualizarModoZonas();
+    aplicarComandosPendientes();
+    procesarInterrupcionesPIR();
+    controlarApagadoAutomatico();
+    aplicarTimeoutsAdaptativos();
+    resultado.pasosControl++;
+
+    uint64_t ahora = hostMicros();
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        uint32_t timeouts = estadisticasZona(i).apagadosTimeout;
+        if (timeouts != timeoutsAntes[i])
+        {
+            resultado.zonas[i].apagadosTimeout += timeouts - timeoutsAntes[i];
+            timeoutsAntes[i] = timeouts;
+            ultimoTimeout[i] = ahora;
+            timeoutSinActividad[i] = true;
+            if (traza.sintetica && presente[i])
+            {
+                resultado.zonas[i].apagadosConGente++;
+            }
+        }
+        if (zonas[i].estaActivo != encendida[i])
+        {
+            if (encendida[i])
+            {
+                resultado.zonas[i].msEncendida += (ahora - desdeEncendida[i]) / 1000;
+            }
+            encendida[i] = zonas[i].estaActivo;
+            desdeEncendida[i] = ahora;
+        }
+    }
+}
+
+uint64_t Simulacion::proximoDespertar(uint64_t siguienteEvento)
+{
+    uint64_t ahora = hostMicros();
+    uint64_t despertar = siguienteEvento;
+
+    // Cambio de minuto: modo general y calendarios
+    uint64_t local = microsLocales();
+    despertar = std::min(despertar, ahora + (MINUTO_US - local % MINUTO_US));
+
+    unsigned long vencimiento;
+    if (proximoVencimientoZonas(vencimiento))
+    {
+        despertar = std::min(despertar, std::max(ahora + 1, (uint64_t)vencimiento * 1000));
+    }
+
+    // Un pin que cambió desde la última lectura se ve en la próxima
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        if ((hostLeerPin(zonas[i].pinPir) != 0) != estadosAnterioresPIR[i] && !zonaEnHorarioLaboral(i))
+        {
+            uint64_t lectura = (uint64_t)ultimaLecturaPIR * 1000 + LECTURA_PIR_US;
+            despertar = std::min(despertar, std::max(ahora + 1, lectura));
+            break;
+        }
+    }
+    return despertar;
+}
+
+void Simulacion::correr()
+{
+    iniciarPersistencia();
+    restaurarConfiguracionHoraria();
+    restaurarPoliticasZonas();
+    iniciarAdaptacion();
+    restaurarRelaysArranqueRapido();
+    iniciarEnergia();
+    if (escenario.horariosPropios)
+    {
+        for (int i = 0; i < CANTIDAD_HORARIOS; i++)
+        {
+            establecerHorario(i, escenario.horarios[i].inicio, escenario.horarios[i].fin);
+        }
+    }
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        if (escenario.timeoutS[i])
+        {
+            establecerTimeoutZona(i, escenario.timeoutS[i]);
+            fijarAdaptacionZona(i, false);
+        }
+        resultado.potenciaW[i] = energiaZona(i).potenciaW;
+        timeoutsAntes[i] = estadisticasZona(i).apagadosTimeout;
+        movimientosAntes[i] = sumaMovimientos(i);
+        conmutacionesAntes[i] = conmutacionesRelay[i].load();
+        hostFijarPin(zonas[i].pinPir, LOW);
+    }
+
+    // El reloj monotónico no arranca en 0, como en el equipo
+    hostAvanzarMicros(SEGUNDO_US);
+    sincronizarRelojPreciso(escenario.microsLocalesInicio);
+    origen = hostMicros();
+    uint64_t fin = origen + traza.duracionUs;
+    pasoControl();
+
+    size_t siguiente = 0;
+    while (true)
+    {
+        uint64_t siguienteEvento = fin;
+        if (siguiente < traza.eventos.size())
+        {
+            siguienteEvento = std::min(siguienteEvento, origen + traza.eventos[siguiente].us);
+        }
+        if (!agenda.empty())
+        {
+            siguienteEvento = std::min(siguienteEvento, agenda.top().us);
+        }
+        uint64_t despertar = proximoDespertar(siguienteEvento);
+        if (despertar >= fin)
+        {
+            break;
+        }
+        hostFijarMicros(despertar);
+
+        // Primero los eventos de la traza y después los agendados, como llegarían
+        while (siguiente < traza.eventos.size() && origen + traza.eventos[siguiente].us <= despertar)
+        {
+            aplicar(traza.eventos[siguiente++], 0);
+        }
+        while (!agenda.empty() && agenda.top().us <= despertar)
+        {
+            EventoAgendado agendado = agenda.top();
+            agenda.pop();
+            aplicar(agendado.evento, agendado.version);
+        }
+        pasoControl();
+    }
+
+    hostFijarMicros(fin);
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        ResultadoZonaSimulada &zona = resultado.zonas[i];
+        if (encendida[i])
+        {
+            zona.msEncendida += (fin - desdeEncendida[i]) / 1000;
+        }
+        zona.conmutaciones = conmutacionesRelay[i].load() - conmutacionesAntes[i];
+        zona.movimientos = sumaMovimientos(i) - movimientosAntes[i];
+    }
+}
+
+void simular(const TrazaOcupacion &traza, const EscenarioSimulado &escenario, ResultadoSimulacion &resultado)
+{
+    resultado = {};
+    Simulacion simulacion(traza, escenario, resultado);
+    simulacion.correr();
+}
+
+void imprimirResultado(FILE *salida, const ResultadoSimulacion &resultado)
+{
+    std::fprintf(salida, "zona,conmutaciones,horas_encendida,wh,apagados_timeout,apagados_con_gente,movimientos\n");
+    for (int i = 0; i < CANTIDAD_ZONAS; i++)
+    {
+        const ResultadoZonaSimulada &zona = resultado.zonas[i];
+        double horas = zona.msEncendida / 3600000.0;
+        std::fprintf(salida, "%d,%u,%.2f,%.1f,%u,%u,%u\n", i + 1, zona.conmutaciones, horas,
+                     horas * resultado.potenciaW[i], zona.apagadosTimeout, zona.apagadosConGente,
+                     zona.movimientos);
+    }
+}
@@ -0,0 +1,95 @@
+// Simulador de eventos discretos del control de zonas. Corre el código de
+// producción (zones, interrupts, comandos, calendario...) sobre el reloj
+// virtual de lib/arduino_host: en vez de avanzar de a 10 ms salta directo al
+// próximo evento de la traza, al próximo vencimiento de una zona, a la
+// próxima lectura de PIR con un cambio pendiente o al próximo minuto (cambio
+// de modo), así que días de trazas se simulan en fracciones de segundo.
+//
+// Los módulos del firmware guardan su estado en variables globales: una
+// simulación por proceso.
+
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+#include "time_utils.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+enum TipoEventoTraza : uint8_t
+{
+    TRAZA_MOVIMIENTO,   // Pulso del PIR de retencionPirMs (se redispara)
+    TRAZA_PIR_ALTO,     // Nivel crudo del pin
+    TRAZA_PIR_BAJO,
+    TRAZA_ENCENDER,     // Orden manual por la cola de comandos
+    TRAZA_APAGAR,
+    TRAZA_LLEGADA,      // Solo trazas sintéticas: empieza y termina una estadía;
+    TRAZA_SALIDA        // dato = 1 si el ocupante apaga la luz al irse
+};
+
+struct EventoTraza
+{
+    uint64_t us;        // Desde el comienzo de la traza
+    uint8_t zona;
+    uint8_t tipo;
+    uint8_t dato;
+};
+
+struct TrazaOcupacion
+{
+    std::vector<EventoTraza> eventos;   // Ordenados por instante
+    uint64_t duracionUs;
+    bool sintetica;     // Hay estadías: los apagados con gente se cuentan con ellas
+};
+
+// CSV "segundos,zona,evento" (movimiento, pir_alto, pir_bajo, encender,
+// apagar) o la salida de tools/decodificar_bitacora.cpp; en esta los
+// arranques se encadenan y los apagados por timeout registrados se ignoran,
+// porque los decide la simulación. Zonas desde 1.
+bool cargarTraza(FILE *entrada, TrazaOcupacion &traza, std::string &error);
+
+// Estadías por zona con llegadas de Poisson según la hora y el día de la
+// semana (zonas pares: oficina; impares: pasillo)
+void generarTrazaSintetica(int dias, uint32_t semilla, uint64_t microsLocalesInicio, TrazaOcupacion &traza);
+// La sintética si dias > 0 y si no el archivo ("-" = entrada estándar); los errores van a stderr
+bool prepararTraza(const char *archivo, int dias, uint32_t semilla, uint64_t microsLocalesInicio,
+                   TrazaOcupacion &traza);
+
+struct EscenarioSimulado
+{
+    uint64_t microsLocalesInicio;           // Hora local en que empieza la traza
+    uint32_t timeoutS[CANTIDAD_ZONAS];      // Fijo; 0 = adaptativo desde TIEMPO_MAXIMO_ENCENDIDO
+    Horario horarios[CANTIDAD_HORARIOS];
+    bool horariosPropios;                   // false = horariosLaborales por defecto
+    uint32_t retencionPirMs;                // Tiempo de retención del sensor: el único filtro antes del firmware
+    uint32_t ventanaS;                      // Sin estadías: actividad tras un timeout que lo cuenta como apagado con gente
+};
+
+void escenarioPorDefecto(EscenarioSimulado &escenario);
+// "AAAA-MM-DD" con "THH:MM" opcional
+bool parsearInicioSimulacion(const char *cadena, uint64_t &microsLocales);
+// Hasta CANTIDAD_HORARIOS franjas "HH:MM-HH:MM" separadas por comas
+bool parsearHorariosSimulacion(const char *cadena, EscenarioSimulado &escenario);
+
+struct ResultadoZonaSimulada
+{
+    uint32_t conmutaciones;     // Cambios de los relays
+    uint64_t msEncendida;
+    uint32_t apagadosTimeout;
+    uint32_t apagadosConGente;  // Timeouts con alguien presente
+    uint32_t movimientos;       // Flancos del PIR vistos por el control
+};
+
+struct ResultadoSimulacion
+{
+    ResultadoZonaSimulada zonas[CANTIDAD_ZONAS];
+    uint16_t potenciaW[CANTIDAD_ZONAS];
+    uint64_t pasosControl;
+    uint64_t eventos;
+};
+
+void simular(const TrazaOcupacion &traza, const EscenarioSimulado &escenario, ResultadoSimulacion &resultado);
+
+// Encabezado y una línea por zona, en CSV
+void imprimirResultado(FILE *salida, const ResultadoSimulacion &resultado);
@@ -0,0 +1,142 @@
+// Reproduce trazas de PIR y órdenes manuales con el código de control del
+// firmware sobre un reloj virtual (ver tools/simulador.h).
+//
+// Compilar (los mismos módulos que env:native en platformio.ini):
+//   g++ -std=gnu++17 -O2 -I src -I lib/arduino_host/src -I tools tools/simular.cpp tools/simulador.cpp
+//       src/{zones,time_utils,interrupts,metricas,trazas,bitacora,estadisticas,energia,persistencia,calendario,configuracion,comandos,adaptacion}.cpp
+//       lib/arduino_host/src/Arduino.cpp -o simular
+// Uso:       ./simular --sintetico 30 --timeout 300
+//            ./decodificar_bitacora log.bin | ./simular --inicio 2026-03-02T08:00 -
+//            ./simular --timeout 120 --horario 08:00-12:00,14:00-18:00 eventos.csv
+//
+// Opciones:  --sintetico DIAS   traza generada (oficina en zonas pares, pasillo en impares)
+//            --semilla N        de la traza sintética (1)
+//            --inicio FECHA     hora local del comienzo, AAAA-MM-DD[THH:MM] (2026-01-05, lunes)
+//            --timeout S        apagado automático de todas las zonas; Z=S para una sola
+//            --horario A,B      horarios laborales HH:MM-HH:MM
+//            --retencion S      tiempo de retención del PIR para los eventos "movimiento" (2.5)
+//            --ventana S        sin estadías, actividad tras un timeout que cuenta como
+//                               apagado con gente (60)
+//
+// Salida CSV: zona,conmutaciones,horas_encendida,wh,apagados_timeout,apagados_con_gente,movimientos
+
+#include "simulador.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+static bool parsearTimeout(const char *cadena, EscenarioSimulado &escenario)
+{
+    const char *igual = std::strchr(cadena, '=');
+    int desde = 0, hasta = CANTIDAD_ZONAS;
+    if (igual)
+    {
+        desde = std::atoi(cadena) - 1;
+        hasta = desde + 1;
+        cadena = igual + 1;
+    }
+    uint32_t segundos = std::strtoul(cadena, nullptr, 10);
+    if (desde < 0 || hasta > CANTIDAD_ZONAS || segundos < TIMEOUT_MINIMO_S || segundos > TIMEOUT_MAXIMO_S)
+    {
+        return false;
+    }
+    for (int i = desde; i < hasta; i++)
+    {
+        escenario.timeoutS[i] = segundos;
+    }
+    return true;
+}
+
+static int uso(const char *programa)
+{
+    std::fprintf(stderr,
+                 "Uso: %s [--sintetico DIAS] [--semilla N] [--inicio AAAA-MM-DD[THH:MM]] [--timeout [Z=]S]\n"
+                 "       [--horario HH:MM-HH:MM,...] [--retencion S] [--ventana S] [traza.csv | -]\n",
+                 programa);
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    Serial.silenciado = true;
+    EscenarioSimulado escenario;
+    escenarioPorDefecto(escenario);
+    int diasSinteticos = 0;
+    uint32_t semilla = 1;
+    const char *archivo = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *opcion = argv[i];
+        const char *valor = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool valido = true;
+        if (std::strcmp(opcion, "--sintetico") == 0 && valor)
+        {
+            diasSinteticos = std::atoi(valor);
+            valido = diasSinteticos > 0;
+        }
+        else if (std::strcmp(opcion, "--semilla") == 0 && valor)
+        {
+            semilla = std::strtoul(valor, nullptr, 10);
+        }
+        else if (std::strcmp(opcion, "--inicio") == 0 && valor)
+        {
+            valido = parsearInicioSimulacion(valor, escenario.microsLocalesInicio);
+        }
+        else if (std::strcmp(opcion, "--timeout") == 0 && valor)
+        {
+            valido = parsearTimeout(valor, escenario);
+        }
+        else if (std::strcmp(opcion, "--horario") == 0 && valor)
+        {
+            valido = parsearHorariosSimulacion(valor, escenario);
+        }
+        else if (std::strcmp(opcion, "--retencion") == 0 && valor)
+        {
+            escenario.retencionPirMs = (uint32_t)(std::atof(valor) * 1000);
+            valido = escenario.retencionPirMs >= 100;
+        }
+        else if (std::strcmp(opcion, "--ventana") == 0 && valor)
+        {
+            escenario.ventanaS = std::strtoul(valor, nullptr, 10);
+        }
+        else if (opcion[0] != '-' || std::strcmp(opcion, "-") == 0)
+        {
+            archivo = opcion;
+            continue;
+        }
+        else
+        {
+            return uso(argv[0]);
+        }
+        if (!valido)
+        {
+            std::fprintf(stderr, "%s: valor no válido '%s'\n", opcion, valor);
+            return 1;
+        }
+        i++;
+    }
+    if ((diasSinteticos > 0) == (archivo != nullptr))
+    {
+        return uso(argv[0]);
+    }
+
+    TrazaOcupacion traza;
+    if (!prepararTraza(archivo, diasSinteticos, semilla, escenario.microsLocalesInicio, traza))
+    {
+        return 1;
+    }
+
+    ResultadoSimulacion resultado;
+    auto inicio = std::chrono::steady_clock::now();
+    simular(traza, escenario, resultado);
+    double segundosReales = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+
+    imprimirResultado(stdout, resultado);
+    double segundosSimulados = traza.duracionUs / 1e6;
+    std::fprintf(stderr, "%.1f días simulados en %.3f s (%.0fx tiempo real): %llu eventos, %llu pasos de control\n",
+                 segundosSimulados / 86400, segundosReales, segundosSimulados / std::max(segundosReales, 1e-9),
+                 (unsigned long long)resultado.eventos, (unsigned long long)resultado.pasosControl);
+    return 0;
+}